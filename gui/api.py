@@ -63,6 +63,8 @@ def set_configuration():
         cache_mode = 1  # Default to direct-mapped
         if cache_type == "Set Associative":
             cache_mode = 2
+        elif cache_type == "Fully Associative":
+            cache_mode = 0
         
         # Set global values
         CACHE_ENABLED.value = 1 if cache_enabled else 0
@@ -127,6 +129,8 @@ def executeInstructions():
     register_contents = []
     cache_contents = []
     cache_data_contents = []
+    icache_contents = []       # split I-cache, same formats as the cache lists
+    icache_data_contents = []
     pipeline_state = []
     cycle_count = 0
     fetch_status = None
@@ -160,6 +164,16 @@ def executeInstructions():
                 index, offset, data_index, data_value = parts
                 cache_data_contents.append((int(index), int(offset), int(data_index), int(data_value)))
                 # print(f"[DEBUG] Found cache data: index={index}, offset={offset}, data_index={data_index}, value={data_value}")
+        elif output.startswith("[ICACHE]"):
+            parts = output[8:].split(":")
+            if len(parts) == 4:
+                index, offset, valid, data = parts
+                icache_contents.append((int(index), int(offset), int(valid) == 1, int(data)))
+        elif output.startswith("[ICACHE_DATA]"):
+            parts = output[13:].split(":")
+            if len(parts) == 4:
+                index, offset, data_index, data_value = parts
+                icache_data_contents.append((int(index), int(offset), int(data_index), int(data_value)))
         elif output.startswith("[PIPELINE]"):
             parts = output[10:].split(":")
             if len(parts) >= 3:
@@ -187,6 +201,8 @@ def executeInstructions():
         "registers": register_contents,
         "cache": cache_contents,
         "cache_data": cache_data_contents,
+        "icache": icache_contents,
+        "icache_data": icache_data_contents,
         "pipeline": pipeline_state,
         "cycle": cycle_count,
         "fetch_status": fetch_status,
@@ -201,6 +217,8 @@ def stepInstruction():
     register_contents = []
     cache_contents = []
     cache_data_contents = []
+    icache_contents = []       # split I-cache, same formats as the cache lists
+    icache_data_contents = []
     pipeline_state = []
     cycle_count = 0
     fetch_status = None
@@ -231,6 +249,16 @@ def stepInstruction():
                 index, offset, data_index, data_value = parts
                 cache_data_contents.append((int(index), int(offset), int(data_index), int(data_value)))
                 # print(f"[DEBUG] Found cache data: index={index}, offset={offset}, data_index={data_index}, value={data_value}")
+        elif output.startswith("[ICACHE]"):
+            parts = output[8:].split(":")
+            if len(parts) == 4:
+                index, offset, valid, data = parts
+                icache_contents.append((int(index), int(offset), int(valid) == 1, int(data)))
+        elif output.startswith("[ICACHE_DATA]"):
+            parts = output[13:].split(":")
+            if len(parts) == 4:
+                index, offset, data_index, data_value = parts
+                icache_data_contents.append((int(index), int(offset), int(data_index), int(data_value)))
         elif output.startswith("[PIPELINE]"):
             # Format: [PIPELINE]stage:instruction:pc
             # Example: [PIPELINE]FETCH:ADD R5, R4, R3:0
@@ -258,6 +286,8 @@ def stepInstruction():
         "registers": register_contents,
         "cache": cache_contents,
         "cache_data": cache_data_contents,
+        "icache": icache_contents,
+        "icache_data": icache_data_contents,
         "pipeline": pipeline_state,
         "cycle": cycle_count,  # Include actual cycle count
         "fetch_status": fetch_status  # Include fetch status for UI
@@ -37,6 +37,5 @@ USER_CACHE_DELAY              = _u16 ("USER_CACHE_DELAY")
 CACHE_ENABLED                 = _bool("CACHE_ENABLED")
 CACHE_MODE                    = _u16("CACHE_MODE")
 PIPELINE_ENABLED              = _bool("PIPELINE_ENABLED")
-memory_operation_in_progress  = _bool("memory_operation_in_progress")
 # ──────────────────────────────────────────
 
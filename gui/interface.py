@@ -165,6 +165,8 @@ class ISASimulatorUI(QWidget):
         
         # We'll adapt the cache table headers dynamically based on the selected cache type
         self.cache_table = self.create_table(16, ["Index", "Offset", "Valid", "Tag", "Data[0]", "Data[1]", "Data[2]", "Data[3]"])
+        # The simulator only reports lines that changed, so keep the last known state
+        self.cache_entries = {}
         
         tab_widget.addTab(self.register_table, "Registers")
         tab_widget.addTab(self.memory_table, "Memory")
@@ -221,7 +223,7 @@ class ISASimulatorUI(QWidget):
         config_layout.addWidget(self.pipeline_enabled, 2, 1)
         config_layout.addWidget(QLabel("Cache Type"), 3, 0)
         self.cache_type = QComboBox()
-        self.cache_type.addItems(["Direct-Mapped", "Set Associative"])
+        self.cache_type.addItems(["Direct-Mapped", "Set Associative", "Fully Associative"])
         config_layout.addWidget(self.cache_type, 3, 1)
         config_layout.addWidget(QLabel("DRAM Delay"), 4, 0)
         self.dram_delay = QSpinBox()
@@ -371,23 +373,22 @@ class ISASimulatorUI(QWidget):
                 ["Index", "Way", "Offset", "Valid", "Tag", "Data[0]", "Data[1]", "Data[2]", "Data[3]"]
             )
         
-        # Process cache entries
-        cache_entries = {}
+        # Merge the changed lines into the known ones
+        cache_entries = self.cache_entries
         
         for cache_entry in cache:
             if is_direct_mapped:
                 if len(cache_entry) >= 4:
                     index, offset, valid, tag = cache_entry
                     key = f"{index}:{offset}"
-                    if key not in cache_entries:
-                        cache_entries[key] = {
-                            "index": index, 
-                            "way": 0,  # Direct-mapped has only one way
-                            "offset": offset,
-                            "valid": valid, 
-                            "tag": tag, 
-                            "data": [0, 0, 0, 0]
-                        }
+                    cache_entries[key] = {
+                        "index": index, 
+                        "way": 0,  # Direct-mapped has only one way
+                        "offset": offset,
+                        "valid": valid, 
+                        "tag": tag, 
+                        "data": [0, 0, 0, 0]
+                    }
             else:  # Set associative or fully associative
                 if len(cache_entry) == 5:  # If way information is included
                     index, way, offset, valid, tag = cache_entry
@@ -398,15 +399,14 @@ class ISASimulatorUI(QWidget):
                     continue
                     
                 key = f"{index}:{way}:{offset}"
-                if key not in cache_entries:
-                    cache_entries[key] = {
-                        "index": index,
-                        "way": way,
-                        "offset": offset, 
-                        "valid": valid, 
-                        "tag": tag, 
-                        "data": [0, 0, 0, 0]
-                    }
+                cache_entries[key] = {
+                    "index": index,
+                    "way": way,
+                    "offset": offset, 
+                    "valid": valid, 
+                    "tag": tag, 
+                    "data": [0, 0, 0, 0]
+                }
         
         # Process cache data
         for cache_data_entry in cache_data:
@@ -691,7 +691,7 @@ class ISASimulatorUI(QWidget):
         
         cache = result.get("cache", [])
         cache_data = result.get("cache_data", [])
-        cache_entries = {}
+        cache_entries = self.cache_entries
         
         for index, offset, valid, tag in cache:
             key = f"{index}:{offset}"
@@ -728,6 +728,8 @@ class ISASimulatorUI(QWidget):
         try:
             r = requests.post(f"{self.api_url}/set_configuration", json=payload, timeout=5)
             r.raise_for_status()
+            # The backend rebuilt its cache and reports every line again
+            self.cache_entries = {}
             # Instead of showing a popup, just print a message
             message = r.json().get("message", "Configuration applied")
             print(f"[INFO] {message}")
@@ -833,6 +835,7 @@ class ISASimulatorUI(QWidget):
         
         # Update cache table if needed
         self.cache_table.setRowCount(0)
+        self.cache_entries = {}
         
         # Update everything on screen
         self.register_table.update()
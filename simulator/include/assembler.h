@@ -25,6 +25,7 @@ typedef struct {
 } RRIinstr;
 
 uint16_t loadInstruction(const char *line);
+int assembleFile(const char *path, uint16_t *image, int capacity);
 
 uint16_t RRRTypeEncode(RRRinstr *instr);
 uint16_t RRTypeEncode(RRinstr *instr);
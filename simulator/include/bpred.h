@@ -0,0 +1,39 @@
+#ifndef BPRED_H
+#define BPRED_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pipeline.h"
+
+// Branch predictors (the bpred knob).  Off, fetch runs on past a branch and
+// the branch squashes what followed it, redirecting the PC in write-back.
+// On, fetch predecodes each word it brings in: a JMP sends it straight to
+// its target, and BEQ / BLT go where the predictor says.  The branch is
+// checked in EX, and only a wrong guess squashes the path fetched after it.
+enum {
+    BP_NONE,        // no prediction: squash after every branch, redirect at WB
+    BP_NOT_TAKEN,   // always fall through
+    BP_BTFN,        // backward taken, forward not taken
+    BP_BIMODAL,     // 2-bit counters indexed by PC
+    BP_GSHARE,      // 2-bit counters indexed by PC xor global history
+    BP_TOURNAMENT,  // bimodal and gshare, a per-PC chooser picking between them
+    BP_KINDS
+};
+
+#define BP_MAX_ENTRIES 4096     // counters per table
+
+typedef struct {
+    uint16_t mask;                      // bpred_size - 1
+    uint16_t history;                   // outcomes of the last branches resolved, newest in bit 0
+    uint8_t  bimodal[BP_MAX_ENTRIES];   // 2-bit counters, >= 2 predicts taken
+    uint8_t  gshare[BP_MAX_ENTRIES];
+    uint8_t  chooser[BP_MAX_ENTRIES];   // tournament: >= 2 trusts gshare
+} BranchPredictor;
+
+int bp_kind_id(const char *name);
+const char *bp_kind_name(int kind);
+void bp_configure(SimContext *ctx);
+bool bp_predict(SimContext *ctx, uint16_t pc, uint16_t target, uint16_t history);
+void bp_update(SimContext *ctx, uint16_t pc, uint16_t history, bool taken);
+
+#endif
@@ -3,6 +3,6 @@
 
 #include "pipeline.h"
 
-void decode_stage(PipelineState* pipeline);
+void decode_stage(SimContext *ctx);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,74 @@
+#ifndef DECODE_TABLE_H
+#define DECODE_TABLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Every 16-bit word predecoded once, at build time (tools/gen_decode_table.c
+// writes decode_table.c into the build tree).  Stages index the table with
+// the raw instruction instead of re-extracting fields.
+
+// Execution handler: what the instruction does, with the shift type folded in.
+// Kept as a small index rather than a function pointer so the 64K-entry table
+// stays position independent; consumers map it onto their own switch or
+// dispatch table.
+enum {
+    H_NOP = 0,      // word 0: NOP / end of program
+    H_ADD, H_SUB, H_AND, H_OR, H_XOR, H_DIVMOD, H_MUL, H_CMP,
+    H_LSL, H_LSR, H_ROL, H_ROR,
+    H_LW, H_SW,
+    H_BEQ, H_JMP, H_BLT,
+    H_INVALID,      // unassigned opcodes 0xD / 0xE
+    H_COUNT
+};
+
+// Functional-unit class (EX_MEM.functional_unit).
+enum {
+    FU_NONE = 0,
+    FU_ALU,
+    FU_MUL,
+    FU_DIV,
+    FU_SHIFT,
+    FU_MEM,
+    FU_BRANCH
+};
+
+// flags
+#define DI_VALID   0x01     // travels down the pipe (not a NOP / unassigned)
+#define DI_LOAD    0x02
+#define DI_STORE   0x04
+#define DI_BRANCH  0x08     // BEQ / BLT / JMP: redirects the PC in write-back
+
+typedef struct {
+    uint8_t  opcode;        // bits [15:12]
+    uint8_t  type;          // shift kind (opcode 8), 0 otherwise
+    uint8_t  regD;          // fields exactly as decode_stage hands them to ID/EX
+    uint8_t  regA;
+    uint8_t  regB;
+    uint8_t  fu;
+    uint8_t  handler;
+    uint8_t  flags;
+    uint16_t imm;           // 4-bit immediate, or the 12-bit JMP target
+    uint16_t src_mask;      // registers read (bit n = Rn)
+    uint16_t dst_mask;      // registers written, PC redirects excluded
+} DecodedInstr;
+
+extern const DecodedInstr decode_table[65536];
+
+// Shift / rotate results shared by every execution engine.  Shifting by 16
+// or more clears the value; rotates use the amount modulo 16.
+static inline uint16_t isa_lsl(uint16_t x, uint16_t n) { return n < 16 ? (uint16_t)(x << n) : 0; }
+static inline uint16_t isa_lsr(uint16_t x, uint16_t n) { return n < 16 ? x >> n : 0; }
+static inline uint16_t isa_rol(uint16_t x, uint16_t n) {
+    n &= 15;
+    return (uint16_t)((x << n) | (x >> ((16 - n) & 15)));
+}
+static inline uint16_t isa_ror(uint16_t x, uint16_t n) {
+    n &= 15;
+    return (uint16_t)((x >> n) | (x << ((16 - n) & 15)));
+}
+
+// Assembler-syntax text for one word ("ADD R5, R4, R3", "LW R2, [R1 + 9]"...).
+void disassemble(uint16_t word, char *out, size_t len);
+
+#endif
@@ -6,9 +6,6 @@
 #include <stdlib.h>
 #include <stdbool.h>
 
-extern bool branch_taken;
-extern uint16_t branch_target_address;
-
-void execute(PipelineState *pipeline);
+void execute(SimContext *ctx);
 
 #endif
@@ -5,12 +5,6 @@
 #include <stdbool.h>
 #include <stdint.h>
 
-// Export fetch memory state variables
-extern bool fetch_memory_busy;
-extern uint16_t fetch_delay_counter;
-extern uint16_t fetch_delay_target;
-extern uint16_t fetch_pending_address;
-
-void fetch_stage(PipelineState* pipeline, uint16_t* value);
+void fetch_stage(SimContext *ctx, uint16_t* value);
 
 #endif
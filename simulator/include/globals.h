@@ -6,13 +6,98 @@
 
 #define DATA_OFFSET 0
 
-extern bool     memory_operation_in_progress;
-
 extern uint16_t USER_DRAM_DELAY;
 extern uint16_t USER_CACHE_DELAY;
 
 extern bool     PIPELINE_ENABLED;
 extern bool     CACHE_ENABLED;
 extern uint16_t CACHE_MODE;
+extern uint16_t CACHE_WORDS;
+extern uint16_t CACHE_BLOCK;
+extern uint16_t CACHE_POLICY;
+extern uint16_t CACHE_SEED;
+extern bool     WRITE_BACK;
+extern bool     SPLIT_CACHE;
+extern uint16_t ICACHE_WORDS;
+extern uint16_t ICACHE_BLOCK;
+extern uint16_t ICACHE_WAYS;
+extern uint16_t USER_ICACHE_DELAY;
+extern bool     L2_ENABLED;
+extern uint16_t L2_WORDS;
+extern uint16_t L2_BLOCK;
+extern uint16_t L2_WAYS;
+extern uint16_t USER_L2_DELAY;
+extern uint16_t L2_POLICY;
+extern uint16_t L2_INCLUSION;
+extern uint16_t MSHR_ENTRIES;
+extern uint16_t PREFETCHER;
+extern uint16_t PREFETCH_DEGREE;
+extern uint16_t VICTIM_ENTRIES;
+extern uint16_t USER_VICTIM_DELAY;
+extern uint16_t DRAM_BANKS;
+extern uint16_t DRAM_ROW_WORDS;
+extern uint16_t DRAM_TRCD;
+extern uint16_t DRAM_TCAS;
+extern uint16_t DRAM_TRP;
+extern uint16_t DRAM_TRAS;
+extern bool     DRAM_CLOSE_PAGE;
+extern uint16_t MEM_CONTROLLER;
+extern uint16_t BUS_WIDTH;
+extern uint16_t STORE_BUFFER;
+extern uint16_t BRANCH_PREDICTOR;
+extern uint16_t BPRED_ENTRIES;
+extern uint16_t BUS_BEAT;
+extern uint16_t FILL_ORDER;
+extern bool     JIT_ENABLED;
+
+// Per-simulator copy of the knobs above.  The globals are the process-wide
+// defaults (and what gui/globals.py binds to); each SimContext snapshots them
+// when it is created and is configured independently from then on.
+typedef struct {
+    uint16_t dram_delay;
+    uint16_t cache_delay;
+    bool     pipeline_enabled;
+    bool     cache_enabled;
+    uint16_t cache_mode;        // ways per set: 1 = direct-mapped, 0 = fully associative
+    uint16_t cache_size;        // words, power of two
+    uint16_t cache_block;       // words per line, power of two
+    uint16_t cache_policy;      // replacement policy, REPL_* in memory.h
+    uint16_t cache_seed;        // random / BRRIP replacement seed
+    bool     write_back;        // write-back + write-allocate instead of write-through
+    bool     split_cache;       // separate L1 I-cache for fetches; else one shared cache
+    uint16_t icache_size;       // I-cache geometry and hit latency (split_cache only)
+    uint16_t icache_block;
+    uint16_t icache_ways;
+    uint16_t icache_delay;
+    bool     l2_enabled;        // unified L2 between the L1s and DRAM
+    uint16_t l2_size;           // L2 geometry, hit latency and replacement policy
+    uint16_t l2_block;
+    uint16_t l2_ways;
+    uint16_t l2_delay;
+    uint16_t l2_policy;
+    uint16_t l2_inclusion;      // INCL_* in memory.h
+    uint16_t mshrs;             // outstanding load misses; 0 = loads block the MEM stage
+    uint16_t prefetch;          // L1 prefetcher, PF_* in prefetch.h
+    uint16_t prefetch_degree;   // blocks it fetches ahead
+    uint16_t victims;           // victim buffer entries behind each L1; 0 = none
+    uint16_t victim_delay;      // cycles to swap a block back in from it
+    uint16_t dram_banks;        // banked DRAM timing (DRAMTiming); 0 = flat dram_delay
+    uint16_t dram_row;          // words per DRAM row
+    uint16_t dram_trcd;         // row activate to column access
+    uint16_t dram_tcas;         // column access to data
+    uint16_t dram_trp;          // precharge (row close)
+    uint16_t dram_tras;         // activate to precharge, minimum
+    bool     dram_close_page;   // precharge after every access instead of leaving the row open
+    uint16_t memctrl;           // DRAM request scheduling, MC_* in memctrl.h; MC_NONE times accesses at once
+    uint16_t store_buffer;      // store buffer entries; 0 = stores block the MEM stage
+    uint16_t bpred;             // branch predictor, BP_* in bpred.h; BP_NONE squashes after every branch
+    uint16_t bpred_size;        // counters per predictor table
+    uint16_t bus_width;         // memory bus words per beat; 0 = a fill arrives with its DRAM access
+    uint16_t bus_beat;          // cycles per beat
+    uint16_t fill_order;        // FILL_* in simulator.h
+    bool     jit_enabled;       // functional mode runs on the JIT where available
+} SimConfig;
+
+SimConfig default_config(void);
 
 #endif
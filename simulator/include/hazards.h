@@ -16,7 +16,7 @@ typedef struct {
 } HazardInfo;
 
 HazardInfo detect_hazards(PipelineState *pipeline);
-void resolve_hazards(PipelineState *pipeline, HazardInfo *hazard);
-void forward_result(PipelineState *pipeline, HazardInfo *hazard);
+void resolve_hazards(SimContext *ctx, HazardInfo *hazard);
+void forward_result(SimContext *ctx, HazardInfo *hazard);
 
 #endif
\ No newline at end of file
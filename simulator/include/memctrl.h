@@ -0,0 +1,60 @@
+#ifndef MEMCTRL_H
+#define MEMCTRL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "memory.h"
+#include "pipeline.h"
+
+// Memory controller (the memctrl knob).  Off, every DRAM access is timed the
+// moment it is made.  On, fetch, load, store, prefetch and write-back
+// requests bound for DRAM wait in one queue, and each cycle the controller
+// issues at most one of them to a free bank (or to the flat DRAM once it is
+// idle).  The requester learns its latency when its request issues.
+enum {
+    MC_NONE,        // no controller: accesses are timed at once
+    MC_FCFS,        // strictly oldest first
+    MC_FRFCFS,      // row-buffer hits on free banks first, then oldest first
+    MC_POLICIES
+};
+
+enum {
+    MC_FETCH,
+    MC_LOAD,
+    MC_STORE,
+    MC_PREFETCH,
+    MC_WRITEBACK,
+    MC_SOURCES
+};
+
+#define MC_QUEUE 64             // requests waiting for DRAM
+#define MC_WAIT  UINT16_MAX     // missDelay(): latency not known until the request issues
+
+typedef struct {
+    uint16_t address;
+    uint16_t source;            // MC_FETCH ... MC_WRITEBACK
+    uint16_t lead;              // cycles spent above DRAM (the L2 lookup), added to the latency
+    Cache   *cache;             // L1 it fills, NULL for none (write-backs, non-allocating stores)
+    uint64_t arrival;           // cycle it was queued
+} MemRequest;
+
+typedef struct {
+    MemRequest queue[MC_QUEUE];     // queue[0..queued) in arrival order
+    uint16_t   queued;
+
+    uint32_t   requests[MC_SOURCES];    // issued, per source
+    uint64_t   wait[MC_SOURCES];        // cycles spent queued, per source
+    uint32_t   max_wait[MC_SOURCES];
+    uint32_t   row_first;       // FR-FCFS: row hits issued ahead of an older request
+    uint32_t   overflows;       // requests timed at once because the queue was full
+} MemController;
+
+int mc_policy_id(const char *name);
+const char *mc_policy_name(int policy);
+const char *mc_source_name(int source);
+void mc_configure(SimContext *ctx);
+bool mc_submit(SimContext *ctx, int source, uint16_t address, Cache *cache, uint16_t lead);
+void mc_cancel(SimContext *ctx, int source);
+void mc_tick(SimContext *ctx);
+
+#endif
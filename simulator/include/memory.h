@@ -5,19 +5,56 @@
 #include <stdbool.h>
 #include <string.h>
 
-#define DRAM_SIZE 1000
+#define DRAM_SIZE 65536      // the whole 16-bit address space: every address is valid
 #define INSTR_SPACE 0
 #define DRAM_DELAY 1       // Delay cycles for DRAM operations set to 1
 #define MAX_MEM_VIEW 16
 #define MAX_VALUE_LENGTH 128
-#define CMD_SIZE 7           // For commands like "SW" or "LW"
+#define DRAM_MAX_BANKS 16    // banked DRAM timing (dram_banks)
 
-#define CACHE_SIZE 64
-#define BLOCK_SIZE 4
+#define MAX_CACHE_SIZE 32768  // words; cache geometry comes from SimConfig
+#define MAX_VICTIMS 8         // victim buffer entries
+
+// DRAM dirty tracking: one bit per 16-word block, and one summary bit per
+// 64 blocks, so a state report visits only the blocks written since the last.
+#define DIRTY_BLOCK_SHIFT 4
+#define DIRTY_BLOCKS (DRAM_SIZE >> DIRTY_BLOCK_SHIFT)
+#define DIRTY_WORDS (DIRTY_BLOCKS / 64)
 
 typedef struct Cache Cache;
-typedef struct Set Set;
-typedef struct Line Line;
+
+// Cache replacement policies (the cache_policy knob).
+enum {
+    REPL_LRU,       // true LRU: per-line age
+    REPL_PLRU,      // tree pseudo-LRU
+    REPL_FIFO,      // round robin in fill order
+    REPL_RANDOM,    // seeded xorshift
+    REPL_SRRIP,     // static re-reference interval prediction
+    REPL_BRRIP,     // bimodal RRIP: most fills inserted as distant
+    REPL_COUNT
+};
+
+// How an L2 relates to the L1s above it (the l2_inclusion knob).
+enum {
+    INCL_NINE,      // non-inclusive, non-exclusive: fills go to both levels
+    INCL_INCLUSIVE, // every L1 block is also in L2; L2 evictions invalidate L1
+    INCL_EXCLUSIVE, // L2 holds only L1 victims; an L2 hit moves the block up
+    INCL_COUNT
+};
+
+// Small fully associative buffer catching the lines an L1 evicts (the victim
+// knob).  An L1 miss that finds its block here swaps it back into the cache;
+// the oldest entry is passed down when a new victim needs room.
+typedef struct {
+    uint16_t  entries;
+    uint16_t  block[MAX_VICTIMS];   // block address
+    uint16_t  valid[MAX_VICTIMS];
+    uint16_t  dirty[MAX_VICTIMS];
+    uint16_t  age[MAX_VICTIMS];     // 0 = newest
+    uint16_t *data;                 // block_size words per entry, plus one spare
+    uint32_t  hits;                 // L1 misses served from the buffer
+    uint32_t  misses;               // L1 misses that went to the level below
+} VictimBuffer;
 
 typedef struct {
     uint16_t R[16];  // Array of 16 registers (R0-R12, LR, SR, PC)
@@ -27,40 +64,94 @@ typedef struct {
 } REGISTERS;
 
 
-// DRAM state enum.
+// DRAM bank state, as of the last command scheduled on the bank.
 typedef enum {
-    DRAM_IDLE,
-    DRAM_READ,
-    DRAM_WRITE
+    DRAM_IDLE,          // precharged: no row open
+    DRAM_ACTIVE,        // row open in the row buffer
+    DRAM_PRECHARGE      // closing its row until ready, then idle
 } DRAMState;
 
-// Updated DRAM structure.
+// Banked DRAM timing.  With banks == 0 every access costs the flat
+// dram_delay; otherwise consecutive rows of row_size words interleave across
+// the banks, and an access costs tCAS on a row-buffer hit, tRCD + tCAS on an
+// idle bank and tRP + tRCD + tCAS on a row conflict (a row stays open at
+// least tRAS).  A closed-page DRAM precharges after every access.
+typedef struct {
+    uint16_t banks;             // power of two, up to DRAM_MAX_BANKS; 0 = flat
+    uint16_t row_size;          // words per row, power of two
+    uint16_t tRCD, tCAS, tRP, tRAS;
+    bool     close_page;
+} DRAMTiming;
+
 typedef struct {
-    uint16_t memory[DRAM_SIZE];
     DRAMState state;
-    uint16_t delayCounter;
-    uint16_t pendingAddr;
-    int16_t pendingValue;
-    char pendingCmd[CMD_SIZE];
+    uint16_t  row;              // open row (DRAM_ACTIVE)
+    uint64_t  ready;            // cycle the bank takes its next command
+    uint64_t  activated;        // cycle the open row was activated, for tRAS
+} DRAMBank;
+
+typedef struct {
+    uint16_t *memory;           // DRAM_SIZE words, page aligned (allocMemory)
+    uint64_t dirty[DIRTY_WORDS];  // blocks written since the last report
+    uint64_t dirty_summary;       // bit w set when dirty[w] != 0
+
+    DRAMTiming timing;
+    uint16_t row_shift;         // log2(row_size)
+    uint16_t bank_shift;        // log2(banks)
+    uint64_t now;               // cycle of the last updateDRAM tick
+    DRAMBank bank[DRAM_MAX_BANKS];
+    uint32_t row_hits;          // accesses that found their row open
+    uint32_t row_misses;        // ... found their bank idle
+    uint32_t row_conflicts;     // ... had to close another row first
+
+    // When set, write-backs that reach DRAM are handed to this (the memory
+    // controller's queue) instead of being timed at once.
+    void (*writeback)(void *owner, uint16_t address);
+    void  *owner;
 } DRAM;
 
-// mode of 1 = Direct-Mapped, 2 = Two-Way Set Associative
+// Geometry is set by init_cache().  Every dimension is a power of two, so the
+// block offset, set index and tag of an address are masks and shifts.  Line
+// state is kept as parallel arrays indexed by line id = set * ways + way.
 struct Cache {
-  struct Set *sets;
   uint16_t num_sets;
-  uint16_t mode;
-};
+  uint16_t ways;         // lines per set: 1 = direct-mapped, all lines = fully associative
+  uint16_t block_size;   // words per line
+  uint16_t offset_bits;  // log2(block_size)
+  uint16_t tag_shift;    // log2(block_size * num_sets)
+  uint16_t set_mask;     // num_sets - 1
+  uint32_t num_lines;
+  uint16_t policy;       // REPL_*
+  bool     write_back;   // write-back + write-allocate; else write-through, no allocate
+  const char *label;     // [CACHE] trace / report prefix ("ICACHE" for a split I-cache)
+  struct Cache *snoop;   // cache whose copies this one's stores also update, or NULL
+  struct Cache *next;    // level below (L2) that fills and write-backs go through, or NULL for DRAM
+  struct Cache *uppers[2];  // L1s above this level (back-invalidated when inclusive)
+  uint16_t num_uppers;
+  uint16_t inclusion;    // INCL_*, as the level below an L1
+  VictimBuffer *victims; // victim buffer behind this L1, or NULL
+  uint32_t seed;
+  uint32_t rng;          // random / BRRIP generator state
 
-struct Set {
-  struct Line *lines;
-  uint16_t associativity;
-};
+  uint16_t *tags;
+  uint16_t *valid;       // 0 or 1
+  uint16_t *dirty;       // 1 = newer than DRAM (write-back only)
+  uint16_t *repl;        // per-line replacement state (LRU age, PLRU tree, RRPV)
+  uint16_t *queued;      // line is in changed[]
+  uint16_t *prefetched;  // filled by a prefetch, no demand hit yet
+  uint16_t *set_repl;    // per-set replacement state (FIFO pointer)
+  uint16_t *data;        // block_size words per line
+  void     *store;       // the one allocation the arrays above live in
 
-struct Line {
-  uint16_t lru; //current # in least-recently used scheme - 0 indicates most-recently used. Does not apply for direct-mapped
-  uint16_t tag;
-  uint16_t valid;
-  uint16_t data[BLOCK_SIZE];
+  uint32_t hits;    // lookups that found their block (reads, writes and fetches)
+  uint32_t misses;
+  uint32_t writebacks;   // dirty lines written to the next level on eviction or flush
+  uint32_t wb_pending;   // DRAM write-backs not yet charged to DRAM timing
+  uint32_t prefetch_fills;   // lines filled by a prefetcher
+  uint32_t prefetch_hits;    // of those, first demand hits
+  uint32_t prefetch_unused;  // of those, evicted before any demand hit
+  uint32_t *changed;     // ids of lines changed since the last report
+  uint32_t num_changed;
 };
 
 REGISTERS *init_registers();
@@ -68,19 +159,58 @@ REGISTERS *init_registers();
 void writeToMemory(DRAM *dram, uint16_t addr, int16_t data);
 uint16_t readFromMemory(DRAM *dram, uint16_t addr);
 void clearMemory(DRAM *dram);
+uint16_t *allocMemory(void);
+void freeMemory(uint16_t *memory);
+void clearDirty(DRAM *dram);
 void viewBlockMemory(DRAM *dram, uint16_t addr, uint16_t numBlocks, char values[]);
-void updateDRAM(DRAM *dram, Cache *cache);
+bool set_dram_timing(DRAM *dram, const DRAMTiming *timing);
+int dram_page_id(const char *name);
+const char *dram_page_name(bool close_page);
+uint64_t dram_access(DRAM *dram, uint64_t now, uint16_t address);
+uint64_t dram_bank_ready(DRAM *dram, uint16_t address);
+bool dram_row_open(DRAM *dram, uint16_t address);
+void updateDRAM(DRAM *dram, uint64_t now);
 
 // Unified memory access functions
 uint16_t memory_read(Cache *cache, DRAM *dram, uint16_t address);
 void memory_write(Cache *cache, DRAM *dram, uint16_t address, uint16_t data);
 uint16_t fetch_with_cache(Cache *cache, DRAM *dram, uint16_t address, bool *is_hit);
 int write_through(Cache *cache, DRAM *dram, uint16_t address, uint16_t data);
-Cache *init_cache(uint16_t mode);
-Set *init_set(uint16_t mode);
-Line *init_line();
+int write_cache(Cache *cache, DRAM *dram, uint16_t address, uint16_t data);
+uint32_t flush_cache(Cache *cache, DRAM *dram);
+bool cache_geometry_ok(uint16_t size, uint16_t block_size, uint16_t ways);
+Cache *init_cache(uint16_t size, uint16_t block_size, uint16_t ways, uint16_t policy, uint32_t seed,
+                  bool write_back);
+int cache_policy_id(const char *name);
+const char *cache_policy_name(int policy);
+int cache_inclusion_id(const char *name);
+const char *cache_inclusion_name(int inclusion);
+int cache_lookup(const Cache *cache, uint16_t address);
+bool init_victim_buffer(Cache *cache, uint16_t entries);
+int victim_lookup(const Cache *cache, uint16_t address);
 void clear_cache(Cache *cache);
 void destroy_cache(Cache *cache);
 uint16_t read_cache(Cache *cache, DRAM *dram, uint16_t address);
+void patch_cache(Cache *cache, uint16_t address, uint16_t data);
+void writeback_range(Cache *cache, DRAM *dram, uint16_t address, uint16_t words);
+bool prefetch_line(Cache *cache, DRAM *dram, uint16_t address, bool demanded);
+void clear_cache_changes(Cache *cache);
+
+static inline uint16_t cache_offset(const Cache *cache, uint16_t address) {
+  return address & (cache->block_size - 1);
+}
+static inline uint16_t cache_set(const Cache *cache, uint16_t address) {
+  return (address >> cache->offset_bits) & cache->set_mask;
+}
+static inline uint16_t cache_tag(const Cache *cache, uint16_t address) {
+  return address >> cache->tag_shift;
+}
+
+// Flag the block holding addr for the next state report.
+static inline void markDirty(DRAM *dram, uint16_t addr) {
+  uint16_t block = addr >> DIRTY_BLOCK_SHIFT;
+  dram->dirty[block >> 6] |= 1ull << (block & 63);
+  dram->dirty_summary     |= 1ull << (block >> 6);
+}
 
 #endif
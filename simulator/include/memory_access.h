@@ -6,6 +6,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-void memory_access(PipelineState *pipeline);
+void memory_access(SimContext *ctx);
+void mshr_tick(SimContext *ctx);
+void sb_tick(SimContext *ctx);
+void sb_flush(SimContext *ctx);
+void sb_drain_range(SimContext *ctx, uint16_t address, uint16_t words);
 
 #endif
@@ -4,6 +4,8 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+typedef struct SimContext SimContext;   // simulator.h
+
 // Pipeline registers
 
 typedef struct {
@@ -11,6 +13,9 @@ typedef struct {
     bool     squashed;    // Is the instruction squashed due to branch
     uint16_t pc;
     uint16_t instruction;
+    bool     predicted;   // a branch fetch steered by the predictor (bpred knob)
+    bool     pred_taken;  // where it sent fetch
+    uint16_t bp_history;  // global history it predicted with
 } IF_ID_Register;
 
 typedef struct {
@@ -23,6 +28,13 @@ typedef struct {
     uint16_t imm;         // Make sure this is 16 bits for correct offset values
     uint16_t opcode;
     uint16_t type;
+    uint16_t handler;          // decode_table.h H_* (shift type folded in)
+    uint16_t functional_unit;
+    uint16_t src_mask;         // registers read, for the hazard unit
+    uint16_t dst_mask;         // registers written
+    bool     predicted;        // IF_ID's branch prediction, checked in EX
+    bool     pred_taken;
+    uint16_t bp_history;
 } ID_EX_Register;
 
 typedef struct {
@@ -37,6 +49,10 @@ typedef struct {
     uint16_t res;
     uint16_t resMod;
     uint16_t functional_unit;  // Added for scoreboard tracking
+    uint16_t handler;
+    uint16_t dst_mask;
+    bool     taken;       // branch resolved taken in EX
+    uint16_t target;      // and where it went
 } EX_MEM_Register;
 
 typedef struct {
@@ -51,6 +67,10 @@ typedef struct {
     uint16_t res;
     uint16_t resMod;
     uint16_t functional_unit;  // Added for scoreboard tracking
+    uint16_t handler;
+    uint16_t dst_mask;
+    bool     taken;       // branch resolved taken in EX
+    uint16_t target;      // and where it went
 } MEM_WB_Register;
 
 typedef struct {
@@ -80,9 +100,7 @@ typedef struct {
     WB_Register WB_next;
 } PipelineState;
 
-extern PipelineState pipeline;
-
-void pipeline_step(PipelineState* pipeline, uint16_t* value);
+void pipeline_step(SimContext *ctx, uint16_t* value);
 void mark_subsequent_instructions_as_squashed(PipelineState* pipeline);
 
 #endif
@@ -0,0 +1,71 @@
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "memory.h"
+#include "simulator.h"
+
+// Hardware prefetchers (the prefetch knob).  A prefetcher watches the demand
+// accesses of one L1 and queues fills for the blocks it predicts; each fill
+// takes its turn on the DRAM like a demand miss and lands in the cache when
+// the transfer completes.
+enum {
+    PF_NONE,        // demand fills only
+    PF_NEXT_LINE,   // the next prefetch_degree blocks after each new block touched
+    PF_STRIDE,      // per-PC stride table (loads and stores): confirmed strides run ahead
+    PF_STREAM,      // stream buffers: a miss starts a sequential stream, hits on it advance it
+    PF_COUNT
+};
+
+#define PF_QUEUE   8    // fills in flight per prefetcher
+#define PF_TABLE   16   // stride table entries (direct mapped on PC)
+#define PF_STREAMS 4    // stream buffers
+
+typedef struct {
+    uint16_t block;     // block address
+    uint64_t ready;     // cycle the fill lands
+    bool     demanded;  // a demand miss is already waiting on it
+} PrefetchFill;
+
+typedef struct {
+    uint16_t pc;
+    uint16_t last;      // address of the last access from pc
+    int16_t  stride;
+    uint16_t conf;      // repeats of stride, saturating at 3
+    bool     valid;
+} StrideEntry;
+
+typedef struct {
+    uint16_t next;      // block the stream expects next
+    int16_t  dir;       // +1 or -1 blocks
+    uint16_t ahead;     // last block prefetched for it
+    uint64_t used;      // cycle of the last access, for replacement
+    bool     valid;
+} StreamBuffer;
+
+struct Prefetcher {
+    int       kind;             // PF_*
+    uint16_t  degree;           // blocks fetched ahead
+    Cache    *cache;            // the L1 it fills
+    uint16_t  last_block;       // next-line: last block touched
+    uint16_t  last_miss;        // stream: last missing block, for the direction
+    PrefetchFill queue[PF_QUEUE];   // queue[0..queued) are in flight
+    uint16_t  queued;
+    StrideEntry  table[PF_TABLE];
+    StreamBuffer stream[PF_STREAMS];
+
+    uint32_t  issued;           // fills queued
+    uint32_t  late;             // demand misses that found their block still in flight
+    uint32_t  dropped;          // predictions lost to a full queue
+};
+
+Prefetcher *init_prefetcher(int kind, uint16_t degree, Cache *cache);
+int prefetch_kind_id(const char *name);
+const char *prefetch_kind_name(int kind);
+void prefetch_access(SimContext *ctx, Prefetcher *pf, bool fetch, uint16_t pc, uint16_t address, bool hit);
+int prefetch_wait(SimContext *ctx, Prefetcher *pf, uint16_t address);
+void prefetch_ready(Prefetcher *pf, uint16_t block, uint64_t ready);
+void prefetch_tick(SimContext *ctx);
+
+#endif
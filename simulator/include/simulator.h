@@ -2,21 +2,229 @@
 #define SIMULATOR_H
 
 #include <stdbool.h>
+#include <stdio.h>
 #include <stdint.h>
 #include "memory.h"
 #include "pipeline.h"
+#include "globals.h"
+#include "memctrl.h"
+#include "bpred.h"
 
-// Global variable declarations
-extern REGISTERS *registers;
-extern DRAM dram;
-extern Cache *cache;
-extern PipelineState pipeline;
+// Run counters reported by the headless runner.
+typedef struct {
+    uint64_t cycles;        // simulated clock cycles
+    uint64_t instructions;  // instructions retired in write-back (squashed ones excluded)
+    uint64_t mem_stall_cycles;     // front end frozen behind a MEM stage access
+    uint64_t hazard_stall_cycles;  // load-use bubbles from the hazard unit
+    uint64_t fetch_stall_cycles;   // IF stage waiting on the cache / DRAM
+    uint64_t mshr_misses;          // load misses that left MEM in an MSHR
+    uint64_t mshr_merges;          // loads that joined a miss already outstanding
+    uint64_t sb_stores;            // stores retired into the store buffer (store_buffer > 0)
+    uint64_t sb_coalesced;         // of those, stores merged into an entry already waiting
+    uint64_t sb_forwards;          // loads served from the store buffer
+    uint64_t sb_full_cycles;       // cycles a store waited in MEM for a free entry
+    uint64_t bus_fills;            // demand fills streamed over the memory bus (bus_width > 0)
+    uint64_t restart_cycles;       // cycles early restart saved those fills' requesters
+    uint64_t branches;             // BEQ / BLT resolved in EX
+    uint64_t mispredicts;          // of those, predicted the wrong way (bpred knob)
+    uint64_t flush_cycles;         // issue slots lost to branches: squashed, bubbled or refetched
+    uint64_t functional_instructions;  // executed by runFunctional() (no cycles)
+} SimStats;
+
+// IF stage memory access in flight.
+typedef struct {
+    bool     memory_busy;
+    bool     squash_pending;    // one-shot flag to squash the next fetch completion
+    bool     halted;            // drainPipeline(): issue nothing, let the pipe empty
+    bool     redirect;          // EX found a mispredicted branch: fetch from redirect_pc
+    uint16_t redirect_pc;
+    uint16_t delay_counter;
+    uint16_t delay_target;
+    uint16_t pending_address;
+} FetchState;
+
+// MEM stage load / store in flight.
+typedef struct {
+    bool     busy;
+    bool     forwarded;         // a load served from the store buffer: pend_val is its data
+    uint16_t delay, target;
+    uint16_t pend_addr, pend_handler, pend_regD, pend_val;
+} MemAccessState;
+
+// Miss status holding registers (mshrs > 0): one per D-cache block being
+// filled, each with the loads waiting for it.
+#define MAX_MSHRS    16
+#define MSHR_TARGETS 4
+
+typedef struct {
+    uint16_t block;                  // block address
+    uint64_t ready;                  // cycle the waiting loads retire
+    uint16_t count;
+    uint16_t reg[MSHR_TARGETS];      // destination, value and address per load
+    uint16_t val[MSHR_TARGETS];
+    uint16_t addr[MSHR_TARGETS];
+} MSHREntry;
+
+typedef struct {
+    MSHREntry entry[MAX_MSHRS];      // entry[0..used) are live
+    uint16_t  used;
+    uint16_t  pending_regs;          // destinations of the waiting loads
+} MSHRFile;
+
+// Store buffer (store_buffer > 0): stores retire into it from MEM and drain
+// to the D-cache in the background, oldest entry first.  An entry holds the
+// words stored to one block; a later store to that block joins it while it
+// waits, and a load of a buffered word is forwarded from it.
+#define MAX_STORE_BUFFER 16
+#define SB_WORDS         16          // words one entry can hold
+
+typedef struct {
+    uint16_t block;                  // first address covered
+    uint16_t pc;                     // last store into it, for the prefetcher
+    uint32_t mask;                   // words written, bit n for block + n
+    uint16_t val[SB_WORDS];
+} StoreEntry;
+
+typedef struct {
+    StoreEntry entry[MAX_STORE_BUFFER];  // entry[0..used), oldest first
+    uint16_t   used;
+    bool       draining;             // entry[0] is being written
+    uint64_t   ready;                // cycle that write completes
+} StoreBuffer;
+
+typedef struct ThreadedCode ThreadedCode;   // functional.c
+// Order a block fill streams over the memory bus (bus_width > 0), and when
+// the requester can go on.
+enum {
+    FILL_BLOCK,     // in address order; the requester waits for the whole block
+    FILL_EARLY,     // in address order; it goes on once its word's beat arrives
+    FILL_CWF,       // critical word first: its word's beat is sent first
+    FILL_ORDERS
+};
+
+// The last demand fill streamed into an L1: a hit on a word of it that has
+// not arrived yet waits for its beat.
+typedef struct {
+    bool     valid;
+    uint16_t address;       // the word the requester missed on
+    uint16_t block;         // first address of the transfer
+    uint16_t words;
+    uint64_t start;         // cycle the transfer started
+} BusFill;
+
+typedef struct JitState JitState;       // jit.c
+typedef struct Prefetcher Prefetcher;   // prefetch.h
+
+// Everything one simulated machine owns.  Every stage takes the context it
+// runs on, so independent machines can live side by side in one process
+// (and on different threads -- only the trace knobs are shared).
+struct SimContext {
+    SimConfig      config;
+    REGISTERS     *registers;
+    DRAM           dram;
+    Cache         *cache;         // data cache, or the shared one when not split
+    Cache         *icache;        // split L1 instruction cache, else NULL
+    Cache         *l2;            // unified L2 behind the L1s, else NULL
+    Prefetcher    *prefetch;      // prefetchers filling cache and icache, else NULL
+    Prefetcher    *iprefetch;
+    PipelineState  pipeline;
+
+    // EX → WB branch hand-off
+    bool           branch_taken;
+    uint16_t       branch_target_address;
+
+    // hazard unit
+    bool           data_hazard_stall;
+    uint16_t       stall_cycles_remaining;
+
+    FetchState     fetch;
+    MemAccessState mem;
+    MSHRFile       mshr;
+    BranchPredictor bp;
+    StoreBuffer    sb;
+    bool           memory_operation_in_progress;   // long-latency op in MEM
+    uint64_t       dram_busy_until;   // cycle DRAM finishes queued write-backs
+    MemController  memctrl;           // DRAM request queue (memctrl knob)
+    uint64_t       bus_busy_until;    // cycle the memory bus finishes its last transfer
+    BusFill        bus_fill[2];       // streaming into cache [0] and icache [1]
+
+    // stepInstructions() state
+    uint16_t       step_instr_val;
+    int            step_cycle_cnt;
+    bool           step_init;
+
+    // last executeInstructions()/stepInstructions() dump, so the next one
+    // prints only what changed (DRAM and cache lines track their own changes)
+    uint16_t       reported_regs[16];
+    bool           reported;        // false: the next dump prints every register
+
+    SimStats       stats;
+    ThreadedCode  *threaded;      // runInterpreter's translated code, built on demand
+    JitState      *jit;           // runJit's native code cache, built on demand
+};
+
+// One key of the "config" command, arch16-run and arch16-sweep: the SimConfig
+// field it sets, how its value is parsed and clamped, and what a change to it
+// has to redo.
+enum {
+    KNOB_RESHAPE = 1 << 0,      // rebuild the caches
+    KNOB_RETIME  = 1 << 1,      // re-time the DRAM banks
+    KNOB_REQUEUE = 1 << 2,      // reset the memory controller
+    KNOB_RETRAIN = 1 << 3,      // reset the branch predictor
+    KNOB_ALIAS   = 1 << 4,      // another name for the knob before it: no sweep column
+    KNOB_HOST    = 1 << 5,      // how the host simulates, not the machine: not swept
+};
+
+typedef struct {
+    const char *name;
+    uint16_t    offset;                     // of the SimConfig field
+    bool        is_bool;                    // bool field, else uint16_t
+    uint8_t     flags;                      // KNOB_*
+    uint16_t    min, max;                   // values are clamped into [min, max]; max 0: none
+    const char *what;                       // named values: what they name, for errors
+    int         (*id)(const char *name);    //   name (or number) -> value, -1 if unknown
+    const char *(*name_of)(int value);      //   value -> name
+    void        (*echo)(SimContext *ctx);   // [CONFIG] report once set, NULL for none
+} ConfigKnob;
+
+extern const ConfigKnob config_knobs[];
+extern const int config_knob_count;
 
 // Function declarations
-void init_system();
-void executeInstructions();
+SimContext *init_context(void);
+void destroy_context(SimContext *ctx);
+void init_system(SimContext *ctx);
+void executeInstructions(SimContext *ctx);
+uint64_t runPipeline(SimContext *ctx, uint64_t max_cycles);
+uint64_t resumePipeline(SimContext *ctx, uint64_t max_cycles);
+uint64_t drainPipeline(SimContext *ctx);
+uint64_t runFunctional(SimContext *ctx, uint64_t max_instructions, int32_t stop_pc);
+uint64_t runInterpreter(SimContext *ctx, uint64_t max_instructions, int32_t stop_pc);
+uint64_t runJit(SimContext *ctx, uint64_t max_instructions, int32_t stop_pc);
+void free_threaded_code(SimContext *ctx);
+void free_jit(SimContext *ctx);
 bool pipeline_empty(PipelineState* pipeline);
-void stepInstructions();
-void storeInstruction(const char *command);
+void stepInstructions(SimContext *ctx);
+void storeInstruction(SimContext *ctx, const char *command);
+int  loadProgram(SimContext *ctx, const char *path);
+void print_config_keys(FILE *out, bool sweepable);
+bool checkGeometry(const SimConfig *cfg);
+bool checkConfig(const SimConfig *cfg, const char *params);
+bool applyConfig(SimContext *ctx, const char *params);
+bool setConfig(SimContext *ctx, const SimConfig *cfg);
+const ConfigKnob *config_knob(const char *name);
+bool knob_parse(const ConfigKnob *k, const char *text, uint16_t *v);
+void knob_set(SimConfig *cfg, const ConfigKnob *k, uint16_t v);
+uint16_t knob_get(const SimConfig *cfg, const ConfigKnob *k);
+void rebuildCache(SimContext *ctx);
+void flushCache(SimContext *ctx);
+uint16_t dramDelay(SimContext *ctx, Cache *cache, uint16_t address, int source, uint16_t lead);
+uint16_t missDelay(SimContext *ctx, Cache *cache, uint16_t address, int source);
+uint16_t hitDelay(SimContext *ctx, Cache *cache, uint16_t address, uint16_t delay);
+uint64_t busTransfer(SimContext *ctx, Cache *cache, uint16_t address, uint64_t ready, bool demand);
+int fill_order_id(const char *name);
+const char *fill_order_name(int order);
+void chargeWritebacks(SimContext *ctx);
+void loadImage(SimContext *ctx, const uint16_t *image, int words);
 
-#endif // SIMULATOR_H 
\ No newline at end of file
+#endif // SIMULATOR_H 
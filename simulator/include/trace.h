@@ -0,0 +1,50 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// Trace categories.  One bit each so they can be OR'd into TRACE_MASK.
+#define TRACE_PIPELINE  (1u << 0)   // stage summaries, fetch / branch chatter
+#define TRACE_CACHE     (1u << 1)   // cache lookups, fills, evictions
+#define TRACE_HAZARD    (1u << 2)   // stall decisions made by the hazard unit
+#define TRACE_FORWARD   (1u << 3)   // values bypassed into the register file
+#define TRACE_MEM       (1u << 4)   // MEM stage and DRAM traffic
+#define TRACE_ASM       (1u << 5)   // assembler parse / encode chatter
+#define TRACE_ALL       0x3Fu
+
+// Trace levels.  INFO is what the GUI parses ([PIPELINE], [CACHE], [MEM]...),
+// DEBUG is everything else the stages like to say about themselves.
+#define TRACE_LEVEL_OFF   0
+#define TRACE_LEVEL_INFO  1
+#define TRACE_LEVEL_DEBUG 2
+
+// Compile-time ceiling.  Build with -DTRACE_MAX_LEVEL=0 and every TRACE()
+// call folds to nothing; the default keeps all output available at run time.
+#ifndef TRACE_MAX_LEVEL
+#define TRACE_MAX_LEVEL TRACE_LEVEL_DEBUG
+#endif
+
+// Run-time knobs (globals.c).  Change them through trace_configure() so the
+// pre-computed trace_flags stay in sync.
+extern uint16_t TRACE_LEVEL;
+extern uint16_t TRACE_MASK;
+extern uint16_t trace_flags;     // bits [5:0] INFO categories, [13:8] DEBUG
+
+void trace_configure(uint16_t level, uint16_t mask);
+
+#define TRACE_BIT(cat, lvl) ((uint16_t)((cat) << (((lvl) - 1) * 8)))
+
+// A single load + test + predictable branch per call site.
+#define TRACE_ON(cat, lvl) \
+    ((lvl) <= TRACE_MAX_LEVEL && (trace_flags & TRACE_BIT(cat, lvl)))
+
+#define TRACE(cat, lvl, ...) \
+    do { if (TRACE_ON(cat, lvl)) printf(__VA_ARGS__); } while (0)
+
+// Only build a display string when somebody is going to print it.
+#define TRACE_FMT(buf, cat, lvl, ...) \
+    do { if (TRACE_ON(cat, lvl)) snprintf(buf, sizeof(buf), __VA_ARGS__); } while (0)
+
+#endif
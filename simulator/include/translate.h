@@ -0,0 +1,35 @@
+#ifndef TRANSLATE_H
+#define TRANSLATE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "simulator.h"
+
+// Static translation of an assembled DRAM image to C (arch16-aot).
+//
+// The generated unit exports the image it was built from and
+//
+//   int arch16_run(uint16_t R[16], uint16_t *mem, uint64_t max_instructions,
+//                  uint64_t *executed);
+//
+// with runInterpreter()'s semantics (max_instructions 0 = no limit).  It
+// returns 1 when execution leaves the translated image -- a store that
+// changes one of its words, or a jump into other memory -- and the caller
+// has to finish on the interpreter from R[15].
+
+typedef struct TranslatedProgram TranslatedProgram;
+
+// Write the C translation of image[0, words) to out.  source names the
+// program in the header comment.  Returns 0, or -1 on a write error.
+int translateImage(const uint16_t *image, int words, const char *source, FILE *out);
+
+// dlopen a compiled translation; NULL (with a message on stderr) on failure.
+TranslatedProgram *loadTranslated(const char *so_path);
+void unloadTranslated(TranslatedProgram *tp);
+
+// Run ctx from R15 on the translation, falling back to runFunctional() when
+// DRAM no longer holds the translated image or the translation bails out.
+// Stores keep any resident cache line current.  Returns the instruction count.
+uint64_t runTranslated(SimContext *ctx, TranslatedProgram *tp, uint64_t max_instructions);
+
+#endif
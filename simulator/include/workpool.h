@@ -0,0 +1,17 @@
+#ifndef WORKPOOL_H
+#define WORKPOOL_H
+
+#include <stddef.h>
+
+// Called once per task index in [0, ntasks), from whichever worker got it.
+typedef void (*WorkFn)(void *arg, size_t index);
+
+// Run ntasks tasks on nthreads workers (0 = one per online core) and return
+// when all of them are done.  Tasks are dealt round-robin into per-worker
+// deques; a worker pops from the back of its own and, once that is empty,
+// steals from the front of the others.
+void workpool_run(size_t ntasks, unsigned nthreads, WorkFn fn, void *arg);
+
+unsigned workpool_default_threads(void);
+
+#endif
@@ -6,6 +6,6 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-void write_back(PipelineState *pipeline);
+void write_back(SimContext *ctx);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,186 @@
+// aot.c – static translator: ARCH-16 program → C → native shared object.
+//
+//   arch16-aot [-o stem] [-E] [-r] [-c] [-m max_cycles] [key=value ...] program.txt
+//
+// Assembles the program, writes its C translation to stem.c (default "aot")
+// and builds stem.so with the host compiler ($ARCH16_CC, else $CC, else cc).
+// -E stops after writing the C file.  -r loads the shared object, runs the
+// program on it and reports the result and the translated throughput.  -c
+// also runs the cycle-accurate pipeline (configured by the key=value knobs,
+// as in arch16-run) and compares R0-R14 and DRAM against the translation;
+// the exit status is 1 on any difference.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include "memory.h"
+#include "simulator.h"
+#include "assembler.h"
+#include "translate.h"
+#include "trace.h"
+
+#define MIN_BENCH_SECONDS 0.2
+
+static void usage(const char *prog) {
+    fflush(stdout);     // after any [CONFIG] complaint
+    fprintf(stderr, "usage: %s [-o stem] [-E] [-r] [-c] [-m max_cycles] [key=value ...] program.txt\n"
+                    "keys:", prog);
+    print_config_keys(stderr, false);
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int compile_shared(const char *c_path, const char *so_path) {
+    const char *cc = getenv("ARCH16_CC");
+    if (!cc || !*cc) cc = getenv("CC");
+    if (!cc || !*cc) cc = "cc";
+
+    char cmd[1024];
+    if (snprintf(cmd, sizeof cmd, "%s -O2 -w -shared -fPIC -o '%s' '%s'", cc, so_path, c_path)
+        >= (int)sizeof cmd) {
+        fprintf(stderr, "arch16-aot: compiler command too long\n");
+        return -1;
+    }
+    int rc = system(cmd);
+    if (rc != 0) fprintf(stderr, "arch16-aot: '%s' failed\n", cmd);
+    return rc;
+}
+
+// Fresh context holding the program, PC at 0.
+static SimContext *load_context(const uint16_t *image, int words, const char *params) {
+    SimContext *ctx = init_context();
+    if (params[0]) applyConfig(ctx, params);
+    loadImage(ctx, image, words);
+    ctx->registers->R[15] = 0;
+    return ctx;
+}
+
+int main(int argc, char **argv) {
+    const char *path = NULL;
+    const char *stem = "aot";
+    bool emit_only = false, run = false, check = false;
+    uint64_t max_cycles = 0;
+    char params[512] = "";
+
+    trace_configure(TRACE_LEVEL_OFF, TRACE_ALL);
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            stem = argv[++i];
+        } else if (strcmp(argv[i], "-E") == 0) {
+            emit_only = true;
+        } else if (strcmp(argv[i], "-r") == 0) {
+            run = true;
+        } else if (strcmp(argv[i], "-c") == 0) {
+            run = check = true;
+        } else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            max_cycles = strtoull(argv[++i], NULL, 0);
+        } else if (strchr(argv[i], '=')) {
+            strncat(params, " ", sizeof(params) - strlen(params) - 1);
+            strncat(params, argv[i], sizeof(params) - strlen(params) - 1);
+        } else if (!path) {
+            path = argv[i];
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    SimConfig defaults = default_config();
+    if (!path || (emit_only && run) || (params[0] && !checkConfig(&defaults, params))) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    uint16_t image[DRAM_SIZE];
+    int words = assembleFile(path, image, DRAM_SIZE);
+    if (words < 0) {
+        fprintf(stderr, "%s: cannot open %s\n", argv[0], path);
+        return 1;
+    }
+
+    char c_path[512], so_path[512];
+    snprintf(c_path, sizeof c_path, "%s.c", stem);
+    snprintf(so_path, sizeof so_path, "%s%s.so", strchr(stem, '/') ? "" : "./", stem);
+
+    FILE *out = fopen(c_path, "w");
+    if (!out) {
+        perror(c_path);
+        return 1;
+    }
+    int werr = translateImage(image, words, path, out);
+    if (fclose(out) != 0 || werr != 0) {
+        perror(c_path);
+        return 1;
+    }
+    if (emit_only) return 0;
+    if (compile_shared(c_path, so_path) != 0) return 1;
+    if (!run) return 0;
+
+    TranslatedProgram *tp = loadTranslated(so_path);
+    if (!tp) return 1;
+
+    // Reference run.
+    SimContext *ctx = load_context(image, words, "");
+    uint64_t n = runTranslated(ctx, tp, 0);
+
+    // Throughput: repeat the whole program for a fraction of a second,
+    // timing only the translated runs.
+    SimContext *bench = load_context(image, words, "");
+    REGISTERS start = *bench->registers;
+    uint64_t total = 0;
+    int reps = 0;
+    double t = 0;
+    do {
+        *bench->registers = start;
+        clearMemory(&bench->dram);
+        loadImage(bench, image, words);
+        double t0 = now();
+        total += runTranslated(bench, tp, 0);
+        t += now() - t0;
+        reps++;
+    } while (t < MIN_BENCH_SECONDS && reps < 10000000);
+    destroy_context(bench);
+
+    printf("program:      %s (%d words)\n", path, words);
+    printf("translated:   %llu instructions\n", (unsigned long long)n);
+    printf("throughput:   %.1f M instr/s (%d runs)\n", total / t / 1e6, reps);
+    printf("registers:   ");
+    for (int i = 0; i < 16; i++)
+        printf(" R%d=%u", i, ctx->registers->R[i]);
+    printf("\n");
+
+    int status = 0;
+    if (check) {
+        SimContext *pipe = load_context(image, words, params);
+        resumePipeline(pipe, max_cycles);
+
+        int diffs = 0;
+        for (int i = 0; i < 15; i++) {
+            if (pipe->registers->R[i] != ctx->registers->R[i]) {
+                printf("  R%d: pipeline=%u translated=%u\n", i, pipe->registers->R[i], ctx->registers->R[i]);
+                diffs++;
+            }
+        }
+        for (int addr = 0; addr < DRAM_SIZE; addr++) {
+            if (pipe->dram.memory[addr] != ctx->dram.memory[addr]) {
+                printf("  mem[%d]: pipeline=%u translated=%u\n",
+                       addr, pipe->dram.memory[addr], ctx->dram.memory[addr]);
+                diffs++;
+            }
+        }
+        printf("check:        %s (%llu cycles)\n", diffs ? "MISMATCH" : "match",
+               (unsigned long long)pipe->stats.cycles);
+        status = diffs ? 1 : 0;
+        destroy_context(pipe);
+    }
+
+    destroy_context(ctx);
+    unloadTranslated(tp);
+    return status;
+}
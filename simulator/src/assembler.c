@@ -6,13 +6,14 @@
 #include <stdint.h>
 #include <string.h>
 #include "assembler.h"
+#include "trace.h"
 
 // Each function will take in its own type and make the binary encoding.
 // This uses the bit operation of & to check the opcode to 00001111, this not
 // only ensures this field is 4 bits, but also copys the code correctly. Then
 // we shift those copied 4 bits to the top 4 bits of the encoded number.
 uint16_t RRRTypeEncode(RRRinstr *instr){
- printf("Passed instruction: opcode=%u, regD=%u, regA=%u, regB=%u\n",
+ TRACE(TRACE_ASM, TRACE_LEVEL_DEBUG, "Passed instruction: opcode=%u, regD=%u, regA=%u, regB=%u\n",
           instr->opcode, instr->regD, instr->regA, instr->regB);
 
  uint16_t encoded = 0;
@@ -25,7 +26,7 @@ uint16_t RRRTypeEncode(RRRinstr *instr){
 }
 
 uint16_t RRTypeEncode(RRinstr *instr){
- printf("Passed instruction: opcode=%u, type=%u, regA=%u, regB=%u\n",
+ TRACE(TRACE_ASM, TRACE_LEVEL_DEBUG, "Passed instruction: opcode=%u, type=%u, regA=%u, regB=%u\n",
           instr->opcode, instr->type, instr->regA, instr->regB);
 
  uint16_t encoded = 0;
@@ -38,7 +39,7 @@ uint16_t RRTypeEncode(RRinstr *instr){
 }
 
 uint16_t RRITypeEncode(RRIinstr *instr){
- printf("Passed instruction: opcode=%u, regD=%u, regA=%u, imm=%u\n",
+ TRACE(TRACE_ASM, TRACE_LEVEL_DEBUG, "Passed instruction: opcode=%u, regD=%u, regA=%u, imm=%u\n",
           instr->opcode, instr->regD, instr->regA, instr->imm);
 
  uint16_t encoded = 0;
@@ -50,6 +51,23 @@ uint16_t RRITypeEncode(RRIinstr *instr){
  return encoded;
 }
 
+// Assemble a whole program file, one line per word (blank lines become NOPs,
+// just like the GUI loader).  Returns the number of words written to image,
+// or -1 if the file cannot be opened.
+int assembleFile(const char *path, uint16_t *image, int capacity){
+  FILE *f = fopen(path, "r");
+  if (!f) return -1;
+
+  char line[256];
+  int  words = 0;
+  while (words < capacity && fgets(line, sizeof(line), f)) {
+    line[strcspn(line, "\r\n")] = 0;
+    image[words++] = loadInstruction(line + strspn(line, " \t"));
+  }
+  fclose(f);
+  return words;
+}
+
 // We will from UI call to this for each line, and directly save to DRAM from 
 uint16_t loadInstruction(const char *line){
   // Get the opcode, assembly.
@@ -78,7 +96,7 @@ uint16_t loadInstruction(const char *line){
     return 0;
   }
 
-  printf("Instruction Line: %s.\n", lineCopy);
+  TRACE(TRACE_ASM, TRACE_LEVEL_DEBUG, "Instruction Line: %s.\n", lineCopy);
 
   // First, replace commas with spaces for consistent parsing
   for (int i = 0; lineCopy[i]; i++) {
@@ -115,8 +133,8 @@ uint16_t loadInstruction(const char *line){
           rri.regA = ra;
           rri.imm = imm & 0xF; // Limit to 4 bits but allow parsing larger values
           
-          printf("Parsing LW: LW R%d, [R%d + %d]\n", rd, ra, imm);
-          printf("Encoded as: destination=R%u, base=R%u, offset=%u (truncated to %u for encoding)\n", 
+          TRACE(TRACE_ASM, TRACE_LEVEL_DEBUG, "Parsing LW: LW R%d, [R%d + %d]\n", rd, ra, imm);
+          TRACE(TRACE_ASM, TRACE_LEVEL_DEBUG, "Encoded as: destination=R%u, base=R%u, offset=%u (truncated to %u for encoding)\n", 
                  rd, ra, imm, rri.imm);
           return RRITypeEncode(&rri);
         }
@@ -148,8 +166,8 @@ uint16_t loadInstruction(const char *line){
           rri.regA = ra;
           rri.imm = imm & 0xF; // Limit to 4 bits but allow parsing larger values
           
-          printf("Parsing SW: SW [R%d + %d], R%d\n", ra, imm, rd);
-          printf("Encoded as: source=R%u, base=R%u, offset=%u (truncated to %u for encoding)\n", 
+          TRACE(TRACE_ASM, TRACE_LEVEL_DEBUG, "Parsing SW: SW [R%d + %d], R%d\n", ra, imm, rd);
+          TRACE(TRACE_ASM, TRACE_LEVEL_DEBUG, "Encoded as: source=R%u, base=R%u, offset=%u (truncated to %u for encoding)\n", 
                  rd, ra, imm, rri.imm);
           return RRITypeEncode(&rri);
         }
@@ -159,15 +177,17 @@ uint16_t loadInstruction(const char *line){
 
   // Standard parsing for other instructions
   char *values[4];
-  char *value = strtok(lineCopy, " ");
+  // (split by hand rather than strtok so several simulators can assemble at once)
+  char *cursor = lineCopy;
   uint16_t valueCount = 0;
 
-  while (value != NULL && valueCount < 4) {
+  while (*cursor != '\0' && valueCount < 4) {
     // Skip any extra spaces created by the comma replacement
-    if (value[0] != '\0') {
-      values[valueCount++] = value;
-    }
-    value = strtok(NULL, " ");
+    cursor += strspn(cursor, " ");
+    if (*cursor == '\0') break;
+    values[valueCount++] = cursor;
+    cursor += strcspn(cursor, " ");
+    if (*cursor != '\0') *cursor++ = '\0';
   }
 
   if (valueCount >= 1) {
@@ -187,8 +207,8 @@ uint16_t loadInstruction(const char *line){
       encoded |= (0xC & 0xF) << 12;  // opcode = 0xC (JMP)
       encoded |= (imm12 & 0xFFF);    // 12-bit immediate
       
-      printf("Parsing JMP: JMP %d\n", imm12);
-      printf("Encoded as: opcode=0xC, immediate=%u\n", imm12);
+      TRACE(TRACE_ASM, TRACE_LEVEL_DEBUG, "Parsing JMP: JMP %d\n", imm12);
+      TRACE(TRACE_ASM, TRACE_LEVEL_DEBUG, "Encoded as: opcode=0xC, immediate=%u\n", imm12);
       
       return encoded;
     }
@@ -221,7 +241,7 @@ uint16_t loadInstruction(const char *line){
       rrr.regA = ra;
       rrr.regB = rb;
       
-      printf("Parsing ADD: ADD R%d, R%d, R%d\n", rd, ra, rb);
+      TRACE(TRACE_ASM, TRACE_LEVEL_DEBUG, "Parsing ADD: ADD R%d, R%d, R%d\n", rd, ra, rb);
       return RRRTypeEncode(&rrr);
     } else if (strcmp(opcode, "SUB") == 0){
       rrr.opcode = 0b0001;
@@ -229,7 +249,7 @@ uint16_t loadInstruction(const char *line){
       rrr.regA = ra;
       rrr.regB = rb;
       
-      printf("Parsing SUB: SUB R%d, R%d, R%d\n", rd, ra, rb);
+      TRACE(TRACE_ASM, TRACE_LEVEL_DEBUG, "Parsing SUB: SUB R%d, R%d, R%d\n", rd, ra, rb);
       return RRRTypeEncode(&rrr);
     } else if (strcmp(opcode, "AND") == 0){
       rrr.opcode = 0b0010;
@@ -297,6 +317,6 @@ uint16_t loadInstruction(const char *line){
     }
   }
   
-  printf("Invalid instruction, [ %s ].\n", line);
+  TRACE(TRACE_ASM, TRACE_LEVEL_INFO, "Invalid instruction, [ %s ].\n", line);
   return 0;
 }
@@ -0,0 +1,119 @@
+// bpred.c – branch direction predictors consulted by the fetch stage (the
+// bpred knob).
+//
+// fetch_stage() asks for a direction when it brings in a BEQ or BLT, along
+// with the global history at that moment; execute() trains the predictor
+// with the same history once the branch resolves.  History and counters only
+// change at resolution, in program order, so a squashed wrong path leaves
+// no trace in them.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bpred.h"
+#include "simulator.h"
+#include "trace.h"
+
+typedef struct {
+    const char *name;
+    bool (*predict)(const BranchPredictor *bp, uint16_t pc, uint16_t target, uint16_t history);
+} PredictorKind;
+
+static bool counter_taken(uint8_t c) {
+    return c >= 2;
+}
+
+static void counter_train(uint8_t *c, bool up) {
+    if (up && *c < 3) (*c)++;
+    else if (!up && *c > 0) (*c)--;
+}
+
+static uint16_t gshare_index(const BranchPredictor *bp, uint16_t pc, uint16_t history) {
+    return (pc ^ history) & bp->mask;
+}
+
+static bool not_taken_predict(const BranchPredictor *bp, uint16_t pc, uint16_t target, uint16_t history) {
+    (void)bp; (void)pc; (void)target; (void)history;
+    return false;
+}
+
+static bool btfn_predict(const BranchPredictor *bp, uint16_t pc, uint16_t target, uint16_t history) {
+    (void)bp; (void)history;
+    return target <= pc;
+}
+
+static bool bimodal_predict(const BranchPredictor *bp, uint16_t pc, uint16_t target, uint16_t history) {
+    (void)target; (void)history;
+    return counter_taken(bp->bimodal[pc & bp->mask]);
+}
+
+static bool gshare_predict(const BranchPredictor *bp, uint16_t pc, uint16_t target, uint16_t history) {
+    (void)target;
+    return counter_taken(bp->gshare[gshare_index(bp, pc, history)]);
+}
+
+static bool tournament_predict(const BranchPredictor *bp, uint16_t pc, uint16_t target, uint16_t history) {
+    return counter_taken(bp->chooser[pc & bp->mask]) ? gshare_predict(bp, pc, target, history)
+                                                     : bimodal_predict(bp, pc, target, history);
+}
+
+static const PredictorKind kinds[BP_KINDS] = {
+    [BP_NONE]       = { "none",       not_taken_predict },
+    [BP_NOT_TAKEN]  = { "nottaken",   not_taken_predict },
+    [BP_BTFN]       = { "btfn",       btfn_predict },
+    [BP_BIMODAL]    = { "bimodal",    bimodal_predict },
+    [BP_GSHARE]     = { "gshare",     gshare_predict },
+    [BP_TOURNAMENT] = { "tournament", tournament_predict },
+};
+
+int bp_kind_id(const char *name) {
+    for (int k = 0; k < BP_KINDS; k++)
+        if (strcmp(name, kinds[k].name) == 0) return k;
+    char *end;
+    unsigned long k = strtoul(name, &end, 0);
+    return (*name && !*end && k < BP_KINDS) ? (int)k : -1;
+}
+
+const char *bp_kind_name(int kind) {
+    return (kind >= 0 && kind < BP_KINDS) ? kinds[kind].name : "?";
+}
+
+/**
+ * Size the tables from bpred_size (rounded down to a power of two) and
+ * reset every counter to weakly not taken and the history to empty.
+ * Called on a reset and whenever the bpred knobs change.
+ */
+void bp_configure(SimContext *ctx) {
+    BranchPredictor *bp = &ctx->bp;
+    uint16_t entries = 1;
+    while (entries * 2 <= ctx->config.bpred_size && entries < BP_MAX_ENTRIES) entries *= 2;
+    bp->mask    = entries - 1;
+    bp->history = 0;
+    memset(bp->bimodal, 1, sizeof(bp->bimodal));
+    memset(bp->gshare,  1, sizeof(bp->gshare));
+    memset(bp->chooser, 1, sizeof(bp->chooser));
+}
+
+// Whether the conditional branch at pc to target, fetched with the global
+// history history, is taken.
+bool bp_predict(SimContext *ctx, uint16_t pc, uint16_t target, uint16_t history) {
+    int kind = ctx->config.bpred < BP_KINDS ? ctx->config.bpred : BP_NONE;
+    return kinds[kind].predict(&ctx->bp, pc, target, history);
+}
+
+// Train on the outcome of the conditional branch at pc, predicted with
+// history, and shift the outcome into the global history.
+void bp_update(SimContext *ctx, uint16_t pc, uint16_t history, bool taken) {
+    BranchPredictor *bp = &ctx->bp;
+    uint8_t *bimodal = &bp->bimodal[pc & bp->mask];
+    uint8_t *gshare  = &bp->gshare[gshare_index(bp, pc, history)];
+    if (ctx->config.bpred == BP_TOURNAMENT) {
+        bool by_bimodal = counter_taken(*bimodal) == taken;
+        bool by_gshare  = counter_taken(*gshare) == taken;
+        if (by_bimodal != by_gshare) counter_train(&bp->chooser[pc & bp->mask], by_gshare);
+    }
+    counter_train(bimodal, taken);
+    counter_train(gshare, taken);
+    bp->history = (uint16_t)((bp->history << 1) | taken) & bp->mask;
+    TRACE(TRACE_PIPELINE, TRACE_LEVEL_DEBUG, "[BPRED] PC=%u %s, history now 0x%X\n",
+          pc, taken ? "taken" : "not taken", bp->history);
+}
@@ -0,0 +1,43 @@
+// disasm.c – turn a word back into assembler syntax via the predecode table.
+#include <stdio.h>
+#include <stdint.h>
+#include "decode_table.h"
+
+static const char *const mnemonic[H_COUNT] = {
+    [H_ADD] = "ADD", [H_SUB] = "SUB", [H_AND] = "AND", [H_OR]  = "OR",
+    [H_XOR] = "XOR", [H_DIVMOD] = "DIVMOD", [H_MUL] = "MUL", [H_CMP] = "CMP",
+    [H_BEQ] = "BEQ", [H_BLT] = "BLT",
+};
+
+// Output re-assembles to the same word (loadInstruction), so the pipeline
+// view reads like the source listing.
+void disassemble(uint16_t word, char *out, size_t len) {
+    const DecodedInstr *d = &decode_table[word];
+
+    switch (d->handler) {
+        case H_NOP:
+            snprintf(out, len, "NOP");
+            break;
+        case H_LSL: case H_LSR: case H_ROL: case H_ROR:
+            snprintf(out, len, "LSH %u, R%u, R%u", d->type, d->regD, d->regB);
+            break;
+        case H_LW:
+            snprintf(out, len, "LW R%u, [R%u + %u]", d->regD, d->regA, d->imm);
+            break;
+        case H_SW:
+            snprintf(out, len, "SW [R%u + %u], R%u", d->regA, d->imm, d->regD);
+            break;
+        case H_BEQ: case H_BLT:
+            snprintf(out, len, "%s R%u, R%u, %u", mnemonic[d->handler], d->regD, d->regA, d->imm);
+            break;
+        case H_JMP:
+            snprintf(out, len, "JMP %u", d->imm);
+            break;
+        case H_INVALID:
+            snprintf(out, len, "UNKNOWN 0x%04X", word);
+            break;
+        default:    // three-register ALU ops
+            snprintf(out, len, "%s R%u, R%u, R%u", mnemonic[d->handler], d->regD, d->regA, d->regB);
+            break;
+    }
+}
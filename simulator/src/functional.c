@@ -0,0 +1,283 @@
+// functional.c – ISA-level interpreter.
+//
+// Executes the same encodings as decode_stage / execute / write_back, one
+// instruction at a time: no latches, no hazard unit, no timing and no trace
+// output.  It works directly on the context's register file and DRAM, so a
+// run can hop between this and the cycle-accurate pipeline (see
+// drainPipeline / resumePipeline).  Caches are not warmed, but stores patch
+// any resident line so the pipeline never sees stale data after a switch.
+//
+// runFunctional() hands the work to the basic-block JIT (jit.c) when the
+// context allows it; runInterpreter() is the interpreter proper.
+//
+// With GCC/Clang the hot loop is threaded code: each DRAM word is translated
+// on first execution into a ThreadedOp (handler label + operands) and
+// dispatched with computed goto.  Other compilers, or builds with
+// ARCH16_THREADED_INTERP=OFF, use the plain switch loop.
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "memory.h"
+#include "decode_table.h"
+#include "simulator.h"
+
+#if defined(__GNUC__) && !defined(ARCH16_NO_THREADED)
+#define USE_THREADED 1
+#endif
+
+
+// Execute one predecoded instruction; R15 holds the fall-through PC while it
+// runs.  Returns the next PC.
+static inline uint16_t exec_one(uint16_t *r, uint16_t *mem, Cache *cache,
+                                uint16_t pc, const DecodedInstr *di) {
+    uint16_t d = di->regD, a = di->regA, b = di->regB;
+    uint16_t next = pc + 1;
+    r[15] = next;
+
+    switch (di->handler) {
+        case H_ADD:    r[d] = r[a] + r[b]; break;
+        case H_SUB:    r[d] = r[a] - r[b]; break;
+        case H_AND:    r[d] = r[a] & r[b]; break;
+        case H_OR:     r[d] = r[a] | r[b]; break;
+        case H_XOR:    r[d] = r[a] ^ r[b]; break;
+        case H_DIVMOD: r[d] = r[b] ? r[a] / r[b] : 0; break;     // quotient only, as in WB
+        case H_MUL:    r[d] = r[a] * r[b]; break;
+        case H_CMP:
+            r[14] = (int16_t)r[d] < (int16_t)r[a] ? 0xFFFF
+                  : r[d] == r[a]                  ? 0 : 1;
+            break;
+        // shifts: regD is the operand and destination, regB holds the amount
+        case H_LSL: r[d] = isa_lsl(r[d], r[b]); break;
+        case H_LSR: r[d] = isa_lsr(r[d], r[b]); break;
+        case H_ROL: r[d] = isa_rol(r[d], r[b]); break;
+        case H_ROR: r[d] = isa_ror(r[d], r[b]); break;
+        case H_LW: {
+            uint16_t addr = r[a] + di->imm;
+            r[d] = mem[addr];
+            break;
+        }
+        case H_SW: {
+            uint16_t addr = r[a] + di->imm;
+            mem[addr] = r[d];
+            if (cache) patch_cache(cache, addr, r[d]);
+            break;
+        }
+        case H_BEQ: if (r[d] == r[a]) next = pc + di->imm; break;
+        case H_JMP: next = di->imm; break;
+        case H_BLT: if ((int16_t)r[d] < (int16_t)r[a]) next = pc + di->imm; break;
+        default:    break;                          // unassigned opcodes
+    }
+
+    // An ALU write to R15 redirects like a jump.
+    return (!(di->flags & DI_BRANCH) && r[15] != next) ? r[15] : next;
+}
+
+// Run from R15 until a zero word (end of program), until the next instruction
+// would be stop_pc (ignored when negative), or until max_instructions have
+// executed (0 = no limit).  Returns the number of instructions executed.
+static uint64_t runSwitch(SimContext *ctx, uint64_t max_instructions, int32_t stop_pc) {
+    uint16_t *mem   = ctx->dram.memory;
+    Cache    *cache = ctx->cache;
+    uint16_t  r[16];
+    uint64_t  n = 0;
+
+    // Work on a private copy so the compiler can keep it away from DRAM aliasing.
+    for (int i = 0; i < 16; i++) r[i] = ctx->registers->R[i];
+    uint16_t pc = r[15];
+
+    while (!max_instructions || n < max_instructions) {
+        if ((int32_t)pc == stop_pc) break;
+
+        uint16_t ins = mem[pc];
+        if (ins == 0) break;                 // NOP / end of program
+
+        pc = exec_one(r, mem, cache, pc, &decode_table[ins]);
+        r[15] = pc;
+        n++;
+    }
+
+    for (int i = 0; i < 16; i++) ctx->registers->R[i] = r[i];
+    ctx->stats.functional_instructions += n;
+    return n;
+}
+
+#ifndef USE_THREADED
+
+uint64_t runInterpreter(SimContext *ctx, uint64_t max_instructions, int32_t stop_pc) {
+    return runSwitch(ctx, max_instructions, stop_pc);
+}
+
+void free_threaded_code(SimContext *ctx) {
+    (void)ctx;
+}
+
+#else
+
+// One translated DRAM word.
+typedef struct {
+    const void *handler;    // label in runInterpreter
+    uint16_t    imm;
+    uint8_t     d, a, b;
+} ThreadedOp;
+
+// One slot per PC, so dispatch needs no bounds checks.  DRAM may be written
+// by the pipeline, the JIT or the loader between calls, so each entry checks
+// the words translated so far against the copy they were built from.
+struct ThreadedCode {
+    ThreadedOp op[DRAM_SIZE];
+    uint16_t   shadow[DRAM_SIZE];   // DRAM word each slot was translated from
+    uint16_t   live[DRAM_SIZE];     // PCs translated at least once
+    uint8_t    listed[DRAM_SIZE];   // PC is in live[]
+    uint32_t   nlive;
+};
+
+void free_threaded_code(SimContext *ctx) {
+    free(ctx->threaded);
+    ctx->threaded = NULL;
+}
+
+// Same contract as the switch version above.
+uint64_t runInterpreter(SimContext *ctx, uint64_t max_instructions, int32_t stop_pc) {
+    static const void *const labels[H_COUNT] = {
+        [H_NOP] = &&op_halt,
+        [H_ADD] = &&op_add, [H_SUB] = &&op_sub, [H_AND] = &&op_and, [H_OR] = &&op_or,
+        [H_XOR] = &&op_xor, [H_DIVMOD] = &&op_divmod, [H_MUL] = &&op_mul, [H_CMP] = &&op_cmp,
+        [H_LSL] = &&op_lsl, [H_LSR] = &&op_lsr, [H_ROL] = &&op_rol, [H_ROR] = &&op_ror,
+        [H_LW]  = &&op_lw,  [H_SW]  = &&op_sw,
+        [H_BEQ] = &&op_beq, [H_JMP] = &&op_jmp, [H_BLT] = &&op_blt,
+        [H_INVALID] = &&op_next,
+    };
+
+    uint16_t     *mem   = ctx->dram.memory;
+    Cache        *cache = ctx->cache;
+    ThreadedCode *tc    = ctx->threaded;
+    uint16_t      r[16];
+
+    if (!tc) {
+        // no room for the slots: interpret with the switch loop instead
+        if (!(tc = ctx->threaded = malloc(sizeof *tc)))
+            return runSwitch(ctx, max_instructions, stop_pc);
+        for (uint32_t i = 0; i < DRAM_SIZE; i++) tc->op[i].handler = &&op_translate;
+        tc->nlive = 0;
+        memset(tc->listed, 0, sizeof tc->listed);
+    }
+    ThreadedOp *code = tc->op;
+
+    // Retranslate only the words that changed since the last call.
+    for (uint32_t i = 0; i < tc->nlive; i++) {
+        uint16_t at = tc->live[i];
+        if (mem[at] != tc->shadow[at]) code[at].handler = &&op_translate;
+    }
+
+    // stop_pc becomes a sentinel slot rather than a compare on every dispatch.
+    const void *stop_handler = &&op_stop;
+    if (stop_pc >= 0 && stop_pc < DRAM_SIZE) code[stop_pc].handler = stop_handler;
+
+    for (int i = 0; i < 16; i++) r[i] = ctx->registers->R[i];
+    uint16_t pc = r[15];
+
+    // `left` counts down the instruction budget.
+    uint64_t budget = max_instructions ? max_instructions : UINT64_MAX;
+    uint64_t left   = budget;
+    const ThreadedOp *op;
+
+#define DISPATCH()                                              \
+    do {                                                        \
+        if (left == 0) goto out;                                \
+        op = &code[pc];                                         \
+        goto *op->handler;                                      \
+    } while (0)
+#define NEXT()  do { pc++; left--; DISPATCH(); } while (0)
+
+    DISPATCH();
+
+op_translate: {
+        // Decode on first use and patch the slot.  Instructions that read or
+        // write R15 as a register go through exec_one so the hot handlers
+        // never have to keep R15 current.
+        const DecodedInstr *di = &decode_table[mem[pc]];
+        ThreadedOp *slot = &code[pc];
+        tc->shadow[pc] = mem[pc];
+        if (!tc->listed[pc]) {
+            tc->listed[pc] = 1;
+            tc->live[tc->nlive++] = pc;
+        }
+        slot->d   = di->regD;
+        slot->a   = di->regA;
+        slot->b   = di->regB;
+        slot->imm = di->imm;
+        slot->handler = ((di->src_mask | di->dst_mask) & 0x8000) ? &&op_slow : labels[di->handler];
+        goto *slot->handler;
+    }
+
+op_slow: {
+        const DecodedInstr *di = &decode_table[mem[pc]];
+        if (di->flags & DI_STORE) {
+            r[15] = pc + 1;                         // the base may be R15
+            uint16_t addr = r[di->regA] + di->imm;
+            code[addr].handler = (int32_t)addr == stop_pc ? stop_handler : &&op_translate;
+        }
+        pc = exec_one(r, mem, cache, pc, di);
+        left--;
+        DISPATCH();
+    }
+
+op_add:    r[op->d] = r[op->a] + r[op->b]; NEXT();
+op_sub:    r[op->d] = r[op->a] - r[op->b]; NEXT();
+op_and:    r[op->d] = r[op->a] & r[op->b]; NEXT();
+op_or:     r[op->d] = r[op->a] | r[op->b]; NEXT();
+op_xor:    r[op->d] = r[op->a] ^ r[op->b]; NEXT();
+op_divmod: r[op->d] = r[op->b] ? r[op->a] / r[op->b] : 0; NEXT();
+op_mul:    r[op->d] = r[op->a] * r[op->b]; NEXT();
+op_cmp:
+    r[14] = (int16_t)r[op->d] < (int16_t)r[op->a] ? 0xFFFF
+          : r[op->d] == r[op->a]                  ? 0 : 1;
+    NEXT();
+op_lsl:    r[op->d] = isa_lsl(r[op->d], r[op->b]); NEXT();
+op_lsr:    r[op->d] = isa_lsr(r[op->d], r[op->b]); NEXT();
+op_rol:    r[op->d] = isa_rol(r[op->d], r[op->b]); NEXT();
+op_ror:    r[op->d] = isa_ror(r[op->d], r[op->b]); NEXT();
+op_lw: {
+        uint16_t addr = r[op->a] + op->imm;
+        r[op->d] = mem[addr];
+        NEXT();
+    }
+op_sw: {
+        uint16_t addr = r[op->a] + op->imm;
+        mem[addr] = r[op->d];
+        if (cache) patch_cache(cache, addr, r[op->d]);
+        // self-modifying code
+        code[addr].handler = (int32_t)addr == stop_pc ? stop_handler : &&op_translate;
+        NEXT();
+    }
+op_beq:
+    if (r[op->d] == r[op->a]) { pc += op->imm; left--; DISPATCH(); }
+    NEXT();
+op_blt:
+    if ((int16_t)r[op->d] < (int16_t)r[op->a]) { pc += op->imm; left--; DISPATCH(); }
+    NEXT();
+op_jmp:
+    pc = op->imm; left--;
+    DISPATCH();
+op_next:
+    NEXT();
+
+op_halt:
+op_stop:
+out:
+#undef NEXT
+#undef DISPATCH
+    if (stop_pc >= 0 && stop_pc < DRAM_SIZE) code[stop_pc].handler = &&op_translate;
+    r[15] = pc;
+    for (int i = 0; i < 16; i++) ctx->registers->R[i] = r[i];
+    ctx->stats.functional_instructions += budget - left;
+    return budget - left;
+}
+
+#endif
+
+// Run from R15 with the JIT when enabled, else the interpreter.
+uint64_t runFunctional(SimContext *ctx, uint64_t max_instructions, int32_t stop_pc) {
+    if (ctx->config.jit_enabled) return runJit(ctx, max_instructions, stop_pc);
+    return runInterpreter(ctx, max_instructions, stop_pc);
+}
@@ -1,12 +1,109 @@
 /* globals.c – central home for run‑time flags */
 #include <stdint.h>
 #include <stdbool.h>
-
-bool     memory_operation_in_progress = false;
+#include "globals.h"
 
 uint16_t USER_DRAM_DELAY   = 4;      /* default 4  cycles */
 uint16_t USER_CACHE_DELAY  = 1;      /* default 1  cycle  */
 
 bool     PIPELINE_ENABLED  = true;   /* “Pipeline Enabled” check‑box  */
 bool     CACHE_ENABLED     = true;   /* “Cache Enabled”    check‑box  */
-uint16_t CACHE_MODE        = 2;      /*Set Associative*/
\ No newline at end of file
+uint16_t CACHE_MODE        = 2;      /*Set Associative*/
+uint16_t CACHE_WORDS       = 64;     /* cache capacity in words       */
+uint16_t CACHE_BLOCK       = 4;      /* words per cache line          */
+uint16_t CACHE_POLICY      = 0;      /* LRU replacement               */
+uint16_t CACHE_SEED        = 1;      /* random replacement seed       */
+bool     WRITE_BACK        = false;  /* write-through, no allocate    */
+bool     SPLIT_CACHE       = false;  /* one cache for code and data   */
+uint16_t ICACHE_WORDS      = 64;     /* split I-cache capacity        */
+uint16_t ICACHE_BLOCK      = 4;
+uint16_t ICACHE_WAYS       = 2;
+uint16_t USER_ICACHE_DELAY = 1;
+bool     L2_ENABLED        = false;  /* L1 misses go straight to DRAM */
+uint16_t L2_WORDS          = 512;    /* L2 capacity in words          */
+uint16_t L2_BLOCK          = 4;
+uint16_t L2_WAYS           = 4;
+uint16_t USER_L2_DELAY     = 2;
+uint16_t L2_POLICY         = 0;      /* LRU replacement               */
+uint16_t L2_INCLUSION      = 0;      /* non-inclusive, non-exclusive  */
+uint16_t MSHR_ENTRIES      = 0;      /* blocking loads                */
+uint16_t PREFETCHER        = 0;      /* demand fills only             */
+uint16_t PREFETCH_DEGREE   = 2;
+uint16_t VICTIM_ENTRIES    = 0;      /* no victim buffer              */
+uint16_t USER_VICTIM_DELAY = 1;
+uint16_t DRAM_BANKS        = 0;      /* flat USER_DRAM_DELAY per access */
+uint16_t DRAM_ROW_WORDS    = 64;
+uint16_t DRAM_TRCD         = 2;
+uint16_t DRAM_TCAS         = 2;
+uint16_t DRAM_TRP          = 2;
+uint16_t DRAM_TRAS         = 4;
+bool     DRAM_CLOSE_PAGE   = false;  /* open-page policy              */
+uint16_t MEM_CONTROLLER    = 0;      /* no request queue              */
+uint16_t STORE_BUFFER      = 0;      /* blocking stores               */
+uint16_t BRANCH_PREDICTOR  = 0;      /* squash after every branch     */
+uint16_t BPRED_ENTRIES     = 256;
+uint16_t BUS_WIDTH         = 0;      /* no bus model: whole-block fills */
+uint16_t BUS_BEAT          = 1;
+uint16_t FILL_ORDER        = 2;      /* critical word first           */
+bool     JIT_ENABLED       = true;   /* functional mode: native code   */
+
+uint16_t TRACE_LEVEL       = 2;      /* 0 = silent, 1 = GUI lines, 2 = debug */
+uint16_t TRACE_MASK        = 0x3F;   /* every category                       */
+uint16_t trace_flags       = 0x3F3F; /* derived from the two above           */
+
+/* Recompute the per-level category bits the TRACE() macro tests. */
+void trace_configure(uint16_t level, uint16_t mask) {
+    TRACE_LEVEL = level;
+    TRACE_MASK  = mask & 0x3F;
+    trace_flags = 0;
+    if (level >= 1) trace_flags |= TRACE_MASK;
+    if (level >= 2) trace_flags |= (uint16_t)(TRACE_MASK << 8);
+}
+
+/* Snapshot of the default knobs for a new SimContext. */
+SimConfig default_config(void) {
+    SimConfig cfg;
+    cfg.dram_delay       = USER_DRAM_DELAY;
+    cfg.cache_delay      = USER_CACHE_DELAY;
+    cfg.pipeline_enabled = PIPELINE_ENABLED;
+    cfg.cache_enabled    = CACHE_ENABLED;
+    cfg.cache_mode       = CACHE_MODE;
+    cfg.cache_size       = CACHE_WORDS;
+    cfg.cache_block      = CACHE_BLOCK;
+    cfg.cache_policy     = CACHE_POLICY;
+    cfg.cache_seed       = CACHE_SEED;
+    cfg.write_back       = WRITE_BACK;
+    cfg.split_cache      = SPLIT_CACHE;
+    cfg.icache_size      = ICACHE_WORDS;
+    cfg.icache_block     = ICACHE_BLOCK;
+    cfg.icache_ways      = ICACHE_WAYS;
+    cfg.icache_delay     = USER_ICACHE_DELAY;
+    cfg.l2_enabled       = L2_ENABLED;
+    cfg.l2_size          = L2_WORDS;
+    cfg.l2_block         = L2_BLOCK;
+    cfg.l2_ways          = L2_WAYS;
+    cfg.l2_delay         = USER_L2_DELAY;
+    cfg.l2_policy        = L2_POLICY;
+    cfg.l2_inclusion     = L2_INCLUSION;
+    cfg.mshrs            = MSHR_ENTRIES;
+    cfg.prefetch         = PREFETCHER;
+    cfg.prefetch_degree  = PREFETCH_DEGREE;
+    cfg.victims          = VICTIM_ENTRIES;
+    cfg.victim_delay     = USER_VICTIM_DELAY;
+    cfg.dram_banks       = DRAM_BANKS;
+    cfg.dram_row         = DRAM_ROW_WORDS;
+    cfg.dram_trcd        = DRAM_TRCD;
+    cfg.dram_tcas        = DRAM_TCAS;
+    cfg.dram_trp         = DRAM_TRP;
+    cfg.dram_tras        = DRAM_TRAS;
+    cfg.dram_close_page  = DRAM_CLOSE_PAGE;
+    cfg.memctrl          = MEM_CONTROLLER;
+    cfg.store_buffer     = STORE_BUFFER;
+    cfg.bpred            = BRANCH_PREDICTOR;
+    cfg.bpred_size       = BPRED_ENTRIES;
+    cfg.bus_width        = BUS_WIDTH;
+    cfg.bus_beat         = BUS_BEAT;
+    cfg.fill_order       = FILL_ORDER;
+    cfg.jit_enabled      = JIT_ENABLED;
+    return cfg;
+}
@@ -0,0 +1,384 @@
+// jit.c – basic-block translator for the functional core (x86-64).
+//
+// runJit() has the same contract as runInterpreter() but executes guest code
+// as native x86-64.  A basic block runs from its entry PC up to and including
+// the first BEQ / BLT / JMP (or an ALU write to R15, a zero word, the stop PC
+// or JIT_MAX_BLOCK instructions).  Blocks are emitted into one mmap'd code
+// cache and chained: an exit whose successor has been translated is patched
+// into a direct jump, so hot loops never come back to C.
+//
+// Guest registers stay in the context's REGISTERS struct, pinned in rbx.  The
+// other callee-saved registers hold DRAM (r12), the instruction budget (r13),
+// a pointer to where the budget is written back (r14) and the "word belongs to
+// a block" map (r15).  Each block checks and charges its instruction count on
+// entry, so functional_instructions stays exact.  If the budget is too small
+// for the next block, the interpreter finishes the remainder.
+//
+// A store that hits a translated word leaves the block right after the store,
+// and the whole cache is flushed.  So is any DRAM change made outside
+// (loader, pipeline), which is detected on entry against a shadow copy of the
+// translated words.  Builds for other hosts, or with ARCH16_JIT=OFF, forward
+// to the interpreter.
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "memory.h"
+#include "decode_table.h"
+#include "simulator.h"
+
+#if defined(__x86_64__) && (defined(__unix__) || defined(__APPLE__)) && !defined(ARCH16_NO_JIT)
+#define USE_JIT 1
+#endif
+
+#ifndef USE_JIT
+
+uint64_t runJit(SimContext *ctx, uint64_t max_instructions, int32_t stop_pc) {
+    return runInterpreter(ctx, max_instructions, stop_pc);
+}
+
+void free_jit(SimContext *ctx) {
+    (void)ctx;
+}
+
+#else
+
+#include <sys/mman.h>
+
+#define JIT_CODE_SIZE  (4u << 20)
+#define JIT_MAX_BLOCK  64                   // guest instructions per block
+#define JIT_MAX_INSN   96                   // worst-case bytes per guest instruction
+#define JIT_MAX_SITES  (2 * DRAM_SIZE + 2)  // chainable exits (two per block at most)
+#define EXIT_SMC       (1ull << 63)         // block stored into translated code
+#define EXIT_SITE      0x7FFFFFFFu          // site field, wide enough for JIT_MAX_SITES
+
+// A block returns the next guest PC in bits 0-15 and, for an exit that can be
+// chained, its site number + 1 in bits 32-62.
+typedef uint64_t (*JitEntry)(uint16_t *regs, uint16_t *mem, uint64_t *left,
+                             const uint8_t *covered, const uint8_t *block);
+
+struct JitState {
+    uint8_t  *code;                     // RWX code cache
+    uint32_t  used;
+    uint32_t  epilogue;                 // offset of the shared block exit
+    uint32_t  base;                     // first byte after the entry / exit code
+    uint32_t  generation;               // bumped by every flush
+    Cache    *cache;                    // baked into the SW sequences
+    uint32_t  block[DRAM_SIZE];         // code offset of the block at a PC, 0 = none
+    uint8_t   length[DRAM_SIZE];        // its instruction count
+    uint8_t   covered[DRAM_SIZE];       // word is part of some block
+    uint16_t  shadow[DRAM_SIZE];        // DRAM contents the blocks were built from
+    uint16_t  starts[DRAM_SIZE];        // entry PCs of the translated blocks
+    uint32_t  nblocks;
+    uint32_t  site[JIT_MAX_SITES];      // code offsets of chainable exit stubs
+    uint32_t  nsites;
+};
+
+#define EMIT(...)                                               \
+    do {                                                        \
+        const uint8_t b_[] = { __VA_ARGS__ };                   \
+        memcpy(p, b_, sizeof b_);                               \
+        p += sizeof b_;                                         \
+    } while (0)
+
+static uint8_t *emit32(uint8_t *p, uint32_t v) { memcpy(p, &v, 4); return p + 4; }
+static uint8_t *emit64(uint8_t *p, uint64_t v) { memcpy(p, &v, 8); return p + 8; }
+
+// Host scratch registers (ModRM reg field).
+enum { EAX = 0, ECX = 1, EDX = 2 };
+
+// Guest register r lives at [rbx + 2r].
+#define LOADZX(h, r)  EMIT(0x0F, 0xB7, 0x43 | (h) << 3, 2 * (r))         // movzx h, word [rbx+2r]
+#define LOADSX(h, r)  EMIT(0x0F, 0xBF, 0x43 | (h) << 3, 2 * (r))         // movsx h, word [rbx+2r]
+#define STORE(h, r)   EMIT(0x66, 0x89, 0x43 | (h) << 3, 2 * (r))         // mov word [rbx+2r], h
+#define ALU16(op, r)  EMIT(0x66, (op), 0x43, 2 * (r))                    // op ax, word [rbx+2r]
+
+// mov rax, pc | tag; jmp epilogue.  Chainable stubs are recorded so the
+// first five bytes can later become a jmp straight to the successor.
+static uint8_t *emit_exit(JitState *js, uint8_t *p, uint16_t pc, bool chain, uint64_t tag) {
+    uint64_t v = pc | tag;
+    if (chain && js->nsites < JIT_MAX_SITES) {
+        js->site[js->nsites] = (uint32_t)(p - js->code);
+        v |= (uint64_t)++js->nsites << 32;
+    }
+    EMIT(0x48, 0xB8);
+    p = emit64(p, v);
+    EMIT(0xE9);
+    return emit32(p, js->epilogue - (uint32_t)(p + 4 - js->code));
+}
+
+static void jit_flush(JitState *js) {
+    js->used = js->base;
+    js->nsites = 0;
+    js->generation++;
+    for (uint32_t i = 0; i < js->nblocks; i++) {
+        uint16_t start = js->starts[i];
+        for (unsigned k = 0; k < js->length[start]; k++) js->covered[(uint16_t)(start + k)] = 0;
+        js->block[start] = 0;
+    }
+    js->nblocks = 0;
+}
+
+// True if DRAM no longer holds what some block was translated from.
+static bool jit_stale(const JitState *js, const uint16_t *mem) {
+    for (uint32_t i = 0; i < js->nblocks; i++) {
+        uint16_t start = js->starts[i];
+        for (unsigned k = 0; k < js->length[start]; k++) {
+            uint16_t pc = start + k;
+            if (mem[pc] != js->shadow[pc]) return true;
+        }
+    }
+    return false;
+}
+
+static JitState *jit_create(void) {
+    JitState *js = calloc(1, sizeof *js);
+    if (!js) return NULL;
+    js->code = mmap(NULL, JIT_CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (js->code == MAP_FAILED) {
+        free(js);
+        return NULL;
+    }
+
+    uint8_t *p = js->code;
+    // entry: save callee-saved registers, pin the state, jump to the block
+    EMIT(0x53, 0x55, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56, 0x41, 0x57);    // push rbx..r15
+    EMIT(0x48, 0x83, 0xEC, 0x08);                                        // sub rsp, 8 (align)
+    EMIT(0x48, 0x89, 0xFB);                                              // mov rbx, rdi  regs
+    EMIT(0x49, 0x89, 0xF4);                                              // mov r12, rsi  mem
+    EMIT(0x49, 0x89, 0xD6);                                              // mov r14, rdx  &left
+    EMIT(0x4C, 0x8B, 0x2A);                                              // mov r13, [rdx]
+    EMIT(0x49, 0x89, 0xCF);                                              // mov r15, rcx  covered
+    EMIT(0x41, 0xFF, 0xE0);                                              // jmp r8
+    // shared exit: write the budget back and return rax
+    js->epilogue = (uint32_t)(p - js->code);
+    EMIT(0x4D, 0x89, 0x2E);                                              // mov [r14], r13
+    EMIT(0x48, 0x83, 0xC4, 0x08);                                        // add rsp, 8
+    EMIT(0x41, 0x5F, 0x41, 0x5E, 0x41, 0x5D, 0x41, 0x5C, 0x5D, 0x5B);    // pop r15..rbx
+    EMIT(0xC3);                                                          // ret
+    js->base = (uint32_t)(p - js->code);
+
+    jit_flush(js);
+    return js;
+}
+
+// One non-branch instruction.  `left` is how many instructions of the block
+// follow this one (refunded if a store forces an early exit).
+static uint8_t *emit_insn(JitState *js, uint8_t *p, const DecodedInstr *di,
+                          uint16_t pc, unsigned left) {
+    uint8_t d = di->regD, a = di->regA, b = di->regB;
+
+    switch (di->handler) {
+        case H_ADD: LOADZX(EAX, a); ALU16(0x03, b); STORE(EAX, d); break;
+        case H_SUB: LOADZX(EAX, a); ALU16(0x2B, b); STORE(EAX, d); break;
+        case H_AND: LOADZX(EAX, a); ALU16(0x23, b); STORE(EAX, d); break;
+        case H_OR:  LOADZX(EAX, a); ALU16(0x0B, b); STORE(EAX, d); break;
+        case H_XOR: LOADZX(EAX, a); ALU16(0x33, b); STORE(EAX, d); break;
+        case H_MUL:
+            LOADZX(EAX, a); LOADZX(ECX, b);
+            EMIT(0x0F, 0xAF, 0xC1);                     // imul eax, ecx
+            STORE(EAX, d);
+            break;
+        case H_DIVMOD:                                  // quotient only, 0 on divide by zero
+            LOADZX(EAX, a); LOADZX(ECX, b);
+            EMIT(0x31, 0xD2);                           // xor edx, edx
+            EMIT(0x85, 0xC9, 0x74, 0x04);               // test ecx, ecx; jz .zero
+            EMIT(0xF7, 0xF1, 0xEB, 0x02);               // div ecx; jmp .store
+            EMIT(0x31, 0xC0);                           // .zero: xor eax, eax
+            STORE(EAX, d);                              // .store
+            break;
+        case H_CMP:                                     // R14 = -1 / 0 / 1
+            LOADSX(EAX, d); LOADSX(ECX, a);
+            EMIT(0x39, 0xC8);                           // cmp eax, ecx
+            EMIT(0x0F, 0x9F, 0xC2, 0x0F, 0x9C, 0xC1);   // setg dl; setl cl
+            EMIT(0x28, 0xCA, 0x0F, 0xBE, 0xD2);         // sub dl, cl; movsx edx, dl
+            STORE(EDX, 14);
+            break;
+        // shifts: regD is the operand and destination, regB holds the amount
+        // (isa_lsl() and friends: 16 or more clears, rotates go modulo 16)
+        case H_LSL:
+        case H_LSR:
+            LOADZX(EAX, d); LOADZX(ECX, b);
+            EMIT(0xD3, di->handler == H_LSL ? 0xE0 : 0xE8);         // shl/shr eax, cl
+            EMIT(0x31, 0xD2, 0x83, 0xF9, 0x10);                     // xor edx, edx; cmp ecx, 16
+            EMIT(0x0F, 0x43, 0xC2);                                 // cmovae eax, edx
+            STORE(EAX, d);
+            break;
+        case H_ROL:
+        case H_ROR:
+            LOADZX(EAX, d); LOADZX(ECX, b);
+            EMIT(0x83, 0xE1, 0x0F);                                 // and ecx, 15
+            EMIT(0x66, 0xD3, di->handler == H_ROL ? 0xC0 : 0xC8);   // rol/ror ax, cl
+            STORE(EAX, d);
+            break;
+        // DRAM spans all 64K words: the zero-extended address is always in range
+        case H_LW:
+            LOADZX(EAX, a);
+            EMIT(0x83, 0xC0, di->imm, 0x0F, 0xB7, 0xC0);            // add eax, imm; movzx eax, ax
+            EMIT(0x41, 0x0F, 0xB7, 0x14, 0x44);                     // movzx edx, word [r12+rax*2]
+            STORE(EDX, d);
+            break;
+        case H_SW:
+            LOADZX(EAX, a);
+            EMIT(0x83, 0xC0, di->imm, 0x0F, 0xB7, 0xC0);            // add eax, imm; movzx eax, ax
+            LOADZX(EDX, d);
+            EMIT(0x66, 0x41, 0x89, 0x14, 0x44);                     // mov word [r12+rax*2], dx
+            EMIT(0x89, 0xC5);                                       // mov ebp, eax
+            if (js->cache) {                                        // patch_cache(cache, addr, val)
+                EMIT(0x48, 0xBF);
+                p = emit64(p, (uint64_t)(uintptr_t)js->cache);      // mov rdi, cache
+                EMIT(0x89, 0xC6, 0x48, 0xB8);                       // mov esi, eax; mov rax, fn
+                p = emit64(p, (uint64_t)(uintptr_t)&patch_cache);
+                EMIT(0xFF, 0xD0);                                   // call rax
+            }
+            // self-modifying code: leave after the store and flush
+            EMIT(0x41, 0x80, 0x3C, 0x2F, 0x00);                     // cmp byte [r15+rbp], 0
+            EMIT(0x74, 0x13);                                       // je .done
+            EMIT(0x49, 0x83, 0xC5, left);                           // add r13, left
+            p = emit_exit(js, p, (uint16_t)(pc + 1), false, EXIT_SMC);
+            break;
+        default:                                                    // unassigned opcodes
+            break;
+    }
+    return p;
+}
+
+// Translate the block starting at pc.  The caller has checked that the
+// first word is executable and is not stop_pc.
+static uint32_t translate(JitState *js, const uint16_t *mem, uint16_t start, int32_t stop_pc) {
+    // Find the extent first: the budget check needs the count.
+    unsigned n = 0;
+    for (uint16_t pc = start; n < JIT_MAX_BLOCK; pc++) {
+        if (n > 0 && (int32_t)pc == stop_pc) break;
+        uint16_t w = mem[pc];
+        if (w == 0) break;
+        const DecodedInstr *di = &decode_table[w];
+        n++;
+        if (di->flags & DI_BRANCH) break;
+        if (di->dst_mask & 0x8000) break;                   // ALU write to R15
+    }
+
+    if (js->used + (n + 1) * JIT_MAX_INSN > JIT_CODE_SIZE) jit_flush(js);
+    uint32_t off = js->used;
+    uint8_t *p = js->code + off;
+
+    // cmp r13, n; jae .run; <exit to start>; .run: sub r13, n
+    EMIT(0x49, 0x83, 0xFD, n, 0x73, 0x0F);
+    p = emit_exit(js, p, start, false, 0);
+    EMIT(0x49, 0x83, 0xED, n);
+
+    uint16_t pc = start;
+    for (unsigned i = 0; i < n; i++, pc++) {
+        const DecodedInstr *di = &decode_table[mem[pc]];
+        js->covered[pc] = 1;
+        js->shadow[pc]  = mem[pc];
+
+        // R15 reads as the fall-through PC while the instruction runs.
+        if ((di->src_mask | di->dst_mask) & 0x8000) {
+            EMIT(0x66, 0xC7, 0x43, 2 * 15, (uint8_t)(pc + 1), (uint8_t)((pc + 1) >> 8));
+        }
+
+        switch (di->handler) {
+            case H_BEQ:
+                LOADZX(EAX, di->regD);
+                ALU16(0x3B, di->regA);                      // cmp ax, word [rbx+2a]
+                EMIT(0x75, 0x0F);                           // jne .fall
+                p = emit_exit(js, p, (uint16_t)(pc + di->imm), true, 0);
+                break;
+            case H_BLT:
+                LOADSX(EAX, di->regD); LOADSX(ECX, di->regA);
+                EMIT(0x39, 0xC8, 0x7D, 0x0F);               // cmp eax, ecx; jge .fall
+                p = emit_exit(js, p, (uint16_t)(pc + di->imm), true, 0);
+                break;
+            case H_JMP:
+                p = emit_exit(js, p, di->imm, true, 0);
+                break;
+            default:
+                p = emit_insn(js, p, di, pc, n - 1 - i);
+                break;
+        }
+
+        if (di->dst_mask & 0x8000) {
+            // The written value is the next PC either way.
+            EMIT(0x0F, 0xB7, 0x43, 2 * 15);                 // movzx eax, word [rbx+30]
+            EMIT(0xE9);
+            p = emit32(p, js->epilogue - (uint32_t)(p + 4 - js->code));
+        }
+    }
+    const DecodedInstr *last = &decode_table[mem[pc - 1]];
+    if (last->handler != H_JMP && !(last->dst_mask & 0x8000))
+        p = emit_exit(js, p, pc, true, 0);                  // fall through / not taken
+
+    js->block[start]  = off;
+    js->length[start] = (uint8_t)n;
+    js->starts[js->nblocks++] = start;
+    js->used = (uint32_t)(p - js->code);
+    return off;
+}
+
+// Point a chainable exit stub straight at a block.
+static void chain(JitState *js, uint32_t site, uint32_t target) {
+    uint8_t *p = js->code + js->site[site - 1];
+    EMIT(0xE9);
+    emit32(p, target - (js->site[site - 1] + 5));
+}
+
+void free_jit(SimContext *ctx) {
+    if (!ctx->jit) return;
+    munmap(ctx->jit->code, JIT_CODE_SIZE);
+    free(ctx->jit);
+    ctx->jit = NULL;
+}
+
+uint64_t runJit(SimContext *ctx, uint64_t max_instructions, int32_t stop_pc) {
+    if (!ctx->jit && !(ctx->jit = jit_create()))
+        return runInterpreter(ctx, max_instructions, stop_pc);
+
+    JitState *js  = ctx->jit;
+    uint16_t *r   = ctx->registers->R;
+    uint16_t *mem = ctx->dram.memory;
+
+    // Drop stale translations: another cache object, a stop PC inside
+    // translated code, or DRAM rewritten since the blocks were built.
+    if (js->cache != ctx->cache
+        || (stop_pc >= 0 && stop_pc < DRAM_SIZE && js->covered[stop_pc])
+        || jit_stale(js, mem)) {
+        jit_flush(js);
+        js->cache = ctx->cache;
+    }
+
+    uint64_t budget = max_instructions ? max_instructions : UINT64_MAX;
+    uint64_t left = budget, interpreted = 0;
+    uint16_t pc = r[15];
+    uint32_t site = 0;
+
+    while (left && (int32_t)pc != stop_pc && mem[pc] != 0) {
+        uint32_t gen = js->generation;
+        uint32_t off = js->block[pc];
+        if (!off) off = translate(js, mem, pc, stop_pc);
+
+        if (left < js->length[pc]) {
+            // Not enough budget for the whole block: finish instruction by instruction.
+            r[15] = pc;
+            interpreted = runInterpreter(ctx, left, stop_pc);
+            left -= interpreted;
+            pc = r[15];
+            break;
+        }
+        if (site && gen == js->generation) chain(js, site, off);
+
+        uint64_t res = ((JitEntry)(void *)js->code)(r, mem, &left, js->covered, js->code + off);
+        pc   = (uint16_t)res;
+        site = (uint32_t)(res >> 32) & EXIT_SITE;
+        if (res & EXIT_SMC) {
+            jit_flush(js);
+            site = 0;
+        }
+    }
+
+    r[15] = pc;
+    ctx->stats.functional_instructions += budget - left - interpreted;
+    return budget - left;
+}
+
+#endif
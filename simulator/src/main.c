@@ -0,0 +1,58 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+#include "memory.h"
+#include "simulator.h"
+#include "globals.h"
+
+// stdin protocol used by gui/api.py: one command per line, every reply ends
+// with an [END] marker.
+int main() {
+    SimContext *ctx = init_context();
+    char command[256];
+
+    while (fgets(command, sizeof(command), stdin)) {
+        command[strcspn(command, "\n")] = 0;
+        printf("[DEBUG] Received command: %s\n", command);
+        fflush(stdout);
+
+        if      (strncmp(command, "write", 5) == 0) storeInstruction(ctx, command);
+        else if (strncmp(command, "start", 5) == 0) executeInstructions(ctx);
+        else if (strncmp(command, "step", 4)  == 0) stepInstructions(ctx);
+        else if (strncmp(command, "reset", 5) == 0) {
+            init_system(ctx);
+            printf("[END]\n");
+            fflush(stdout);
+        }
+        else if (strncmp(command, "cfg", 3) == 0) {
+            uint16_t d, cd, ce, pe, cm;
+            if (sscanf(command + 3, " %hu %hu %hu %hu %hu", &d, &cd, &ce, &pe, &cm) == 5) {
+                SimConfig cfg = ctx->config;
+                cfg.dram_delay       = d;
+                cfg.cache_delay      = cd;
+                cfg.cache_enabled    = ce;
+                cfg.pipeline_enabled = pe;
+                cfg.cache_mode       = cm;
+                if (checkGeometry(&cfg)) {
+                    ctx->config = cfg;
+                    rebuildCache(ctx);
+                }
+            }
+            printf("[END]\n");
+            fflush(stdout);
+        }
+        else if (strncmp(command,"config",6) == 0) {
+            applyConfig(ctx, command+6);
+            printf("[END]\n");
+            fflush(stdout);
+        }
+        else {
+            printf("[DEBUG] Unknown command: %s\n", command);
+            fflush(stdout);
+        }
+    }
+    destroy_context(ctx);
+    return 0;
+}
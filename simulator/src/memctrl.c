@@ -0,0 +1,185 @@
+// memctrl.c – memory controller queue in front of the DRAM (the memctrl knob).
+//
+// Requests bound for DRAM are queued as they are made and issued at the end
+// of the cycle, at most one per cycle: under FCFS the oldest, once its bank
+// (or the flat DRAM) is free; under FR-FCFS the oldest request whose row is
+// already open in a free bank, else the oldest one on a free bank.  When a
+// request issues, its requester gets the cycle its data arrives: the fetch
+// and MEM stages a countdown target, an MSHR, the store buffer or a prefetch
+// its ready cycle.
+// Write-backs have nobody waiting but occupy their bank like the rest.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "memctrl.h"
+#include "prefetch.h"
+#include "simulator.h"
+#include "trace.h"
+
+static const char *const policies[MC_POLICIES] = { "none", "fcfs", "frfcfs" };
+static const char *const sources[MC_SOURCES] = { "fetch", "load", "store", "prefetch", "writeback" };
+
+int mc_policy_id(const char *name) {
+    for (int i = 0; i < MC_POLICIES; i++)
+        if (strcmp(name, policies[i]) == 0) return i;
+    char *end;
+    unsigned long i = strtoul(name, &end, 0);
+    return (*name && !*end && i < MC_POLICIES) ? (int)i : -1;
+}
+
+const char *mc_policy_name(int policy) {
+    return (policy >= 0 && policy < MC_POLICIES) ? policies[policy] : "?";
+}
+
+const char *mc_source_name(int source) {
+    return (source >= 0 && source < MC_SOURCES) ? sources[source] : "?";
+}
+
+// Time an access at once, as without a controller; returns its data cycle.
+static uint64_t issue_now(SimContext *ctx, uint16_t address) {
+    uint64_t now = ctx->stats.cycles;
+    if (ctx->dram.timing.banks) return dram_access(&ctx->dram, now, address);
+    uint64_t start = ctx->dram_busy_until > now ? ctx->dram_busy_until : now;
+    ctx->dram_busy_until = start + ctx->config.dram_delay;
+    return ctx->dram_busy_until;
+}
+
+static void queue_writeback(void *owner, uint16_t address) {
+    SimContext *ctx = owner;
+    if (!mc_submit(ctx, MC_WRITEBACK, address, NULL, 0))
+        issue_now(ctx, address);
+}
+
+/**
+ * Empty the queue and clear the counters, and route DRAM write-backs through
+ * the queue when the controller is on.  Called on a reset and whenever the
+ * memctrl knob changes.
+ */
+void mc_configure(SimContext *ctx) {
+    memset(&ctx->memctrl, 0, sizeof(ctx->memctrl));
+    bool on = ctx->config.memctrl != MC_NONE;
+    ctx->dram.writeback = on ? queue_writeback : NULL;
+    ctx->dram.owner     = on ? ctx : NULL;
+}
+
+/**
+ * Queue a DRAM access made this cycle by source.  lead is the time already
+ * spent above DRAM, added to the latency reported back; cache is the L1 the
+ * access fills, if any.  False when the controller is off or its queue is full:
+ * the caller then times the access itself.
+ */
+bool mc_submit(SimContext *ctx, int source, uint16_t address, Cache *cache, uint16_t lead) {
+    MemController *mc = &ctx->memctrl;
+    if (ctx->config.memctrl == MC_NONE) return false;
+    if (mc->queued == MC_QUEUE) {
+        mc->overflows++;
+        return false;
+    }
+    MemRequest *r = &mc->queue[mc->queued++];
+    r->address = address;
+    r->source  = source;
+    r->lead    = lead;
+    r->cache   = cache;
+    r->arrival = ctx->stats.cycles;
+    TRACE(TRACE_MEM, TRACE_LEVEL_DEBUG, "[MC_QUEUE] %s %u queued behind %u\n",
+          sources[source], address, mc->queued - 1);
+    return true;
+}
+
+// Drop the queued requests of source, e.g. a fetch abandoned by drainPipeline().
+void mc_cancel(SimContext *ctx, int source) {
+    MemController *mc = &ctx->memctrl;
+    uint16_t kept = 0;
+    for (uint16_t i = 0; i < mc->queued; i++)
+        if (mc->queue[i].source != source) mc->queue[kept++] = mc->queue[i];
+    mc->queued = kept;
+}
+
+static uint16_t countdown(uint64_t ready, uint64_t arrival) {
+    uint64_t target = ready - arrival;
+    return target >= MC_WAIT ? MC_WAIT - 1 : (uint16_t)target;
+}
+
+// A load miss waiting in an MSHR for r, or NULL for a blocking one in MEM.
+static MSHREntry *mshr_waiting(SimContext *ctx, const MemRequest *r) {
+    if (!ctx->cache) return NULL;
+    uint16_t block = r->address & ~(ctx->cache->block_size - 1);
+    for (int i = 0; i < ctx->mshr.used; i++) {
+        MSHREntry *e = &ctx->mshr.entry[i];
+        if (e->block == block && e->ready == UINT64_MAX) return e;
+    }
+    return NULL;
+}
+
+// Tell the requester of r that its data arrives at cycle ready.
+static void complete(SimContext *ctx, const MemRequest *r, uint64_t ready) {
+    MSHREntry *e;
+    switch (r->source) {
+    case MC_FETCH:
+        if (ctx->fetch.memory_busy && ctx->fetch.delay_target == MC_WAIT)
+            ctx->fetch.delay_target = countdown(ready, r->arrival);
+        break;
+    case MC_LOAD:
+    case MC_STORE:
+        if (r->source == MC_LOAD && (e = mshr_waiting(ctx, r)) != NULL)
+            e->ready = ready + 1;       // + the write-back cycle
+        else if (r->source == MC_STORE && ctx->sb.draining && ctx->sb.ready == UINT64_MAX)
+            ctx->sb.ready = ready;
+        else if (ctx->mem.busy && ctx->mem.target == MC_WAIT)
+            ctx->mem.target = countdown(ready, r->arrival);
+        break;
+    case MC_PREFETCH:
+        prefetch_ready(r->cache == ctx->icache ? ctx->iprefetch : ctx->prefetch, r->address, ready);
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * Issue at most one queued request to DRAM.  Called at the end of every
+ * cycle, after every stage has made its requests for it.
+ */
+void mc_tick(SimContext *ctx) {
+    MemController *mc   = &ctx->memctrl;
+    DRAM          *dram = &ctx->dram;
+    uint64_t       now  = ctx->stats.cycles;
+    if (!mc->queued) return;
+
+    int pick = -1;
+    if (!dram->timing.banks) {
+        // one flat DRAM and no rows to favour: the oldest, once it is idle
+        if (ctx->dram_busy_until <= now) pick = 0;
+    } else if (ctx->config.memctrl == MC_FCFS) {
+        if (dram_bank_ready(dram, mc->queue[0].address) <= now) pick = 0;
+    } else {
+        for (int i = 0; i < mc->queued; i++) {
+            uint16_t address = mc->queue[i].address;
+            if (dram_bank_ready(dram, address) > now) continue;
+            if (dram_row_open(dram, address)) {
+                if (i > 0) mc->row_first++;
+                pick = i;
+                break;
+            }
+            if (pick < 0) pick = i;
+        }
+    }
+    if (pick < 0) return;
+
+    MemRequest r = mc->queue[pick];
+    memmove(&mc->queue[pick], &mc->queue[pick + 1], (mc->queued - pick - 1) * sizeof(MemRequest));
+    mc->queued--;
+
+    uint32_t waited = (uint32_t)(now - r.arrival);
+    mc->requests[r.source]++;
+    mc->wait[r.source] += waited;
+    if (waited > mc->max_wait[r.source]) mc->max_wait[r.source] = waited;
+
+    uint64_t ready = issue_now(ctx, r.address);
+    if (r.source != MC_WRITEBACK)
+        ready = busTransfer(ctx, r.cache, r.address, ready, r.source != MC_PREFETCH);
+    ready += r.lead;
+    TRACE(TRACE_MEM, TRACE_LEVEL_DEBUG, "[MC_ISSUE] %s %u after %u cycles queued, ready at cycle %llu\n",
+          sources[r.source], r.address, waited, (unsigned long long)ready);
+    complete(ctx, &r, ready);
+}
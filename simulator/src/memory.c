@@ -4,6 +4,39 @@
 #include <string.h>
 #include "memory.h"
 #include "globals.h"
+#include "trace.h"
+
+// Whole-set cache operations (tag match, LRU/RRIP ageing, victim search) run
+// VLANES ways at a time when a set has at least that many: 16 with AVX2, 8
+// with SSE2.  -DARCH16_NO_SIMD keeps everything scalar.  Replacement state
+// stays below 32768, so the signed 16-bit compares are exact.
+#if !defined(ARCH16_NO_SIMD) && defined(__AVX2__)
+#include <immintrin.h>
+#define VLANES 16
+typedef __m256i vec16;
+#define v_load(p)      _mm256_loadu_si256((const __m256i *)(p))
+#define v_store(p, v)  _mm256_storeu_si256((__m256i *)(p), v)
+#define v_set1(x)      _mm256_set1_epi16((short)(x))
+#define v_eq(a, b)     _mm256_cmpeq_epi16(a, b)
+#define v_lt(a, b)     _mm256_cmpgt_epi16(b, a)
+#define v_andnot(a, b) _mm256_andnot_si256(a, b)
+#define v_sub(a, b)    _mm256_sub_epi16(a, b)
+#define v_max(a, b)    _mm256_max_epi16(a, b)
+#define v_mask(v)      ((unsigned)_mm256_movemask_epi8(v))
+#elif !defined(ARCH16_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+#include <emmintrin.h>
+#define VLANES 8
+typedef __m128i vec16;
+#define v_load(p)      _mm_loadu_si128((const __m128i *)(p))
+#define v_store(p, v)  _mm_storeu_si128((__m128i *)(p), v)
+#define v_set1(x)      _mm_set1_epi16((short)(x))
+#define v_eq(a, b)     _mm_cmpeq_epi16(a, b)
+#define v_lt(a, b)     _mm_cmplt_epi16(a, b)
+#define v_andnot(a, b) _mm_andnot_si128(a, b)
+#define v_sub(a, b)    _mm_sub_epi16(a, b)
+#define v_max(a, b)    _mm_max_epi16(a, b)
+#define v_mask(v)      ((unsigned)_mm_movemask_epi8(v))
+#endif
 
 // REGISTER FUNCTIONS
 REGISTERS *init_registers() {
@@ -26,28 +59,50 @@ REGISTERS *init_registers() {
 
 // DRAM FUNCTIONS
 
+// DRAM covers the whole 16-bit address space, so any uint16_t address is in
+// range and the accessors below need no checks.
+
 // A function to write into memory at a immediate address.
 void writeToMemory(DRAM *dram, uint16_t addr, int16_t data) {
-  if (addr < DRAM_SIZE) {
-    dram->memory[addr] = (int16_t) data;
-  }
+  dram->memory[addr] = (uint16_t) data;
+  markDirty(dram, addr);
 }
 
 // A function to read from a immediate address in memeory.
 uint16_t readFromMemory(DRAM *dram, uint16_t addr) {
-  if (addr < DRAM_SIZE) {
-      return dram->memory[addr];
-  } else {
-    printf("Error: Read address %u out of range\n", addr);
-    return 0;
-  }
+  return dram->memory[addr];
 }
 
 // A function to clear memory fully.
 void clearMemory(DRAM *dram){
-  for (int i = 0; i < DRAM_SIZE; i++){
-    dram->memory[i] = 0;
-  }
+  memset(dram->memory, 0, DRAM_SIZE * sizeof(uint16_t));
+  memset(dram->dirty, 0xFF, sizeof(dram->dirty));
+  dram->dirty_summary = ~0ull;
+}
+
+// Forget pending changes, e.g. once they have been reported.
+void clearDirty(DRAM *dram) {
+  memset(dram->dirty, 0, sizeof(dram->dirty));
+  dram->dirty_summary = 0;
+}
+
+// Page-aligned backing store for one DRAM (128 KiB).
+uint16_t *allocMemory(void) {
+#ifdef _WIN32
+  return _aligned_malloc(DRAM_SIZE * sizeof(uint16_t), 4096);
+#else
+  void *memory = NULL;
+  if (posix_memalign(&memory, 4096, DRAM_SIZE * sizeof(uint16_t)) != 0) return NULL;
+  return memory;
+#endif
+}
+
+void freeMemory(uint16_t *memory) {
+#ifdef _WIN32
+  _aligned_free(memory);
+#else
+  free(memory);
+#endif
 }
 
 // // A function to print off a block of memory.
@@ -77,141 +132,909 @@ void clearMemory(DRAM *dram){
  * @return The data at the specified address
  */
 uint16_t memory_read(Cache *cache, DRAM *dram, uint16_t address) {
-    if (address >= DRAM_SIZE) {
-        printf("Error: read address %u out-of-range.\n", address);
-        return 0;
-    }
-    
-    if (CACHE_ENABLED && cache != NULL) {
+    if (cache != NULL) {
         // Use cache for reads
         return read_cache(cache, dram, address);
     } else {
         // Direct DRAM read
-        printf("[MEM_READ] Cache disabled or not available, reading directly from DRAM\n");
+        TRACE(TRACE_MEM, TRACE_LEVEL_DEBUG, "[MEM_READ] Cache disabled or not available, reading directly from DRAM\n");
         return readFromMemory(dram, address);
     }
 }
 
 /**
- * @brief Writes to memory, using write-through if cache is available
+ * @brief Writes to memory, through the cache's write policy if available
  * @param cache The cache, can be NULL to bypass cache
  * @param dram The DRAM
  * @param address The address to write to
  * @param data The data to write
  */
 void memory_write(Cache *cache, DRAM *dram, uint16_t address, uint16_t data) {
-    if (address >= DRAM_SIZE) {
-        printf("Error: write address %u out-of-range.\n", address);
-        return;
-    }
-        
-    if (CACHE_ENABLED && cache != NULL) {
-        // Use write-through for cache writes
-        write_through(cache, dram, address, data);
+    if (cache != NULL) {
+        write_cache(cache, dram, address, data);
     } else {
         // Direct DRAM write
-        printf("[MEM_WRITE] Cache disabled or not available, writing directly to DRAM\n");
+        TRACE(TRACE_MEM, TRACE_LEVEL_DEBUG, "[MEM_WRITE] Cache disabled or not available, writing directly to DRAM\n");
         writeToMemory(dram, address, data);
     }
     
     // Print memory update for UI
-    printf("[MEM]%d:%d\n", address, data);
+    TRACE(TRACE_MEM, TRACE_LEVEL_INFO, "[MEM]%d:%d\n", address, data);
 }
 
-// Updated DRAM update function with cache support.
-void updateDRAM(DRAM *dram, Cache *cache) {
-    if (dram->state != DRAM_IDLE) {
-        // Decrement delay counter and respond with "wait".
-        if (dram->delayCounter > 0) {
-            dram->delayCounter--;
-        }
-        // When delay reaches 0, finish the access.
-        if (dram->delayCounter == 0) {
-            if (dram->pendingAddr >= DRAM_SIZE) {
-                printf("Error: address out-of-range.");
-            } else {
-                if (strcmp(dram->pendingCmd, "SW") == 0) {
-                    // Use the unified memory_write function
-                    memory_write(cache, dram, dram->pendingAddr, dram->pendingValue);
-                } else if (strcmp(dram->pendingCmd, "LW") == 0) {
-                    // Use the unified memory_read function
-                    memory_read(cache, dram, dram->pendingAddr);
-                } else {
-                    printf("Error: unknown DRAM command.");
-                }
-            }
-            // Reset DRAM state.
-            dram->state = DRAM_IDLE;
-            dram->pendingAddr = 0;
-            dram->pendingValue = 0;
-            strcpy(dram->pendingCmd, "");
+static uint16_t log2_exact(uint32_t v) {
+    uint16_t n = 0;
+    while ((1u << n) < v) n++;
+    return (1u << n) == v ? n : 0xFFFF;
+}
+
+// DRAM TIMING
+//
+// The words themselves move at once (readFromMemory/writeToMemory); the
+// banks only decide how many cycles each block transfer is charged.
+
+/**
+ * Switch to banked timing (timing->banks > 0) or back to the flat dram_delay,
+ * closing every row and clearing the row counters.  Returns false, leaving
+ * flat timing, when the banks or the row size are not powers of two.
+ */
+bool set_dram_timing(DRAM *dram, const DRAMTiming *timing) {
+    dram->timing = *timing;
+    memset(dram->bank, 0, sizeof(dram->bank));
+    dram->row_hits = dram->row_misses = dram->row_conflicts = 0;
+    if (!timing->banks) return true;
+
+    uint16_t bank_bits = log2_exact(timing->banks);
+    uint16_t row_bits  = log2_exact(timing->row_size);
+    if (bank_bits == 0xFFFF || row_bits == 0xFFFF || timing->banks > DRAM_MAX_BANKS) {
+        printf("Error: Invalid DRAM geometry: %u banks, %u-word rows "
+               "(powers of two, at most %u banks)\n", timing->banks, timing->row_size, DRAM_MAX_BANKS);
+        dram->timing.banks = 0;
+        return false;
+    }
+    dram->bank_shift = bank_bits;
+    dram->row_shift  = row_bits;
+    return true;
+}
+
+// dram_page policy names: 0 = open, 1 = closed.
+static const char *const page_policies[2] = { "open", "closed" };
+
+int dram_page_id(const char *name) {
+    for (int i = 0; i < 2; i++)
+        if (strcmp(name, page_policies[i]) == 0) return i;
+    char *end;
+    unsigned long i = strtoul(name, &end, 0);
+    return (*name && !*end && i < 2) ? (int)i : -1;
+}
+
+const char *dram_page_name(bool close_page) {
+    return page_policies[close_page];
+}
+
+// Bank and row of address under banked timing.
+static DRAMBank *bank_of(DRAM *dram, uint16_t address, uint16_t *bank, uint16_t *row) {
+    uint16_t row_id = address >> dram->row_shift;
+    *bank = row_id & (dram->timing.banks - 1);
+    *row  = row_id >> dram->bank_shift;
+    return &dram->bank[*bank];
+}
+
+// Cycle the bank holding address takes its next command (banked timing).
+uint64_t dram_bank_ready(DRAM *dram, uint16_t address) {
+    uint16_t bank, row;
+    return bank_of(dram, address, &bank, &row)->ready;
+}
+
+// True if address is in the row open in its bank (banked timing).
+bool dram_row_open(DRAM *dram, uint16_t address) {
+    uint16_t bank, row;
+    const DRAMBank *b = bank_of(dram, address, &bank, &row);
+    return b->state == DRAM_ACTIVE && b->row == row;
+}
+
+/**
+ * Schedule a block transfer at address, issued at cycle now, on its bank
+ * behind the commands already queued there.  Returns the cycle the data is
+ * ready; flat timing has no banks and returns now.
+ */
+uint64_t dram_access(DRAM *dram, uint64_t now, uint16_t address) {
+    const DRAMTiming *t = &dram->timing;
+    if (!t->banks) return now;
+
+    uint16_t  bank, row;
+    DRAMBank *b     = bank_of(dram, address, &bank, &row);
+    uint64_t  start = b->ready > now ? b->ready : now;
+    uint64_t  done;
+
+    if (b->state == DRAM_ACTIVE && b->row == row) {
+        dram->row_hits++;
+        done = start + t->tCAS;
+        TRACE(TRACE_MEM, TRACE_LEVEL_DEBUG, "[DRAM_ROW_HIT] Bank %u row %u\n", bank, row);
+    } else {
+        if (b->state == DRAM_ACTIVE) {
+            // close the open row, no sooner than tRAS after it was opened
+            uint64_t close = b->activated + t->tRAS > start ? b->activated + t->tRAS : start;
+            start = close + t->tRP;
+            dram->row_conflicts++;
+            TRACE(TRACE_MEM, TRACE_LEVEL_DEBUG, "[DRAM_ROW_CONFLICT] Bank %u row %u replaces row %u\n",
+                  bank, row, b->row);
+        } else {
+            dram->row_misses++;
+            TRACE(TRACE_MEM, TRACE_LEVEL_DEBUG, "[DRAM_ROW_MISS] Bank %u opens row %u\n", bank, row);
         }
+        b->row       = row;
+        b->activated = start;
+        done = start + t->tRCD + t->tCAS;
+    }
+    b->state = DRAM_ACTIVE;
+    b->ready = done;
+    if (t->close_page) {
+        uint64_t close = b->activated + t->tRAS > done ? b->activated + t->tRAS : done;
+        b->state = DRAM_PRECHARGE;
+        b->ready = close + t->tRP;
     }
+    return done;
+}
+
+// Advance the DRAM to cycle now: banks whose precharge has finished go idle.
+// Write-backs evicted during the cycle are scheduled at now.
+void updateDRAM(DRAM *dram, uint64_t now) {
+    dram->now = now;
+    for (uint16_t i = 0; i < dram->timing.banks; i++)
+        if (dram->bank[i].state == DRAM_PRECHARGE && dram->bank[i].ready <= now)
+            dram->bank[i].state = DRAM_IDLE;
 }
 
 // CACHE FUNCTIONS
+//
+// Line state is structure-of-arrays: line id = set * ways + way indexes
+// tags[], valid[], repl[] and the block at data[id * block_size].  A set's
+// tags and valid bits are contiguous, so find_way() can match all of them
+// with a few vector compares.
+
+// Queue a line for the next state report; each line is queued at most once.
+static void note_change(Cache *cache, uint32_t id) {
+    if (cache->queued[id]) return;
+    cache->queued[id] = 1;
+    cache->changed[cache->num_changed++] = id;
+}
+
+// Empty the change queue once it has been reported.
+void clear_cache_changes(Cache *cache) {
+    for (uint32_t i = 0; i < cache->num_changed; i++)
+        cache->queued[cache->changed[i]] = 0;
+    cache->num_changed = 0;
+}
+
+// Carve n bytes, 32-byte aligned, out of the cache's single allocation.
+static void *carve(uint8_t **cursor, size_t n) {
+    void *p = *cursor;
+    *cursor += (n + 31) & ~(size_t)31;
+    return p;
+}
+
+static void reset_lines(Cache *cache);
+
+// Whether init_cache() takes this shape: every dimension a power of two, the
+// block no larger than the cache, no more ways than lines (0 = fully
+// associative), and at most MAX_CACHE_SIZE words.
+bool cache_geometry_ok(uint16_t size, uint16_t block_size, uint16_t ways) {
+    uint32_t num_lines = block_size ? size / block_size : 0;
+    if (ways == 0) ways = num_lines;
+    return log2_exact(size) != 0xFFFF && log2_exact(block_size) != 0xFFFF &&
+           log2_exact(ways) != 0xFFFF && size <= MAX_CACHE_SIZE &&
+           block_size <= size && ways <= num_lines;
+}
 
 /**
- * Initializes a cache with the specified mode (direct-mapped or set-associative)
+ * Initializes a cache of size words split into block_size-word lines, ways
+ * lines per set (0 = fully associative), replaced by policy (REPL_*).  Sizes
+ * must be powers of two; seed drives the random and BRRIP policies.  Stores
+ * write through without allocating unless write_back is set.
  */
-Cache *init_cache(uint16_t mode) {
-    if (mode != 1 && mode != 2) {
-        printf("Error: Invalid cache mode %u (must be 1 or 2)\n", mode);
+Cache *init_cache(uint16_t size, uint16_t block_size, uint16_t ways, uint16_t policy, uint32_t seed,
+                  bool write_back) {
+    uint16_t size_bits  = log2_exact(size);
+    uint16_t block_bits = log2_exact(block_size);
+    uint32_t num_lines  = block_size ? size / block_size : 0;
+    if (ways == 0) ways = num_lines;
+    uint16_t way_bits   = log2_exact(ways);
+
+    if (!cache_geometry_ok(size, block_size, ways)) {
+        printf("Error: Invalid cache geometry: %u words, %u-word blocks, %u ways "
+               "(powers of two, at most %u words)\n", size, block_size, ways, MAX_CACHE_SIZE);
+        return NULL;
+    }
+    if (policy >= REPL_COUNT) {
+        printf("Error: Invalid cache replacement policy %u\n", policy);
         return NULL;
     }
     
-    Cache *cache = (Cache *)malloc(sizeof(Cache));
+    Cache *cache = (Cache *)calloc(1, sizeof(Cache));
     if (!cache) return NULL;
     
-    cache->mode = mode;
-    if (mode == 1) {
-        cache->num_sets = 16; // Direct-mapped cache: 1 set per line
-    } else if (mode == 2) {
-            cache->num_sets = 8; // Set-associative cache: 8 sets (or whatever value you want)
-    } else {
-        // Handle fully-associative or invalid mode
-        cache->num_sets = 16; // Default fallback
-    }
+    cache->ways        = ways;
+    cache->num_sets    = num_lines / ways;
+    cache->num_lines   = num_lines;
+    cache->block_size  = block_size;
+    cache->offset_bits = block_bits;
+    cache->tag_shift   = size_bits - way_bits;
+    cache->set_mask    = cache->num_sets - 1;
+    cache->policy      = policy;
+    cache->seed        = seed;
+    cache->write_back  = write_back;
+    cache->label       = "CACHE";
 
-    
-    // Allocate memory for the sets
-    cache->sets = (Set *)malloc(cache->num_sets * sizeof(Set));
-    if (!cache->sets) {
+    // One allocation for every per-line and per-set array, the data and the
+    // change queue
+    size_t bytes = 6 * (((num_lines * sizeof(uint16_t)) + 31) & ~(size_t)31) +
+                   ((cache->num_sets * sizeof(uint16_t) + 31) & ~(size_t)31) +
+                   ((size * sizeof(uint16_t) + 31) & ~(size_t)31) +
+                   num_lines * sizeof(uint32_t) + 32;
+    uint8_t *cursor = malloc(bytes);
+    if (!cursor) {
         free(cache);
         return NULL;
     }
+    cache->store = cursor;
+    cursor = (uint8_t *)(((uintptr_t)cursor + 31) & ~(uintptr_t)31);
+    cache->tags     = carve(&cursor, num_lines * sizeof(uint16_t));
+    cache->valid    = carve(&cursor, num_lines * sizeof(uint16_t));
+    cache->dirty    = carve(&cursor, num_lines * sizeof(uint16_t));
+    cache->repl     = carve(&cursor, num_lines * sizeof(uint16_t));
+    cache->queued   = carve(&cursor, num_lines * sizeof(uint16_t));
+    cache->prefetched = carve(&cursor, num_lines * sizeof(uint16_t));
+    cache->set_repl = carve(&cursor, cache->num_sets * sizeof(uint16_t));
+    cache->data     = carve(&cursor, size * sizeof(uint16_t));
+    cache->changed  = carve(&cursor, num_lines * sizeof(uint32_t));
+
+    memset(cache->queued, 0, num_lines * sizeof(uint16_t));
+    reset_lines(cache);                        // a new cache is reported in full
     
-    // Initialize each set
-    for (uint16_t i = 0; i < cache->num_sets; i++) {
-        cache->sets[i].associativity = mode;
-        cache->sets[i].lines = (Line *)malloc(mode * sizeof(Line));
-        
-        if (!cache->sets[i].lines) {
-            // Clean up previously allocated memory
-            for (uint16_t j = 0; j < i; j++) {
-                free(cache->sets[j].lines);
+    TRACE(TRACE_CACHE, TRACE_LEVEL_DEBUG, "[CACHE_INIT] Created cache with %u sets, %u-way, %u-word blocks\n", 
+           cache->num_sets, cache->ways, cache->block_size);
+    return cache;
+}
+
+#if defined(__GNUC__)
+#define lowest_bit(m) __builtin_ctz(m)
+#else
+static int lowest_bit(unsigned m) {
+    int n = 0;
+    while (!(m & 1)) { m >>= 1; n++; }
+    return n;
+}
+#endif
+
+// Way of the set starting at line base that holds tag, or -1.
+static inline int find_way(const Cache *cache, uint32_t base, uint16_t tag) {
+    const uint16_t *tags  = cache->tags + base;
+    const uint16_t *valid = cache->valid + base;
+#ifdef VLANES
+    if (cache->ways >= VLANES) {
+        vec16 want = v_set1(tag), zero = v_set1(0);
+        for (int w = 0; w < cache->ways; w += VLANES) {
+            unsigned m = v_mask(v_andnot(v_eq(v_load(valid + w), zero), v_eq(v_load(tags + w), want)));
+            if (m) return w + lowest_bit(m) / 2;
+        }
+        return -1;
+    }
+#endif
+    for (int w = 0; w < cache->ways; w++)
+        if (valid[w] && tags[w] == tag)
+            return w;
+    return -1;
+}
+
+/**
+ * Give cache a victim buffer of entries lines (at most MAX_VICTIMS).
+ * Returns false if entries is out of range or memory runs out.
+ */
+bool init_victim_buffer(Cache *cache, uint16_t entries) {
+    if (!cache || entries == 0 || entries > MAX_VICTIMS) {
+        printf("Error: Invalid victim buffer size %u (1 to %u entries)\n", entries, MAX_VICTIMS);
+        return false;
+    }
+    VictimBuffer *vb = (VictimBuffer *)calloc(1, sizeof(VictimBuffer));
+    if (!vb) return false;
+    vb->data = (uint16_t *)calloc((size_t)(entries + 1) * cache->block_size, sizeof(uint16_t));
+    if (!vb->data) {
+        free(vb);
+        return false;
+    }
+    vb->entries    = entries;
+    cache->victims = vb;
+    return true;
+}
+
+// Victim buffer entry holding the block of address, or -1 (also without a buffer).
+int victim_lookup(const Cache *cache, uint16_t address) {
+    if (!cache || !cache->victims) return -1;
+    uint16_t block_address = address - cache_offset(cache, address);
+    const VictimBuffer *vb = cache->victims;
+    for (int e = 0; e < vb->entries; e++)
+        if (vb->valid[e] && vb->block[e] == block_address) return e;
+    return -1;
+}
+
+// Update a word of a block sitting in the victim buffer.
+static void victim_patch(Cache *cache, uint16_t address, uint16_t data) {
+    int e = victim_lookup(cache, address);
+    if (e >= 0) cache->victims->data[e * cache->block_size + cache_offset(cache, address)] = data;
+}
+
+/**
+ * @brief Way of set holding address, or -1.  No stats, LRU or trace output;
+ * lets the pipeline pick a hit or miss latency before the access.
+ */
+int cache_lookup(const Cache *cache, uint16_t address) {
+    return find_way(cache, (uint32_t)cache_set(cache, address) * cache->ways, cache_tag(cache, address));
+}
+
+// First of the n (a power of two) entries equal to v, or -1.
+static int find_u16(const uint16_t *a, int n, uint16_t v) {
+#ifdef VLANES
+    if (n >= VLANES) {
+        vec16 want = v_set1(v);
+        for (int i = 0; i < n; i += VLANES) {
+            unsigned m = v_mask(v_eq(v_load(a + i), want));
+            if (m) return i + lowest_bit(m) / 2;
+        }
+        return -1;
+    }
+#endif
+    for (int i = 0; i < n; i++)
+        if (a[i] == v) return i;
+    return -1;
+}
+
+// Age every line of the set more recent than old_lru by one -- only valid
+// ones when valid is non-NULL.  The line being promoted has lru == old_lru
+// and is left alone.
+static void age_lines(uint16_t *lru, const uint16_t *valid, int n, uint16_t old_lru) {
+#ifdef VLANES
+    if (n >= VLANES) {
+        vec16 old = v_set1(old_lru), zero = v_set1(0);
+        for (int i = 0; i < n; i += VLANES) {
+            vec16 v = v_load(lru + i);
+            vec16 older = v_lt(v, old);          // all ones where lru < old_lru
+            if (valid) older = v_andnot(v_eq(v_load(valid + i), zero), older);
+            v_store(lru + i, v_sub(v, older));   // subtracting -1 adds one
+        }
+        return;
+    }
+#endif
+    for (int i = 0; i < n; i++)
+        if ((!valid || valid[i]) && lru[i] < old_lru)
+            lru[i]++;
+}
+
+// Largest of the n (a power of two) entries; every entry is below 32768.
+static uint16_t max_u16(const uint16_t *a, int n) {
+    int i = 0;
+    uint16_t highest = 0;
+#ifdef VLANES
+    if (n >= VLANES) {
+        vec16 hi = v_set1(0);
+        for (; i < n; i += VLANES) hi = v_max(hi, v_load(a + i));
+        uint16_t lanes[VLANES];
+        v_store(lanes, hi);
+        for (int l = 0; l < VLANES; l++)
+            highest = lanes[l] > highest ? lanes[l] : highest;
+    }
+#endif
+    for (; i < n; i++)
+        highest = a[i] > highest ? a[i] : highest;
+    return highest;
+}
+
+// Add delta to each of the n entries.
+static void add_u16(uint16_t *a, int n, uint16_t delta) {
+#ifdef VLANES
+    if (n >= VLANES) {
+        vec16 minus = v_set1(-delta);
+        for (int i = 0; i < n; i += VLANES) v_store(a + i, v_sub(v_load(a + i), minus));
+        return;
+    }
+#endif
+    for (int i = 0; i < n; i++) a[i] += delta;
+}
+
+// xorshift32 stream for the random and BRRIP policies; clear_cache()
+// restarts it from the seed so runs repeat.
+static uint32_t next_random(Cache *cache) {
+    uint32_t x = cache->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return cache->rng = x;
+}
+
+// REPLACEMENT POLICIES
+//
+// Each policy keeps its own state in repl[] (one entry per line) and
+// set_repl[] (one per set) and is told about every hit and fill.  victim()
+// is only asked once the set is full; invalid lines are always used first.
+
+typedef struct {
+    const char *name;
+    void (*reset)(Cache *cache, uint32_t set);          // fresh state for one set
+    void (*hit)(Cache *cache, uint32_t set, int way);
+    void (*fill)(Cache *cache, uint32_t set, int way);  // line just became valid
+    int  (*victim)(Cache *cache, uint32_t set);
+} ReplPolicy;
+
+// LRU: repl[] is the line's age, 0 = most recently used.  The ages of a
+// set are always a permutation of 0..ways-1.
+static void lru_reset(Cache *cache, uint32_t set) {
+    uint16_t *lru = cache->repl + set * cache->ways;
+    for (int w = 0; w < cache->ways; w++) lru[w] = w;
+}
+
+// A hit makes the line most recently used; lines that were more recent age by one.
+static void lru_hit(Cache *cache, uint32_t set, int way) {
+    if (cache->ways == 1) return;
+    uint16_t *lru = cache->repl + set * cache->ways;
+    age_lines(lru, NULL, cache->ways, lru[way]);
+    lru[way] = 0;
+}
+
+static void lru_fill(Cache *cache, uint32_t set, int way) {
+    if (cache->ways == 1) return;
+    uint32_t base = set * cache->ways;
+    uint16_t *lru = cache->repl + base;
+    age_lines(lru, cache->valid + base, cache->ways, lru[way]);
+    lru[way] = 0;
+}
+
+// The least recently used line: the first with the highest age.
+static int lru_victim(Cache *cache, uint32_t set) {
+    const uint16_t *lru = cache->repl + set * cache->ways;
+    return find_u16(lru, cache->ways, max_u16(lru, cache->ways));
+}
+
+// Tree pseudo-LRU: ways-1 direction bits stored as a heap in repl[1..ways-1]
+// of the set, 1 = the victim is in the right subtree.
+static void plru_reset(Cache *cache, uint32_t set) {
+    memset(cache->repl + set * cache->ways, 0, cache->ways * sizeof(uint16_t));
+}
+
+// Point every node on the path to way away from it.
+static void plru_touch(Cache *cache, uint32_t set, int way) {
+    uint16_t *tree = cache->repl + set * cache->ways;
+    for (uint32_t node = cache->ways + way; node > 1; node >>= 1)
+        tree[node >> 1] = !(node & 1);
+}
+
+static int plru_victim(Cache *cache, uint32_t set) {
+    const uint16_t *tree = cache->repl + set * cache->ways;
+    uint32_t node = 1;
+    while (node < cache->ways) node = 2 * node + tree[node];
+    return node - cache->ways;
+}
+
+// FIFO: set_repl[] is the next way to replace, advanced past each line as it
+// is filled.  Hits change nothing.
+static void fifo_reset(Cache *cache, uint32_t set) {
+    cache->set_repl[set] = 0;
+}
+
+static void no_touch(Cache *cache, uint32_t set, int way) {
+    (void)cache; (void)set; (void)way;
+}
+
+static void fifo_fill(Cache *cache, uint32_t set, int way) {
+    if (cache->set_repl[set] == way)
+        cache->set_repl[set] = (way + 1) & (cache->ways - 1);
+}
+
+static int fifo_victim(Cache *cache, uint32_t set) {
+    return cache->set_repl[set];
+}
+
+// Random: no state beyond the cache's generator.
+static void no_reset(Cache *cache, uint32_t set) {
+    (void)cache; (void)set;
+}
+
+static int random_victim(Cache *cache, uint32_t set) {
+    (void)set;
+    return next_random(cache) & (cache->ways - 1);
+}
+
+// RRIP (Jaleel et al.): repl[] is a 2-bit re-reference prediction value.
+// Hits predict near re-reference (0); SRRIP inserts at "long" (RRPV_MAX - 1),
+// BRRIP at "distant" (RRPV_MAX) except for one fill in BRRIP_EPSILON.
+#define RRPV_MAX      3
+#define BRRIP_EPSILON 32
+
+static void rrip_reset(Cache *cache, uint32_t set) {
+    uint16_t *rrpv = cache->repl + set * cache->ways;
+    for (int w = 0; w < cache->ways; w++) rrpv[w] = RRPV_MAX;
+}
+
+static void rrip_hit(Cache *cache, uint32_t set, int way) {
+    cache->repl[set * cache->ways + way] = 0;
+}
+
+static void srrip_fill(Cache *cache, uint32_t set, int way) {
+    cache->repl[set * cache->ways + way] = RRPV_MAX - 1;
+}
+
+static void brrip_fill(Cache *cache, uint32_t set, int way) {
+    bool longer = next_random(cache) % BRRIP_EPSILON == 0;
+    cache->repl[set * cache->ways + way] = longer ? RRPV_MAX - 1 : RRPV_MAX;
+}
+
+// The first line predicted distant, ageing the whole set until there is one.
+static int rrip_victim(Cache *cache, uint32_t set) {
+    uint16_t *rrpv = cache->repl + set * cache->ways;
+    uint16_t highest = max_u16(rrpv, cache->ways);
+    if (highest < RRPV_MAX) add_u16(rrpv, cache->ways, RRPV_MAX - highest);
+    return find_u16(rrpv, cache->ways, RRPV_MAX);
+}
+
+static const ReplPolicy policies[REPL_COUNT] = {
+    [REPL_LRU]    = { "lru",    lru_reset,  lru_hit,    lru_fill,   lru_victim    },
+    [REPL_PLRU]   = { "plru",   plru_reset, plru_touch, plru_touch, plru_victim   },
+    [REPL_FIFO]   = { "fifo",   fifo_reset, no_touch,   fifo_fill,  fifo_victim   },
+    [REPL_RANDOM] = { "random", no_reset,   no_touch,   no_touch,   random_victim },
+    [REPL_SRRIP]  = { "srrip",  rrip_reset, rrip_hit,   srrip_fill, rrip_victim   },
+    [REPL_BRRIP]  = { "brrip",  rrip_reset, rrip_hit,   brrip_fill, rrip_victim   },
+};
+
+/**
+ * @brief Policy number for a cache_policy value: a name ("lru", "plru",
+ * "fifo", "random", "srrip", "brrip") or its number.  -1 when unknown.
+ */
+int cache_policy_id(const char *name) {
+    for (int p = 0; p < REPL_COUNT; p++)
+        if (strcmp(name, policies[p].name) == 0) return p;
+    char *end;
+    unsigned long p = strtoul(name, &end, 0);
+    return (*name && !*end && p < REPL_COUNT) ? (int)p : -1;
+}
+
+const char *cache_policy_name(int policy) {
+    return (policy >= 0 && policy < REPL_COUNT) ? policies[policy].name : "?";
+}
+
+static const char *const inclusions[INCL_COUNT] = {
+    [INCL_NINE] = "nine", [INCL_INCLUSIVE] = "inclusive", [INCL_EXCLUSIVE] = "exclusive",
+};
+
+/**
+ * @brief Inclusion number for an l2_inclusion value: "inclusive",
+ * "exclusive", "nine" (or "non-inclusive"), or its number.  -1 when unknown.
+ */
+int cache_inclusion_id(const char *name) {
+    if (strcmp(name, "non-inclusive") == 0) return INCL_NINE;
+    for (int i = 0; i < INCL_COUNT; i++)
+        if (strcmp(name, inclusions[i]) == 0) return i;
+    char *end;
+    unsigned long i = strtoul(name, &end, 0);
+    return (*name && !*end && i < INCL_COUNT) ? (int)i : -1;
+}
+
+const char *cache_inclusion_name(int inclusion) {
+    return (inclusion >= 0 && inclusion < INCL_COUNT) ? inclusions[inclusion] : "?";
+}
+
+// Reset every line and the policy state to an empty cache.
+static void reset_lines(Cache *cache) {
+    const ReplPolicy *policy = &policies[cache->policy];
+    for (uint32_t id = 0; id < cache->num_lines; id++) {
+        cache->tags[id]  = 0;
+        cache->valid[id] = 0;
+        cache->dirty[id] = 0;
+        cache->prefetched[id] = 0;
+        note_change(cache, id);
+    }
+    for (uint32_t set = 0; set < cache->num_sets; set++) policy->reset(cache, set);
+    if (cache->victims) {
+        memset(cache->victims->valid, 0, sizeof(cache->victims->valid));
+        memset(cache->victims->dirty, 0, sizeof(cache->victims->dirty));
+    }
+    cache->rng = cache->seed ? cache->seed : 1;
+    memset(cache->data, 0, (size_t)cache->num_lines * cache->block_size * sizeof(uint16_t));
+}
+
+static void touch_hit(Cache *cache, uint32_t base, int way) {
+    if (cache->prefetched[base + way]) {
+        cache->prefetched[base + way] = 0;
+        cache->prefetch_hits++;
+    }
+    policies[cache->policy].hit(cache, base / cache->ways, way);
+}
+
+// Replacement victim: the first invalid line, else the policy's choice.
+static int choose_victim(Cache *cache, uint32_t base) {
+    int victim = find_u16(cache->valid + base, cache->ways, 0);
+    if (victim >= 0) return victim;
+    return policies[cache->policy].victim(cache, base / cache->ways);
+}
+
+// Output line state for UI visualization
+static void trace_line(const Cache *cache, uint16_t set_index, int way) {
+    uint32_t id = (uint32_t)set_index * cache->ways + way;
+    TRACE(TRACE_CACHE, TRACE_LEVEL_INFO, "[%s]%u:%u:%u:%u\n", cache->label, set_index, way, 1, cache->tags[id]);
+    for (int j = 0; j < cache->block_size; j++) {
+        TRACE(TRACE_CACHE, TRACE_LEVEL_INFO, "[%s_DATA]%u:%u:%u:%u\n",
+               cache->label, set_index, way, j, cache->data[id * cache->block_size + j]);
+    }
+}
+
+// First address of the block line id holds.
+static uint16_t line_address(const Cache *cache, uint32_t id) {
+    return (uint16_t)(((uint32_t)cache->tags[id] << cache->tag_shift) |
+                      ((id / cache->ways) << cache->offset_bits));
+}
+
+static void fill_line(Cache *cache, DRAM *dram, uint32_t base, int way,
+                      uint16_t tag, uint16_t block_address);
+
+// Line of a lower level holding address, filled on a miss: an upper level
+// reading a block from it or writing one back into it.
+static uint32_t level_line(Cache *cache, DRAM *dram, uint16_t address) {
+    uint16_t set_index = cache_set(cache, address);
+    uint16_t tag = cache_tag(cache, address);
+    uint32_t base = (uint32_t)set_index * cache->ways;
+
+    int way = find_way(cache, base, tag);
+    if (way >= 0) {
+        cache->hits++;
+        TRACE(TRACE_CACHE, TRACE_LEVEL_DEBUG, "[%s_HIT] Address %u found in set %u\n",
+               cache->label, address, set_index);
+        touch_hit(cache, base, way);
+    } else {
+        cache->misses++;
+        TRACE(TRACE_CACHE, TRACE_LEVEL_DEBUG, "[%s_MISS] Address %u not in cache\n", cache->label, address);
+        way = choose_victim(cache, base);
+        fill_line(cache, dram, base, way, tag, address - cache_offset(cache, address));
+    }
+    trace_line(cache, set_index, way);
+    return base + way;
+}
+
+// Copy n words starting at address into a lower level, allocating their
+// lines, which stay dirty there.
+static void write_block(Cache *cache, DRAM *dram, uint16_t address, const uint16_t *data, uint16_t n) {
+    for (uint16_t i = 0; i < n; ) {
+        uint16_t addr   = address + i;
+        uint32_t id     = level_line(cache, dram, addr);
+        uint16_t offset = cache_offset(cache, addr);
+        uint16_t words  = cache->block_size - offset;
+        if (words > n - i) words = n - i;
+        memcpy(cache->data + id * cache->block_size + offset, data + i, words * sizeof(uint16_t));
+        cache->dirty[id] = 1;
+        note_change(cache, id);
+        i += words;
+    }
+}
+
+// Copy a dirty block of cache to the next level.  Only write-backs that
+// reach DRAM are charged to DRAM timing: handed to the memory controller,
+// queued on their bank, or counted in wb_pending under flat timing.  An exclusive L2 never takes a copy of a
+// block that stays resident above it.
+static void write_back_block(Cache *cache, DRAM *dram, uint16_t block_address, const uint16_t *data) {
+    if (cache->next && cache->next->inclusion != INCL_EXCLUSIVE) {
+        write_block(cache->next, dram, block_address, data, cache->block_size);
+    } else {
+        for (int i = 0; i < cache->block_size; i++)
+            writeToMemory(dram, block_address + i, data[i]);
+        if (dram->writeback)
+            dram->writeback(dram->owner, block_address);
+        else if (dram->timing.banks)
+            dram_access(dram, dram->now, block_address);
+        else
+            cache->wb_pending++;
+    }
+    cache->writebacks++;
+}
+
+// Write dirty line id back and mark it clean.
+static void write_back_line(Cache *cache, DRAM *dram, uint32_t id) {
+    uint16_t block_address = line_address(cache, id);
+    TRACE(TRACE_CACHE, TRACE_LEVEL_DEBUG, "[%s_WRITEBACK] Writing line with tag %u in set %u back to %u\n",
+           cache->label, cache->tags[id], id / cache->ways, block_address);
+    write_back_block(cache, dram, block_address, cache->data + id * cache->block_size);
+    cache->dirty[id] = 0;
+}
+
+// Inclusive eviction of line id: drop every copy its L1s hold, folding dirty
+// L1 data into the line first so its own write-back carries it.
+static void back_invalidate(Cache *cache, uint32_t id) {
+    uint16_t block_address = line_address(cache, id);
+    uint16_t *data = cache->data + id * cache->block_size;
+    for (int u = 0; u < cache->num_uppers; u++) {
+        Cache *upper = cache->uppers[u];
+        for (uint32_t addr = block_address; addr < (uint32_t)block_address + cache->block_size;
+             addr += upper->block_size) {
+            int way = cache_lookup(upper, (uint16_t)addr);
+            if (way < 0) continue;
+            uint32_t uid = (uint32_t)cache_set(upper, (uint16_t)addr) * upper->ways + way;
+            TRACE(TRACE_CACHE, TRACE_LEVEL_DEBUG, "[%s_BACK_INVALIDATE] Dropping block %u\n",
+                   upper->label, addr);
+            if (upper->dirty[uid]) {
+                memcpy(data + (addr - block_address), upper->data + uid * upper->block_size,
+                       upper->block_size * sizeof(uint16_t));
+                cache->dirty[id] = 1;
+                upper->dirty[uid] = 0;
+                upper->writebacks++;
             }
-            free(cache->sets);
-            free(cache);
-            return NULL;
+            upper->valid[uid] = 0;
+            note_change(upper, uid);
         }
-        
-        // Initialize each line in the set
-        for (uint16_t j = 0; j < mode; j++) {
-            cache->sets[i].lines[j].valid = 0;
-            cache->sets[i].lines[j].tag = 0;
-            cache->sets[i].lines[j].lru = j; // For set-associative cache
-            
-            // Initialize data blocks to zero
-            for (uint16_t k = 0; k < BLOCK_SIZE; k++) {
-                cache->sets[i].lines[j].data[k] = 0;
+        VictimBuffer *vb = upper->victims;
+        for (int e = 0; vb && e < vb->entries; e++) {
+            if (!vb->valid[e] || (uint16_t)(vb->block[e] - block_address) >= cache->block_size) continue;
+            if (vb->dirty[e]) {
+                memcpy(data + (vb->block[e] - block_address), vb->data + e * upper->block_size,
+                       upper->block_size * sizeof(uint16_t));
+                cache->dirty[id] = 1;
+                upper->writebacks++;
             }
+            vb->valid[e] = 0;
+            vb->dirty[e] = 0;
         }
     }
-    
-    printf("[CACHE_INIT] Created cache with %u sets, mode %u\n", 
-           cache->num_sets, cache->mode);
-    return cache;
+}
+
+static void insert_victim(Cache *cache, DRAM *dram, uint16_t address, const uint16_t *data, bool dirty);
+
+// Pass an evicted block down: an exclusive L2 takes every victim, otherwise
+// only a dirty one is written back.
+static void pass_down(Cache *cache, DRAM *dram, uint16_t block_address, const uint16_t *data, bool dirty) {
+    if (cache->next && cache->next->inclusion == INCL_EXCLUSIVE) {
+        insert_victim(cache->next, dram, block_address, data, dirty);
+        if (dirty) cache->writebacks++;
+    } else if (dirty) {
+        write_back_block(cache, dram, block_address, data);
+    }
+}
+
+// Move the block in valid line id into the victim buffer, passing the oldest
+// entry down when every entry is taken.
+static void victim_insert(Cache *cache, DRAM *dram, uint32_t id) {
+    VictimBuffer *vb = cache->victims;
+    uint16_t bs = cache->block_size;
+    int e = 0;
+    while (e < vb->entries && vb->valid[e]) e++;
+    if (e == vb->entries) {
+        e = 0;
+        for (int i = 1; i < vb->entries; i++)
+            if (vb->age[i] > vb->age[e]) e = i;
+        TRACE(TRACE_CACHE, TRACE_LEVEL_DEBUG, "[%s_VICTIM_EVICT] Block %u leaves the victim buffer\n",
+               cache->label, vb->block[e]);
+        pass_down(cache, dram, vb->block[e], vb->data + e * bs, vb->dirty[e]);
+    }
+    for (int i = 0; i < vb->entries; i++) vb->age[i] += vb->valid[i];
+    vb->block[e] = line_address(cache, id);
+    vb->valid[e] = 1;
+    vb->dirty[e] = cache->dirty[id];
+    vb->age[e]   = 0;
+    memcpy(vb->data + e * bs, cache->data + id * bs, bs * sizeof(uint16_t));
+}
+
+// Pass the block in valid line id on before the line is reused: into the
+// victim buffer when there is one, else down a level.
+static void evict_line(Cache *cache, DRAM *dram, uint32_t id) {
+    if (cache->inclusion == INCL_INCLUSIVE) back_invalidate(cache, id);
+    if (cache->victims)
+        victim_insert(cache, dram, id);
+    else
+        pass_down(cache, dram, line_address(cache, id), cache->data + id * cache->block_size, cache->dirty[id]);
+    cache->dirty[id] = 0;
+}
+
+// Claim line base + way for tag, evicting the block it held.
+static uint32_t install_line(Cache *cache, DRAM *dram, uint32_t base, int way, uint16_t tag) {
+    uint32_t id = base + way;
+    if (cache->valid[id]) evict_line(cache, dram, id);
+    if (cache->prefetched[id]) cache->prefetch_unused++;
+    cache->prefetched[id] = 0;
+    cache->valid[id] = 1;
+    cache->tags[id]  = tag;
+    cache->dirty[id] = 0;
+    note_change(cache, id);
+    policies[cache->policy].fill(cache, base / cache->ways, way);
+    return id;
+}
+
+// Exclusive L2: keep a block evicted from an L1 (the block sizes match).
+static void insert_victim(Cache *cache, DRAM *dram, uint16_t address, const uint16_t *data, bool dirty) {
+    uint16_t set_index = cache_set(cache, address);
+    uint16_t tag = cache_tag(cache, address);
+    uint32_t base = (uint32_t)set_index * cache->ways;
+
+    int way = find_way(cache, base, tag);   // already here when both L1s held it
+    if (way < 0) {
+        way = choose_victim(cache, base);
+        install_line(cache, dram, base, way, tag);
+    }
+    uint32_t id = base + way;
+    memcpy(cache->data + id * cache->block_size, data, cache->block_size * sizeof(uint16_t));
+    cache->dirty[id] |= dirty;
+    note_change(cache, id);
+    trace_line(cache, set_index, way);
+}
+
+// Load line id with the block at block_address from the level below.  An
+// exclusive L2 hands its line up (dirty state included) and a block it
+// misses comes straight from DRAM.
+static void load_block(Cache *cache, DRAM *dram, uint32_t id, uint16_t block_address) {
+    uint16_t *data = cache->data + id * cache->block_size;
+    Cache *next = cache->next;
+
+    if (next && next->inclusion == INCL_EXCLUSIVE) {
+        uint32_t base = (uint32_t)cache_set(next, block_address) * next->ways;
+        int way = find_way(next, base, cache_tag(next, block_address));
+        if (way >= 0) {
+            uint32_t nid = base + way;
+            next->hits++;
+            TRACE(TRACE_CACHE, TRACE_LEVEL_DEBUG, "[%s_HIT] Moving block %u up\n", next->label, block_address);
+            memcpy(data, next->data + nid * next->block_size, cache->block_size * sizeof(uint16_t));
+            if (next->dirty[nid] && !cache->write_back)
+                write_back_line(next, dram, nid);   // an I-cache never holds dirty lines
+            cache->dirty[id] = next->dirty[nid];
+            next->valid[nid] = 0;
+            next->dirty[nid] = 0;
+            note_change(next, nid);
+            return;
+        }
+        next->misses++;
+        TRACE(TRACE_CACHE, TRACE_LEVEL_DEBUG, "[%s_MISS] Block %u comes from DRAM\n", next->label, block_address);
+        next = NULL;
+    }
+
+    if (!next) {
+        for (int i = 0; i < cache->block_size; i++)
+            data[i] = readFromMemory(dram, block_address + i);
+        return;
+    }
+    for (uint16_t i = 0; i < cache->block_size; ) {
+        uint16_t addr   = block_address + i;
+        uint32_t nid    = level_line(next, dram, addr);
+        uint16_t offset = cache_offset(next, addr);
+        uint16_t words  = next->block_size - offset;
+        if (words > cache->block_size - i) words = cache->block_size - i;
+        memcpy(data + i, next->data + nid * next->block_size + offset, words * sizeof(uint16_t));
+        i += words;
+    }
+}
+
+// Load the block at block_address into line base + way, first passing down
+// the block it replaces.
+static void fill_line(Cache *cache, DRAM *dram, uint32_t base, int way,
+                      uint16_t tag, uint16_t block_address) {
+    uint32_t id = install_line(cache, dram, base, way, tag);
+    load_block(cache, dram, id, block_address);
+}
+
+// Fill line base + way on a demand miss: swapped in from the victim buffer
+// when it holds the block (the line's old block taking its place there),
+// else from the level below.
+static void demand_fill(Cache *cache, DRAM *dram, uint32_t base, int way,
+                        uint16_t tag, uint16_t block_address) {
+    VictimBuffer *vb = cache->victims;
+    int e = victim_lookup(cache, block_address);
+    if (e < 0) {
+        if (vb) vb->misses++;
+        fill_line(cache, dram, base, way, tag, block_address);
+        return;
+    }
+    uint16_t  bs    = cache->block_size;
+    uint16_t *spare = vb->data + vb->entries * bs;
+    bool      dirty = vb->dirty[e];
+    vb->hits++;
+    TRACE(TRACE_CACHE, TRACE_LEVEL_DEBUG, "[%s_VICTIM_HIT] Block %u swapped back in\n", cache->label, block_address);
+    memcpy(spare, vb->data + e * bs, bs * sizeof(uint16_t));   // the slot may take the evicted line
+    vb->valid[e] = 0;
+    vb->dirty[e] = 0;
+    uint32_t id = install_line(cache, dram, base, way, tag);
+    memcpy(cache->data + id * bs, spare, bs * sizeof(uint16_t));
+    cache->dirty[id] = dirty;
 }
 
 /**
@@ -225,125 +1048,40 @@ uint16_t read_cache(Cache *cache, DRAM *dram, uint16_t address) {
     }
     
     // Calculate cache addressing
-    uint16_t block_offset = address % BLOCK_SIZE;
+    uint16_t block_offset = cache_offset(cache, address);
     uint16_t block_address = address - block_offset; // Address aligned to block boundary
-    uint16_t set_index = (block_address / BLOCK_SIZE) % cache->num_sets;
-    uint16_t tag = block_address / (BLOCK_SIZE * cache->num_sets);
+    uint16_t set_index = cache_set(cache, address);
+    uint16_t tag = cache_tag(cache, address);
+    uint32_t base = (uint32_t)set_index * cache->ways;
     
-    printf("[CACHE_DEBUG] Read address %u: set=%u, tag=%u, offset=%u\n", 
+    TRACE(TRACE_CACHE, TRACE_LEVEL_DEBUG, "[CACHE_DEBUG] Read address %u: set=%u, tag=%u, offset=%u\n", 
            address, set_index, tag, block_offset);
     
-    // Get the appropriate set
-    Set *set = &cache->sets[set_index];
-    
-    // Check for a cache hit
-    for (int i = 0; i < cache->mode; i++) {
-        Line *line = &set->lines[i];
-        
-        if (line->valid && line->tag == tag) {
-            // Cache hit
-            printf("[CACHE_HIT] Address %u found in cache set %u, tag %u\n", 
-                   address, set_index, tag);
-            
-            // Output cache state for UI
-            printf("[CACHE]%u:%u:%u:%u\n", set_index, 0, 1, tag);
-            
-            // Output all block data for UI
-            for (int j = 0; j < BLOCK_SIZE; j++) {
-                printf("[CACHE_DATA]%u:%u:%u:%u\n", 
-                       set_index, 0, j, line->data[j]);
-            }
-            
-            // Update LRU for set associative cache
-            if (cache->mode == 2) {
-                // Remember old LRU value
-                uint16_t old_lru = line->lru;
-                
-                // Set this line as most recently used
-                line->lru = 0;
-                
-                // Update LRU counters for other lines in the set
-                for (int j = 0; j < cache->mode; j++) {
-                    if (j != i && set->lines[j].lru < old_lru) {
-                        set->lines[j].lru++;
-                    }
-                }
-            }
-            
-            return line->data[block_offset];
-        }
-    }
-    
-    // Cache miss - find a line to use (LRU replacement)
-    printf("[CACHE_MISS] Address %u not in cache\n", address);
-    
-    // Determine which line to replace
-    Line *victim_line = NULL;
-    int victim_index = 0;
-    
-    if (cache->mode == 1) {
-        // Direct-mapped: only one choice
-        victim_line = &set->lines[0];
-    } else {
-        // Set associative: find invalid line or highest LRU
-        uint16_t highest_lru = 0;
-        victim_line = &set->lines[0]; // Default to first line
-        
-        for (int i = 0; i < cache->mode; i++) {
-            if (!set->lines[i].valid) {
-                // Found an invalid line - use it immediately
-                victim_line = &set->lines[i];
-                break;
-            }
-            
-            if (set->lines[i].lru > highest_lru) {
-                highest_lru = set->lines[i].lru;
-                victim_line = &set->lines[i];
-            }
-        }
-    }
-    
-    // If the victim line is valid, it needs to be evicted
-    if (victim_line->valid) {
-        printf("[CACHE_EVICT] Replacing line with tag %u in set %u\n", 
-               victim_line->tag, set_index);
+    int way = find_way(cache, base, tag);
+    if (way >= 0) {
+        // Cache hit
+        cache->hits++;
+        TRACE(TRACE_CACHE, TRACE_LEVEL_DEBUG, "[CACHE_HIT] Address %u found in cache set %u, tag %u\n", 
+               address, set_index, tag);
+        trace_line(cache, set_index, way);
+        touch_hit(cache, base, way);
+        return cache->data[(base + way) * cache->block_size + block_offset];
     }
     
-    // Fill the cache line with data from memory
-    victim_line->valid = 1;
-    victim_line->tag = tag;
+    // Cache miss - find a line to use (configured replacement policy)
+    cache->misses++;
+    TRACE(TRACE_CACHE, TRACE_LEVEL_DEBUG, "[CACHE_MISS] Address %u not in cache\n", address);
     
-    // For set associative cache, update LRU status
-    if (cache->mode == 2) {
-        // Set this as most recently used
-        uint16_t old_lru = victim_line->lru;
-        victim_line->lru = 0;
-        
-        // Update others' LRU
-        for (int i = 0; i < cache->mode; i++) {
-            Line *line = &set->lines[i];
-            if (line != victim_line && line->valid && line->lru < old_lru) {
-                line->lru++;
-            }
-        }
-    }
-    
-    // Load data from memory into cache line
-    for (int i = 0; i < BLOCK_SIZE; i++) {
-        uint16_t block_addr = block_address + i;
-        victim_line->data[i] = readFromMemory(dram, block_addr);
-    }
-    
-    // Output cache state for UI visualization
-    printf("[CACHE]%u:%u:%u:%u\n", set_index, victim_index, 1, tag);
-    
-    // Output all block data for UI
-    for (int i = 0; i < BLOCK_SIZE; i++) {
-        printf("[CACHE_DATA]%u:%u:%u:%u\n", set_index, victim_index, i, victim_line->data[i]);
+    way = choose_victim(cache, base);
+    if (cache->valid[base + way]) {
+        TRACE(TRACE_CACHE, TRACE_LEVEL_DEBUG, "[CACHE_EVICT] Replacing line with tag %u in set %u\n", 
+               cache->tags[base + way], set_index);
     }
+    demand_fill(cache, dram, base, way, tag, block_address);
+    trace_line(cache, set_index, way);
     
     // Return the requested data
-    return victim_line->data[block_offset];
+    return cache->data[(base + way) * cache->block_size + block_offset];
 }
 
 /**
@@ -359,68 +1097,92 @@ int write_through(Cache *cache, DRAM *dram, uint16_t address, uint16_t data) {
     }
     
     // Calculate cache addressing
-    uint16_t block_offset = address % BLOCK_SIZE;
-    uint16_t block_address = address - block_offset; // Address aligned to block boundary
-    uint16_t set_index = (block_address / BLOCK_SIZE) % cache->num_sets;
-    uint16_t tag = block_address / (BLOCK_SIZE * cache->num_sets);
+    uint16_t block_offset = cache_offset(cache, address);
+    uint16_t set_index = cache_set(cache, address);
+    uint16_t tag = cache_tag(cache, address);
+    uint32_t base = (uint32_t)set_index * cache->ways;
     
-    printf("[CACHE_DEBUG] Write address %u: set=%u, tag=%u, offset=%u, data=%u\n", 
+    TRACE(TRACE_CACHE, TRACE_LEVEL_DEBUG, "[CACHE_DEBUG] Write address %u: set=%u, tag=%u, offset=%u, data=%u\n", 
            address, set_index, tag, block_offset, data);
     
-    // Write-through policy: always update memory
-    writeToMemory(dram, address, data);
+    // Write-through policy: always update the next level
+    if (cache->next) write_cache(cache->next, dram, address, data);
+    else writeToMemory(dram, address, data);
     
-    // Get the appropriate set
-    Set *set = &cache->sets[set_index];
-    
-    // Check for a cache hit
-    for (int i = 0; i < cache->mode; i++) {
-        Line *line = &set->lines[i];
-        
-        if (line->valid && line->tag == tag) {
-            // Cache hit - update the cached data
-            printf("[CACHE_WRITE_HIT] Updating address %u in cache\n", address);
-            
-            // Update the data in the cache line
-            line->data[block_offset] = data;
-            
-            // Output cache state for UI
-            printf("[CACHE]%u:%u:%u:%u\n", set_index, 0, 1, tag);
-            
-            // Output all block data for UI
-            for (int j = 0; j < BLOCK_SIZE; j++) {
-                printf("[CACHE_DATA]%u:%u:%u:%u\n", 
-                       set_index, 0, j, line->data[j]);
-            }
-            
-            // Update LRU for set associative cache
-            if (cache->mode == 2) {
-                // Remember old LRU value
-                uint16_t old_lru = line->lru;
-                
-                // Set this line as most recently used
-                line->lru = 0;
-                
-                // Update LRU counters for other lines in the set
-                for (int j = 0; j < cache->mode; j++) {
-                    if (j != i && set->lines[j].lru < old_lru) {
-                        set->lines[j].lru++;
-                    }
-                }
-            }
-            
-            return 1; // Cache hit
-        }
+    int way = find_way(cache, base, tag);
+    if (way >= 0) {
+        // Cache hit - update the cached data
+        cache->hits++;
+        TRACE(TRACE_CACHE, TRACE_LEVEL_DEBUG, "[CACHE_WRITE_HIT] Updating address %u in cache\n", address);
+        cache->data[(base + way) * cache->block_size + block_offset] = data;
+        note_change(cache, base + way);
+        trace_line(cache, set_index, way);
+        touch_hit(cache, base, way);
+        return 1; // Cache hit
     }
     
     // Cache miss with write-through policy
-    // No write-allocate: we only write to memory
-    printf("[CACHE_WRITE_MISS] Address %u not in cache (write-through, no allocate)\n", 
+    // No write-allocate: we only write to memory (and any victim buffer copy)
+    victim_patch(cache, address, data);
+    cache->misses++;
+    TRACE(TRACE_CACHE, TRACE_LEVEL_DEBUG, "[CACHE_WRITE_MISS] Address %u not in cache (write-through, no allocate)\n", 
            address);
     
     return 0; // Cache miss
 }
 
+/**
+ * Write-back, write-allocate store: a miss loads the block first, and the
+ * word only reaches DRAM when its line is evicted or flushed.
+ * Returns 1 on cache hit, 0 on cache miss
+ */
+static int write_allocate(Cache *cache, DRAM *dram, uint16_t address, uint16_t data) {
+    // Calculate cache addressing
+    uint16_t block_offset = cache_offset(cache, address);
+    uint16_t block_address = address - block_offset;
+    uint16_t set_index = cache_set(cache, address);
+    uint16_t tag = cache_tag(cache, address);
+    uint32_t base = (uint32_t)set_index * cache->ways;
+    
+    TRACE(TRACE_CACHE, TRACE_LEVEL_DEBUG, "[CACHE_DEBUG] Write address %u: set=%u, tag=%u, offset=%u, data=%u\n", 
+           address, set_index, tag, block_offset, data);
+    
+    int way = find_way(cache, base, tag);
+    int hit = way >= 0;
+    if (hit) {
+        cache->hits++;
+        TRACE(TRACE_CACHE, TRACE_LEVEL_DEBUG, "[CACHE_WRITE_HIT] Updating address %u in cache\n", address);
+        touch_hit(cache, base, way);
+    } else {
+        cache->misses++;
+        TRACE(TRACE_CACHE, TRACE_LEVEL_DEBUG, "[CACHE_WRITE_MISS] Address %u not in cache (write-back, allocate)\n", 
+               address);
+        way = choose_victim(cache, base);
+        if (cache->valid[base + way]) {
+            TRACE(TRACE_CACHE, TRACE_LEVEL_DEBUG, "[CACHE_EVICT] Replacing line with tag %u in set %u\n", 
+                   cache->tags[base + way], set_index);
+        }
+        demand_fill(cache, dram, base, way, tag, block_address);
+    }
+    
+    cache->data[(base + way) * cache->block_size + block_offset] = data;
+    cache->dirty[base + way] = 1;
+    note_change(cache, base + way);
+    trace_line(cache, set_index, way);
+    return hit;
+}
+
+/**
+ * Store through the cache under its write policy (write_through() or
+ * write-back with allocation), updating any copy in the snooping cache.
+ * Returns 1 on cache hit, 0 on cache miss
+ */
+int write_cache(Cache *cache, DRAM *dram, uint16_t address, uint16_t data) {
+    if (cache && cache->snoop) patch_cache(cache->snoop, address, data);
+    if (cache && cache->write_back) return write_allocate(cache, dram, address, data);
+    return write_through(cache, dram, address, data);
+}
+
 /**
  * Specifically for instruction fetches to use the cache
  * This is a variant of read_cache designed to work with the fetch stage
@@ -430,156 +1192,172 @@ uint16_t fetch_with_cache(Cache *cache, DRAM *dram, uint16_t address, bool *is_h
     *is_hit = false;
     
     // Verify cache is valid
-    if (!cache || !CACHE_ENABLED) {
+    if (!cache) {
         return readFromMemory(dram, address);
     }
     
     // Calculate cache addressing
-    uint16_t block_offset = address % BLOCK_SIZE;
+    uint16_t block_offset = cache_offset(cache, address);
     uint16_t block_address = address - block_offset; // Address aligned to block boundary
-    uint16_t set_index = (block_address / BLOCK_SIZE) % cache->num_sets;
-    uint16_t tag = block_address / (BLOCK_SIZE * cache->num_sets);
+    uint16_t set_index = cache_set(cache, address);
+    uint16_t tag = cache_tag(cache, address);
+    uint32_t base = (uint32_t)set_index * cache->ways;
     
-    printf("[FETCH_CACHE] Check address %u: set=%u, tag=%u, offset=%u\n", 
+    TRACE(TRACE_CACHE, TRACE_LEVEL_DEBUG, "[FETCH_CACHE] Check address %u: set=%u, tag=%u, offset=%u\n", 
            address, set_index, tag, block_offset);
     
-    // Get the appropriate set
-    Set *set = &cache->sets[set_index];
-    
-    // Check for a cache hit
-    for (int i = 0; i < cache->mode; i++) {
-        Line *line = &set->lines[i];
-        
-        if (line->valid && line->tag == tag) {
-            // Cache hit for instruction fetch
-            printf("[FETCH_CACHE_HIT] Address %u found in cache\n", address);
-            *is_hit = true;
-            
-            // Update LRU for set associative cache
-            if (cache->mode == 2) {
-                // Remember old LRU value
-                uint16_t old_lru = line->lru;
-                
-                // Set this line as most recently used
-                line->lru = 0;
-                
-                // Update LRU counters for other lines in the set
-                for (int j = 0; j < cache->mode; j++) {
-                    if (j != i && set->lines[j].lru < old_lru) {
-                        set->lines[j].lru++;
-                    }
-                }
-            }
-            
-            return line->data[block_offset];
-        }
+    int way = find_way(cache, base, tag);
+    if (way >= 0) {
+        // Cache hit for instruction fetch
+        cache->hits++;
+        TRACE(TRACE_CACHE, TRACE_LEVEL_DEBUG, "[FETCH_CACHE_HIT] Address %u found in cache\n", address);
+        *is_hit = true;
+        touch_hit(cache, base, way);
+        return cache->data[(base + way) * cache->block_size + block_offset];
     }
     
-    // Cache miss - find a line to use (LRU replacement)
-    printf("[FETCH_CACHE_MISS] Address %u not in cache\n", address);
-    
-    // Determine which line to replace
-    Line *victim_line = NULL;
+    // Cache miss - find a line to use (configured replacement policy)
+    cache->misses++;
+    TRACE(TRACE_CACHE, TRACE_LEVEL_DEBUG, "[FETCH_CACHE_MISS] Address %u not in cache\n", address);
     
-    if (cache->mode == 1) {
-        // Direct-mapped: only one choice
-        victim_line = &set->lines[0];
-    } else {
-        // Set associative: find invalid line or highest LRU
-        uint16_t highest_lru = 0;
-        victim_line = &set->lines[0]; // Default to first line
-        
-        for (int i = 0; i < cache->mode; i++) {
-            if (!set->lines[i].valid) {
-                // Found an invalid line - use it immediately
-                victim_line = &set->lines[i];
-                break;
-            }
-            
-            if (set->lines[i].lru > highest_lru) {
-                highest_lru = set->lines[i].lru;
-                victim_line = &set->lines[i];
-            }
-        }
-    }
-    
-    // If the victim line is valid, it needs to be evicted
-    if (victim_line->valid) {
-        printf("[FETCH_CACHE_EVICT] Replacing line with tag %u in set %u\n", 
-               victim_line->tag, set_index);
-    }
-    
-    // Fill the cache line with data from memory
-    victim_line->valid = 1;
-    victim_line->tag = tag;
-    
-    // For set associative cache, update LRU status
-    if (cache->mode == 2) {
-        // Set this as most recently used
-        uint16_t old_lru = victim_line->lru;
-        victim_line->lru = 0;
-        
-        // Update others' LRU
-        for (int i = 0; i < cache->mode; i++) {
-            Line *line = &set->lines[i];
-            if (line != victim_line && line->valid && line->lru < old_lru) {
-                line->lru++;
-            }
-        }
-    }
-    
-    // Load data from memory into cache line
-    for (int i = 0; i < BLOCK_SIZE; i++) {
-        uint16_t block_addr = block_address + i;
-        victim_line->data[i] = readFromMemory(dram, block_addr);
-    }
-    
-    // Output cache state for UI visualization (for the block, not just this instruction)
-    printf("[CACHE]%u:%u:%u:%u\n", set_index, 0, 1, tag);
-    
-    // Output all block data for UI
-    for (int i = 0; i < BLOCK_SIZE; i++) {
-        printf("[CACHE_DATA]%u:%u:%u:%u\n", 
-               set_index, 0, i, victim_line->data[i]);
+    way = choose_victim(cache, base);
+    if (cache->valid[base + way]) {
+        TRACE(TRACE_CACHE, TRACE_LEVEL_DEBUG, "[FETCH_CACHE_EVICT] Replacing line with tag %u in set %u\n", 
+               cache->tags[base + way], set_index);
     }
+    demand_fill(cache, dram, base, way, tag, block_address);
+    trace_line(cache, set_index, way);   // the whole block, not just this instruction
     
     // Return the requested data
-    return victim_line->data[block_offset];
+    return cache->data[(base + way) * cache->block_size + block_offset];
+}
+
+/**
+ * @brief Update a word in place if its block is resident (in the snooping
+ * cache and the level below too). No stats, no replacement-state change and no trace output;
+ * used to keep the cache coherent with stores that bypass it (functional mode).
+ */
+void patch_cache(Cache *cache, uint16_t address, uint16_t data) {
+  if (cache->snoop) patch_cache(cache->snoop, address, data);
+  if (cache->next) patch_cache(cache->next, address, data);
+  victim_patch(cache, address, data);
+  uint32_t base = (uint32_t)cache_set(cache, address) * cache->ways;
+  int way = find_way(cache, base, cache_tag(cache, address));
+  if (way < 0) return;
+  cache->data[(base + way) * cache->block_size + cache_offset(cache, address)] = data;
+  note_change(cache, base + way);
+}
+
+/**
+ * @brief Write every dirty line back to the next level; the lines stay
+ * resident, now clean.  No-op for a write-through cache.
+ * @return The number of lines written
+ */
+uint32_t flush_cache(Cache *cache, DRAM *dram) {
+  if (!cache || !cache->write_back) return 0;
+
+  uint32_t flushed = 0;
+  // a flush is not charged to DRAM timing
+  uint16_t banks = dram->timing.banks;
+  void (*writeback)(void *, uint16_t) = dram->writeback;
+  dram->timing.banks = 0;
+  dram->writeback    = NULL;
+  for (uint32_t id = 0; id < cache->num_lines; id++) {
+    if (!cache->dirty[id]) continue;
+    write_back_line(cache, dram, id);
+    flushed++;
+  }
+  VictimBuffer *vb = cache->victims;
+  for (int e = 0; vb && e < vb->entries; e++) {
+    if (!vb->valid[e] || !vb->dirty[e]) continue;
+    write_back_block(cache, dram, vb->block[e], vb->data + e * cache->block_size);
+    vb->dirty[e] = 0;
+    flushed++;
+  }
+  dram->timing.banks = banks;
+  dram->writeback    = writeback;
+  cache->wb_pending = 0;
+  return flushed;
 }
 
 /**
- * @brief Clears the cache by setting all of the line data to 0
+ * @brief Write back the dirty lines holding any of words [address, address +
+ * words), e.g. before another cache refills that range.  The write-backs
+ * are charged like evictions (wb_pending).
+ */
+void writeback_range(Cache *cache, DRAM *dram, uint16_t address, uint16_t words) {
+  if (!cache || !cache->write_back) return;
+
+  uint32_t start = address & ~(uint32_t)(cache->block_size - 1);
+  for (uint32_t addr = start; addr < (uint32_t)address + words; addr += cache->block_size) {
+    uint16_t set = cache_set(cache, (uint16_t)addr);
+    int way = cache_lookup(cache, (uint16_t)addr);
+    if (way < 0 || !cache->dirty[(uint32_t)set * cache->ways + way]) continue;
+    write_back_line(cache, dram, (uint32_t)set * cache->ways + way);
+  }
+  VictimBuffer *vb = cache->victims;
+  for (int e = 0; vb && e < vb->entries; e++) {
+    if (!vb->valid[e] || !vb->dirty[e] || vb->block[e] < start || vb->block[e] >= (uint32_t)address + words)
+      continue;
+    write_back_block(cache, dram, vb->block[e], vb->data + e * cache->block_size);
+    vb->dirty[e] = 0;
+  }
+}
+
+/**
+ * @brief Fill the block holding address on behalf of a prefetcher: no demand
+ * hit or miss is counted, and unless a demand access is already waiting on
+ * it the line is marked until its first demand hit.
+ * @return false if the block was already resident
+ */
+bool prefetch_line(Cache *cache, DRAM *dram, uint16_t address, bool demanded) {
+  uint16_t set_index = cache_set(cache, address);
+  uint32_t base = (uint32_t)set_index * cache->ways;
+  uint16_t tag = cache_tag(cache, address);
+  if (find_way(cache, base, tag) >= 0 || victim_lookup(cache, address) >= 0) return false;
+
+  int way = choose_victim(cache, base);
+  fill_line(cache, dram, base, way, tag, address - cache_offset(cache, address));
+  cache->prefetched[base + way] = !demanded;
+  cache->prefetch_fills++;
+  TRACE(TRACE_CACHE, TRACE_LEVEL_DEBUG, "[%s_PREFETCH] Block %u filled into set %u\n",
+         cache->label, address - cache_offset(cache, address), set_index);
+  trace_line(cache, set_index, way);
+  return true;
+}
+
+/**
+ * @brief Clears the cache by setting all of the line data to 0.  Dirty lines
+ * are dropped, not written back (see flush_cache)
  * @param cache The cache to be cleared
  */
 void clear_cache(Cache *cache) {
   if (!cache) return;
   
-  for (uint16_t i = 0; i < cache->num_sets; i++) {
-    Set *set = &cache->sets[i];
-    for (uint16_t j = 0; j < cache->mode; j++) {
-      Line *line = &set->lines[j];
-      line->valid = 0;
-      line->tag = 0;
-      line->lru = j;
-      
-      for (uint16_t k = 0; k < BLOCK_SIZE; k++) {
-        line->data[k] = 0;
-      }
-    }
+  cache->hits = 0;
+  cache->misses = 0;
+  cache->writebacks = 0;
+  cache->wb_pending = 0;
+  cache->prefetch_fills = 0;
+  cache->prefetch_hits = 0;
+  cache->prefetch_unused = 0;
+  if (cache->victims) {
+    cache->victims->hits = 0;
+    cache->victims->misses = 0;
   }
+  reset_lines(cache);
 }
 
 /**
- * @brief Frees all of the associated with a cache, including the sets array, lines array, and the cache struct itself
+ * @brief Frees all of the memory associated with a cache: the line arrays
+ * (one allocation) and the cache struct itself
  * @param cache The cache to be destroyed
  */
 void destroy_cache(Cache *cache) {
   if (!cache) return;
   
-  for (uint16_t i = 0; i < cache->num_sets; i++) {
-    free(cache->sets[i].lines);
-  }
-  
-  free(cache->sets);
+  if (cache->victims) free(cache->victims->data);
+  free(cache->victims);
+  free(cache->store);
   free(cache);
 }
@@ -13,73 +13,96 @@
 #include "memory_access.h"
 #include "write_back.h"
 #include "hazards.h"    //  <— new: centralised RAW / load‑use detection
+#include "prefetch.h"
+#include "trace.h"
+#include "simulator.h"
 
-extern bool data_hazard_stall;           // set by resolve_hazards() when a stall is required
-extern uint16_t stall_cycles_remaining;  // countdown handled right here each cycle
-extern REGISTERS *registers;             // architectural register file (for bypassing etc.)
-extern bool branch_taken;                // asserted by execute() when branch target chosen
-extern bool memory_operation_in_progress;// long‑latency memory op (not cache) in MEM stage
-extern bool fetch_memory_busy;           // IF stage is currently waiting on ICACHE miss
-
-void pipeline_step(PipelineState *p, uint16_t *value)
+// Machine state consulted here (all in SimContext):
+//   data_hazard_stall            set by resolve_hazards() when a stall is required
+//   stall_cycles_remaining       countdown handled right here each cycle
+//   memory_operation_in_progress long‑latency memory op (not cache) in MEM stage
+//   mshr.pending_regs            destinations of loads still waiting in MSHRs
+void pipeline_step(SimContext *ctx, uint16_t *value)
 {
+    PipelineState *p = &ctx->pipeline;
+
+    updateDRAM(&ctx->dram, ctx->stats.cycles); // banks that finished precharging go idle
+    prefetch_tick(ctx);                        // finished prefetches land before any lookup
+
     // 1) Commit tail stages first (WB → MEM)
-    write_back(p);
-    memory_access(p);
+    write_back(ctx);
+    memory_access(ctx);
+    mshr_tick(ctx);                            // returning fills write their loads' registers
+    sb_tick(ctx);                              // buffered stores drain to the cache
 
     // 2) Hazrd Detection
     HazardInfo h = detect_hazards(p);          // consult ID/EX + EX/MEM + MEM/WB
 
     if (h.detected) {
-        resolve_hazards(p, &h);                // may set data_hazard_stall & countdown
+        resolve_hazards(ctx, &h);                // may set data_hazard_stall & countdown
     }
 
+    // An instruction that reads or overwrites the destination of a load still
+    // in an MSHR waits in ID/EX for the fill
+    bool mshr_wait = ctx->mshr.pending_regs && p->ID_EX.valid && !p->ID_EX.squashed &&
+                     ((p->ID_EX.src_mask | p->ID_EX.dst_mask) & ctx->mshr.pending_regs);
+
     // 3) Stall Logic
-    // (priority: memory busy  >  explicit RAW stall  >  normal advance)
+    // (priority: memory busy  >  explicit RAW stall  >  MSHR wait  >  normal advance)
 
-    if (memory_operation_in_progress) {
+    if (ctx->memory_operation_in_progress) {
         // Freeze everything *except* MEM/WB & WB so the long latency op can retire.
         p->WB     = p->WB_next;
         p->MEM_WB = p->MEM_WB_next;
-        printf("[PIPELINE_STALL] Memory op in progress → stalling IF/ID, ID/EX, EX/MEM\n");
+        ctx->stats.mem_stall_cycles++;
+        TRACE(TRACE_PIPELINE, TRACE_LEVEL_DEBUG, "[PIPELINE_STALL] Memory op in progress → stalling IF/ID, ID/EX, EX/MEM\n");
     }
-    else if (data_hazard_stall) {
+    else if (ctx->data_hazard_stall) {
         // Inject bubble at EX/MEM, hold earlier latches.  (Classic load‑use solution)
         p->EX_MEM.valid = false;          // bubble
         p->WB     = p->WB_next;
         p->MEM_WB = p->MEM_WB_next;
+        ctx->stats.hazard_stall_cycles++;
 
-        if (stall_cycles_remaining) {
-            --stall_cycles_remaining;
+        if (ctx->stall_cycles_remaining) {
+            --ctx->stall_cycles_remaining;
         }
-        if (stall_cycles_remaining == 0) {
-            data_hazard_stall = false;    // stall window has elapsed – resume next cycle
+        if (ctx->stall_cycles_remaining == 0) {
+            ctx->data_hazard_stall = false;    // stall window has elapsed – resume next cycle
         }
     }
+    else if (mshr_wait) {
+        // Same bubble as a load-use stall, held until the fill returns
+        p->EX_MEM.valid = false;
+        p->WB     = p->WB_next;
+        p->MEM_WB = p->MEM_WB_next;
+        ctx->stats.mem_stall_cycles++;
+        TRACE(TRACE_HAZARD, TRACE_LEVEL_DEBUG, "[HAZARD] waiting on an MSHR fill\n");
+    }
     else {
         // 4) Normal Advance
-        execute(p);
+        execute(ctx);
 
-        if (PIPELINE_ENABLED) {
+        if (ctx->config.pipeline_enabled) {
             // five‑stage parallel flow
-            decode_stage(p);
-            fetch_stage(p, value);   // handles its own icache penalties via fetch_memory_busy
+            decode_stage(ctx);
+            fetch_stage(ctx, value);   // handles its own icache penalties via fetch.memory_busy
         } else {
             // single‑issue / non‑pipelined debug mode
             bool empty = !p->ID_EX.valid && !p->EX_MEM.valid && !p->MEM_WB.valid;
 
             if (empty) {
                 if (p->IF_ID.valid) {
-                    decode_stage(p);
-                    printf("[PIPELINE] Non‑pipe: decoding\n");
+                    decode_stage(ctx);
+                    TRACE(TRACE_PIPELINE, TRACE_LEVEL_DEBUG, "[PIPELINE] Non‑pipe: decoding\n");
                 } else {
-                    fetch_stage(p, value);
-                    printf("[PIPELINE] Non‑pipe: fetching\n");
+                    fetch_stage(ctx, value);
+                    TRACE(TRACE_PIPELINE, TRACE_LEVEL_DEBUG, "[PIPELINE] Non‑pipe: fetching\n");
                 }
             } else {
                 p->ID_EX_next.valid = false;
                 p->IF_ID_next.valid = false;
-                printf("[PIPELINE] Non‑pipe: draining\n");
+                TRACE(TRACE_PIPELINE, TRACE_LEVEL_DEBUG, "[PIPELINE] Non‑pipe: draining\n");
             }
         }
 
@@ -91,6 +114,8 @@ void pipeline_step(PipelineState *p, uint16_t *value)
         p->IF_ID  = p->IF_ID_next;
     }
 
+    mc_tick(ctx);                              // the DRAM takes one of this cycle's requests
+
     // 6) Zero out
     memset(&p->WB_next,     0, sizeof p->WB_next);
     memset(&p->MEM_WB_next, 0, sizeof p->MEM_WB_next);
@@ -105,10 +130,10 @@ void mark_subsequent_instructions_as_squashed(PipelineState *p)
 {
     if (p->IF_ID.valid) {
         p->IF_ID.squashed = true;
-        printf("[BRANCH] Squashing IF/ID @ PC=%u\n", p->IF_ID.pc);
+        TRACE(TRACE_PIPELINE, TRACE_LEVEL_DEBUG, "[BRANCH] Squashing IF/ID @ PC=%u\n", p->IF_ID.pc);
     }
     if (p->ID_EX.valid) {
         p->ID_EX.squashed = true;
-        printf("[BRANCH] Squashing ID/EX @ PC=%u\n", p->ID_EX.pc);
+        TRACE(TRACE_PIPELINE, TRACE_LEVEL_DEBUG, "[BRANCH] Squashing ID/EX @ PC=%u\n", p->ID_EX.pc);
     }
 }
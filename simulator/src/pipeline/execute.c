@@ -4,21 +4,52 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include "execute.h"
+#include "decode_table.h"
 #include "pipeline.h"
 #include "memory.h"
 #include "globals.h"    // for DATA_OFFSET, delays, etc.
+#include "trace.h"
+#include "simulator.h"
 
-extern REGISTERS *registers;
-bool branch_taken = false;
-uint16_t branch_target_address = 0;
+// Resolve the branch in ID/EX, taken or not, to target.  Unpredicted, a
+// taken branch squashes the younger instructions and write-back redirects
+// the PC.  Predicted, the predictor learns the outcome, and only a wrong
+// prediction squashes them and sends fetch the right way.  Returns taken.
+static bool resolve_branch(SimContext *ctx, bool taken, uint16_t target) {
+    PipelineState  *p = &ctx->pipeline;
+    ID_EX_Register *b = &p->ID_EX;
+    bool conditional  = b->handler != H_JMP;
+    if (conditional) ctx->stats.branches++;
+    p->EX_MEM_next.taken  = taken;     // for the write-back text
+    p->EX_MEM_next.target = target;
+    if (!b->predicted) {
+        if (taken) {
+            ctx->branch_taken          = true;
+            ctx->branch_target_address = target;
+            mark_subsequent_instructions_as_squashed(p);
+        }
+        return taken;
+    }
+    if (conditional) bp_update(ctx, b->pc, b->bp_history, taken);
+    if (taken != b->pred_taken) {
+        ctx->stats.mispredicts++;
+        mark_subsequent_instructions_as_squashed(p);
+        ctx->fetch.redirect    = true;
+        ctx->fetch.redirect_pc = taken ? target : b->pc + 1;
+        TRACE(TRACE_PIPELINE, TRACE_LEVEL_DEBUG, "[BRANCH] PC=%u mispredicted, fetch restarts at %u\n",
+              b->pc, ctx->fetch.redirect_pc);
+    }
+    return taken;
+}
 
-void execute(PipelineState *p) {
+void execute(SimContext *ctx) {
+    PipelineState *p         = &ctx->pipeline;
+    REGISTERS     *registers = ctx->registers;
     uint16_t pc = p->ID_EX.pc;
 
     if (!p->ID_EX.valid) {
         p->EX_MEM_next.valid = false;
-        printf("[PIPELINE]EXECUTE:NOP:%d\n", pc);
-        fflush(stdout);
+        TRACE(TRACE_PIPELINE, TRACE_LEVEL_INFO, "[PIPELINE]EXECUTE:NOP:%d\n", pc);
         return;
     }
 
@@ -29,8 +60,7 @@ void execute(PipelineState *p) {
         p->EX_MEM_next.pc = pc;
         p->EX_MEM_next.opcode = p->ID_EX.opcode;
         p->EX_MEM_next.regD = p->ID_EX.regD;
-        printf("[PIPELINE]EXECUTE:SQUASHED:%d\n", pc);
-        fflush(stdout);
+        TRACE(TRACE_PIPELINE, TRACE_LEVEL_INFO, "[PIPELINE]EXECUTE:SQUASHED:%d\n", pc);
         return;
     }
 
@@ -44,8 +74,12 @@ void execute(PipelineState *p) {
     p->EX_MEM_next.regB = p->ID_EX.regB;
     p->EX_MEM_next.imm = p->ID_EX.imm;
     p->EX_MEM_next.resMod = 0;
+    p->EX_MEM_next.handler = p->ID_EX.handler;
+    p->EX_MEM_next.functional_unit = p->ID_EX.functional_unit;
+    p->EX_MEM_next.dst_mask = p->ID_EX.dst_mask;
+    p->EX_MEM_next.taken = false;
 
-    uint16_t op = p->ID_EX.opcode;
+    uint16_t h = p->ID_EX.handler;
     uint16_t d = p->ID_EX.regD;
     uint16_t a = p->ID_EX.regA;
     uint16_t rb = p->ID_EX.regB;
@@ -55,51 +89,51 @@ void execute(PipelineState *p) {
     uint16_t vB = registers->R[rb];
     char txt[64];
 
-    switch (op) {
-        case 0x0:  // ADD
+    switch (h) {
+        case H_ADD:
             res = vA + vB;
-            sprintf(txt, "ADD R%u,R%u,R%u", d, a, rb);
-            printf("[EXECUTE_ADD] R%u = %u + %u = %u\n", d, vA, vB, res);
+            TRACE_FMT(txt, TRACE_PIPELINE, TRACE_LEVEL_INFO, "ADD R%u,R%u,R%u", d, a, rb);
+            TRACE(TRACE_PIPELINE, TRACE_LEVEL_DEBUG, "[EXECUTE_ADD] R%u = %u + %u = %u\n", d, vA, vB, res);
             break;
-        case 0x1:  // SUB
+        case H_SUB:
             res = vA - vB;
-            sprintf(txt, "SUB R%u,R%u,R%u", d, a, rb);
-            printf("[EXECUTE_SUB] R%u = %u - %u = %u\n", d, vA, vB, res);
+            TRACE_FMT(txt, TRACE_PIPELINE, TRACE_LEVEL_INFO, "SUB R%u,R%u,R%u", d, a, rb);
+            TRACE(TRACE_PIPELINE, TRACE_LEVEL_DEBUG, "[EXECUTE_SUB] R%u = %u - %u = %u\n", d, vA, vB, res);
             break;
-        case 0x2:  // AND
+        case H_AND:
             res = vA & vB;
-            sprintf(txt, "AND R%u,R%u,R%u", d, a, rb);
-            printf("[EXECUTE_AND] R%u = %u & %u = %u\n", d, vA, vB, res);
+            TRACE_FMT(txt, TRACE_PIPELINE, TRACE_LEVEL_INFO, "AND R%u,R%u,R%u", d, a, rb);
+            TRACE(TRACE_PIPELINE, TRACE_LEVEL_DEBUG, "[EXECUTE_AND] R%u = %u & %u = %u\n", d, vA, vB, res);
             break;
-        case 0x3:  // OR
+        case H_OR:
             res = vA | vB;
-            sprintf(txt, "OR  R%u,R%u,R%u", d, a, rb);
-            printf("[EXECUTE_OR] R%u = %u | %u = %u\n", d, vA, vB, res);
+            TRACE_FMT(txt, TRACE_PIPELINE, TRACE_LEVEL_INFO, "OR  R%u,R%u,R%u", d, a, rb);
+            TRACE(TRACE_PIPELINE, TRACE_LEVEL_DEBUG, "[EXECUTE_OR] R%u = %u | %u = %u\n", d, vA, vB, res);
             break;
-        case 0x4:  // XOR
+        case H_XOR:
             res = vA ^ vB;
-            sprintf(txt, "XOR R%u,R%u,R%u", d, a, rb);
-            printf("[EXECUTE_XOR] R%u = %u ^ %u = %u\n", d, vA, vB, res);
+            TRACE_FMT(txt, TRACE_PIPELINE, TRACE_LEVEL_INFO, "XOR R%u,R%u,R%u", d, a, rb);
+            TRACE(TRACE_PIPELINE, TRACE_LEVEL_DEBUG, "[EXECUTE_XOR] R%u = %u ^ %u = %u\n", d, vA, vB, res);
             break;
-        case 0x5:  // DIVMOD
+        case H_DIVMOD:
             if (vB == 0) {
                 res = 0; p->EX_MEM_next.resMod = 0;
-                sprintf(txt, "DIVMOD R%u,R%u,R%u (div0)", d, a, rb);
-                printf("[EXECUTE_DIVMOD] Divide by zero → 0\n");
+                TRACE_FMT(txt, TRACE_PIPELINE, TRACE_LEVEL_INFO, "DIVMOD R%u,R%u,R%u (div0)", d, a, rb);
+                TRACE(TRACE_PIPELINE, TRACE_LEVEL_DEBUG, "[EXECUTE_DIVMOD] Divide by zero → 0\n");
             } else {
                 res = vA / vB;
                 p->EX_MEM_next.resMod = vA % vB;
-                sprintf(txt, "DIVMOD R%u,R%u,R%u", d, a, rb);
-                printf("[EXECUTE_DIVMOD] R%u = %u / %u = %u rem %u\n",
+                TRACE_FMT(txt, TRACE_PIPELINE, TRACE_LEVEL_INFO, "DIVMOD R%u,R%u,R%u", d, a, rb);
+                TRACE(TRACE_PIPELINE, TRACE_LEVEL_DEBUG, "[EXECUTE_DIVMOD] R%u = %u / %u = %u rem %u\n",
                        d, vA, vB, res, p->EX_MEM_next.resMod);
             }
             break;
-        case 0x6:  // MUL
+        case H_MUL:
             res = vA * vB;
-            sprintf(txt, "MUL R%u,R%u,R%u", d, a, rb);
-            printf("[EXECUTE_MUL] R%u = %u * %u = %u\n", d, vA, vB, res);
+            TRACE_FMT(txt, TRACE_PIPELINE, TRACE_LEVEL_INFO, "MUL R%u,R%u,R%u", d, a, rb);
+            TRACE(TRACE_PIPELINE, TRACE_LEVEL_DEBUG, "[EXECUTE_MUL] R%u = %u * %u = %u\n", d, vA, vB, res);
             break;
-        case 0x7:  // CMP - Updated to properly set status register
+        case H_CMP:  // Updated to properly set status register
             // Set status register value correctly for proper comparisons
             if ((int16_t)registers->R[d] < (int16_t)vA) {
                 // Less than - set negative value
@@ -112,90 +146,67 @@ void execute(PipelineState *p) {
                 registers->R[14] = 1;
             }
             res = registers->R[14];
-            sprintf(txt, "CMP R%u,R%u,R%u", d, a, rb);
-            printf("[EXECUTE_CMP] SR = %d (result of comparing R%u and R%u)\n", 
+            TRACE_FMT(txt, TRACE_PIPELINE, TRACE_LEVEL_INFO, "CMP R%u,R%u,R%u", d, a, rb);
+            TRACE(TRACE_PIPELINE, TRACE_LEVEL_DEBUG, "[EXECUTE_CMP] SR = %d (result of comparing R%u and R%u)\n", 
                    (int16_t)res, d, a);
             break;
-        case 0x8: {  // shifts/rotates
-            uint16_t t = p->ID_EX.type;  // 0=LSL,1=LSR,2=ROL,3=ROR
+        case H_LSL: case H_LSR: case H_ROL: case H_ROR: {  // shifts/rotates
             uint16_t rd = d;               // original dest
             uint16_t rs = rb;              // amt‐reg
             uint16_t opnd = registers->R[rd];
             uint16_t amount = registers->R[rs];
-            const char *name = (t == 0 ? "LSL" : t == 1 ? "LSR" : t == 2 ? "ROL" : "ROR");
+            const char *name = (h == H_LSL ? "LSL" : h == H_LSR ? "LSR" : h == H_ROL ? "ROL" : "ROR");
 
-            if (t == 0) res = opnd << amount;
-            else if (t == 1) res = opnd >> amount;
-            else if (t == 2) res = (opnd << amount) | (opnd >> (16 - amount));
-            else res = (opnd >> amount) | (opnd << (16 - amount));
+            if (h == H_LSL) res = isa_lsl(opnd, amount);
+            else if (h == H_LSR) res = isa_lsr(opnd, amount);
+            else if (h == H_ROL) res = isa_rol(opnd, amount);
+            else res = isa_ror(opnd, amount);
 
             p->EX_MEM_next.res = res;
-            sprintf(txt, "%s R%u, R%u, %u", name, rd, rd, amount);
-            printf("[EXECUTE_%s] R%u = R%u %s %u → %u\n",
-                   name, rd, rd, (t < 2 ? "<<" : ">>"), amount, res);
+            TRACE_FMT(txt, TRACE_PIPELINE, TRACE_LEVEL_INFO, "%s R%u, R%u, %u", name, rd, rd, amount);
+            TRACE(TRACE_PIPELINE, TRACE_LEVEL_DEBUG, "[EXECUTE_%s] R%u = R%u %s %u → %u\n",
+                   name, rd, rd, (h <= H_LSR ? "<<" : ">>"), amount, res);
             break;
         }
-        case 0x9:  // LW
+        case H_LW:
             res = registers->R[a] + imm;
-            sprintf(txt, "LW  R%u,[R%u+%u]", d, a, imm);
-            printf("[EXECUTE_LW] addr = %u + %u = %u\n", registers->R[a], imm, res);
+            TRACE_FMT(txt, TRACE_PIPELINE, TRACE_LEVEL_INFO, "LW  R%u,[R%u+%u]", d, a, imm);
+            TRACE(TRACE_PIPELINE, TRACE_LEVEL_DEBUG, "[EXECUTE_LW] addr = %u + %u = %u\n", registers->R[a], imm, res);
             break;
-        case 0xA:  // SW
+        case H_SW:
             res = registers->R[a] + imm;
-            sprintf(txt, "SW  [R%u+%u],R%u", a, imm, d);
-            printf("[EXECUTE_SW] addr = %u + %u = %u\n", registers->R[a], imm, res);
+            TRACE_FMT(txt, TRACE_PIPELINE, TRACE_LEVEL_INFO, "SW  [R%u+%u],R%u", a, imm, d);
+            TRACE(TRACE_PIPELINE, TRACE_LEVEL_DEBUG, "[EXECUTE_SW] addr = %u + %u = %u\n", registers->R[a], imm, res);
             break;
-        case 0xB:  // BEQ - Updated to properly check for equality
-            if (registers->R[d] == registers->R[a]) {
-                // Branch will be taken, PC-relative addressing
-                branch_taken = true;
-                branch_target_address = pc + imm;
-                
-                // Mark subsequent instructions as squashed
-                mark_subsequent_instructions_as_squashed(p);
-                
-                printf("[EXECUTE_BEQ] Branch taken (R%u == R%u) → PC=%u\n", 
-                       d, a, branch_target_address);
+        case H_BEQ:  // Updated to properly check for equality
+            if (resolve_branch(ctx, registers->R[d] == registers->R[a], pc + imm)) {
+                TRACE(TRACE_PIPELINE, TRACE_LEVEL_DEBUG, "[EXECUTE_BEQ] Branch taken (R%u == R%u) → PC=%u\n", 
+                       d, a, (uint16_t)(pc + imm));
             } else {
-                printf("[EXECUTE_BEQ] Branch not taken (R%u != R%u)\n", d, a);
+                TRACE(TRACE_PIPELINE, TRACE_LEVEL_DEBUG, "[EXECUTE_BEQ] Branch not taken (R%u != R%u)\n", d, a);
             }
-            sprintf(txt, "BEQ R%u,R%u,%u", d, a, imm);
+            TRACE_FMT(txt, TRACE_PIPELINE, TRACE_LEVEL_INFO, "BEQ R%u,R%u,%u", d, a, imm);
             break;
 
-        case 0xC:  // JMP - Direct jump to the target address in imm
-            // Set branch flags to trigger PC update in writeback
-            branch_taken = true;
-            branch_target_address = imm;
-            
-            // Mark subsequent instructions as squashed
-            mark_subsequent_instructions_as_squashed(p);
-            
-            printf("[EXECUTE_JMP] Jump will be taken → PC=%u (will update at writeback)\n", 
-                   branch_target_address);
-            sprintf(txt, "JMP %u", imm);
+        case H_JMP:  // Direct jump to the target address in imm
+            resolve_branch(ctx, true, imm);
+            TRACE(TRACE_PIPELINE, TRACE_LEVEL_DEBUG, "[EXECUTE_JMP] Jump taken → PC=%u\n", imm);
+            TRACE_FMT(txt, TRACE_PIPELINE, TRACE_LEVEL_INFO, "JMP %u", imm);
             break;
 
-        case 0xF:  // BLT - Updated for proper signed comparison
+        case H_BLT:  // Updated for proper signed comparison
             // Compare as signed 16-bit values
-            if ((int16_t)registers->R[d] < (int16_t)registers->R[a]) {
-                // Branch will be taken, PC-relative addressing
-                branch_taken = true;
-                branch_target_address = pc + imm;
-                
-                // Mark subsequent instructions as squashed
-                mark_subsequent_instructions_as_squashed(p);
-                
-                printf("[EXECUTE_BLT] Branch taken (R%u < R%u) → PC=%u\n", 
-                       d, a, branch_target_address);
+            if (resolve_branch(ctx, (int16_t)registers->R[d] < (int16_t)registers->R[a], pc + imm)) {
+                TRACE(TRACE_PIPELINE, TRACE_LEVEL_DEBUG, "[EXECUTE_BLT] Branch taken (R%u < R%u) → PC=%u\n", 
+                       d, a, (uint16_t)(pc + imm));
             } else {
-                printf("[EXECUTE_BLT] Branch not taken (R%u >= R%u)\n", d, a);
+                TRACE(TRACE_PIPELINE, TRACE_LEVEL_DEBUG, "[EXECUTE_BLT] Branch not taken (R%u >= R%u)\n", d, a);
             }
-            sprintf(txt, "BLT R%u,R%u,%u", d, a, imm);
+            TRACE_FMT(txt, TRACE_PIPELINE, TRACE_LEVEL_INFO, "BLT R%u,R%u,%u", d, a, imm);
             break;
     }
 
     // write‐out and trace
     p->EX_MEM_next.res = res;
-    printf("[PIPELINE]EXECUTE:%s:%d\n", txt, pc);
-    fflush(stdout);
+    TRACE(TRACE_PIPELINE, TRACE_LEVEL_INFO, "[PIPELINE]EXECUTE:%s:%d\n", txt, pc);
 }
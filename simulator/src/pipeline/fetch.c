@@ -4,192 +4,204 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include "fetch.h"
+#include "decode_table.h"
 #include "memory.h"
 #include "pipeline.h"
 #include "globals.h"
-
-extern DRAM        dram;
-extern REGISTERS  *registers;
-extern Cache      *cache;
-extern bool        branch_taken;
-
-// one-shot flag to squash the next fetch completion
-static bool fetch_squash_pending = false;
-
-// State variables for fetch memory access
-bool fetch_memory_busy = false;
-uint16_t fetch_delay_counter = 0;
-uint16_t fetch_delay_target = 0;
-uint16_t fetch_pending_address = 0;
+#include "trace.h"
+#include "simulator.h"
+#include "prefetch.h"
+#include "memory_access.h"
 
 /**
  * Decode a raw 16-bit instruction into a display string.
  */
-static void fmt_instr(uint16_t instr, char *out) {
-    if (instr == 0) {
-        sprintf(out, "NOP");
-        return;
+static void fmt_instr(uint16_t instr, char *out, size_t len) {
+    if (!TRACE_ON(TRACE_PIPELINE, TRACE_LEVEL_INFO)) {
+        return;     // nobody will print it
     }
-    uint16_t op    = (instr >> 12) & 0xF;
-    uint16_t rd    = (instr >>  8) & 0xF;
-    uint16_t ra    = (instr >>  4) & 0xF;
-    uint16_t rbimm =  instr        & 0xF;
-    uint16_t imm12 =  instr        & 0xFFF;  // For JMP, we use a 12-bit immediate
-    
-    switch (op) {
-        case 0x0: sprintf(out, "ADD  R%u,R%u,R%u", rd, ra, rbimm); break;
-        case 0x1: sprintf(out, "SUB  R%u,R%u,R%u", rd, ra, rbimm); break;
-        case 0x2: sprintf(out, "AND  R%u,R%u,R%u", rd, ra, rbimm); break;
-        case 0x3: sprintf(out, "OR   R%u,R%u,R%u", rd, ra, rbimm); break;
-        case 0x4: sprintf(out, "XOR  R%u,R%u,R%u", rd, ra, rbimm); break;
-        case 0x5: sprintf(out, "DIVMOD R%u,R%u,R%u", rd, ra, rbimm); break;
-        case 0x6: sprintf(out, "MUL  R%u,R%u,R%u", rd, ra, rbimm); break;
-        case 0x7: sprintf(out, "CMP  R%u,R%u,R%u", rd, ra, rbimm); break;
-        case 0x8: {
-            const char *mn = (rd==0)?"LSL":(rd==1)?"LSR":(rd==2)?"ROL":"ROR";
-            sprintf(out, "%s R%u,R%u,%u", mn, rbimm, ra, rbimm);
-            break;
-        }
-        case 0x9:  sprintf(out, "LW   R%u,[R%u+%u]", rd, ra, rbimm); break;
-        case 0xA:  sprintf(out, "SW   [R%u+%u],R%u", ra, rbimm, rd); break;
-        case 0xB:  sprintf(out, "BEQ  R%u,R%u,%u", rd, ra, rbimm); break;
-        case 0xC:  sprintf(out, "JMP  %u", imm12); break;  // New JMP instruction with 12-bit immediate
-        case 0xF:  sprintf(out, "BLT  R%u,R%u,%u", rd, ra, rbimm); break;
-        default:   sprintf(out, "UNKNOWN 0x%X", instr);
+    disassemble(instr, out, len);
+}
+
+// Read an instruction through cache (the I-cache when split), training its
+// prefetcher, or straight from DRAM with the caches off.  Buffered stores to
+// the words about to be read are written first.  An I-cache refill comes from
+// the level below, so dirty D-cache copies of the block go back first.
+static uint16_t fetch_word(SimContext *ctx, Cache *cache, uint16_t addr, bool *hit) {
+    if (!ctx->config.cache_enabled || !cache) {
+        if (ctx->sb.used) sb_drain_range(ctx, addr, 1);
+        return readFromMemory(&ctx->dram, addr);
+    }
+    uint16_t block = addr & ~(cache->block_size - 1);
+    if (ctx->sb.used) sb_drain_range(ctx, block, cache->block_size);
+    if (cache == ctx->icache && cache_lookup(cache, addr) < 0)
+        writeback_range(ctx->cache, &ctx->dram, block, cache->block_size);
+    uint16_t word = fetch_with_cache(cache, &ctx->dram, addr, hit);
+    chargeWritebacks(ctx);
+    prefetch_access(ctx, cache == ctx->icache ? ctx->iprefetch : ctx->prefetch, true, addr, addr, *hit);
+    return word;
+}
+
+// Move R15 past the word just fetched from pc into IF/ID: to the next word,
+// or with a branch predictor to wherever a branch is predicted to go.  A
+// JMP's target is in the word itself; BEQ / BLT ask the predictor.
+static void advance_pc(SimContext *ctx, uint16_t pc, uint16_t word) {
+    IF_ID_Register     *r    = &ctx->pipeline.IF_ID_next;
+    const DecodedInstr *di   = &decode_table[word];
+    uint16_t            next = pc + 1;
+    if (ctx->config.bpred != BP_NONE && (di->flags & DI_BRANCH)) {
+        uint16_t target = di->handler == H_JMP ? di->imm : (uint16_t)(pc + di->imm);
+        r->predicted  = true;
+        r->bp_history = ctx->bp.history;
+        r->pred_taken = di->handler == H_JMP || bp_predict(ctx, pc, target, r->bp_history);
+        if (r->pred_taken) next = target;
+        TRACE(TRACE_PIPELINE, TRACE_LEVEL_DEBUG, "[FETCH] branch at PC=%u predicted %s, fetching %u\n",
+              pc, r->pred_taken ? "taken" : "not taken", next);
     }
+    ctx->registers->R[15] = next;
 }
 
 /**
  * The fetch stage: grab the next word, push the old one into IF/ID, and print.
- * Implements memory delay logic and a one-shot squash of the next instruction fetched after a branch enters EX stage.
+ * Implements memory delay logic and a one-shot squash of the next instruction fetched after a branch enters EX stage,
+ * or with a branch predictor, fetch down the predicted path and restart wherever EX says a prediction went wrong.
  */
-void fetch_stage(PipelineState *p, uint16_t *prev_instr) {
+void fetch_stage(SimContext *ctx, uint16_t *prev_instr) {
+    PipelineState *p         = &ctx->pipeline;
+    REGISTERS     *registers = ctx->registers;
+    FetchState    *f         = &ctx->fetch;
+    Cache         *cache     = ctx->icache ? ctx->icache : ctx->cache;
+    uint16_t       hit_delay = ctx->icache ? ctx->config.icache_delay : ctx->config.cache_delay;
     char txt[64] = "FETCH waiting";
     char formatted[48];
     uint16_t pc = registers->R[15];
 
+    // A branch in EX was mispredicted: drop the wrong-path fetch in flight
+    // and go on from the right path, which *prev_instr now names for the
+    // end-of-program check.
+    if (f->redirect) {
+        f->redirect = false;
+        if (f->memory_busy) {
+            ctx->stats.flush_cycles += f->delay_counter + 1;     // + the cycle it started
+            f->memory_busy   = false;
+            f->delay_counter = 0;
+            mc_cancel(ctx, MC_FETCH);
+        }
+        registers->R[15] = pc = f->redirect_pc;
+        *prev_instr = readFromMemory(&ctx->dram, pc);
+        TRACE(TRACE_PIPELINE, TRACE_LEVEL_DEBUG, "[FETCH] mispredicted branch, restarting at PC=%u\n", pc);
+    }
+
+    // Draining for a switch to functional mode: R15 already names the next
+    // instruction to run, so just stop feeding the pipe.
+    if (f->halted) {
+        p->IF_ID_next.valid = false;
+        TRACE(TRACE_PIPELINE, TRACE_LEVEL_INFO, "[PIPELINE]FETCH:FETCH halted:%u\n", pc);
+        return;
+    }
+
     // Detect a branch in the EX stage (ID_EX pipeline register) and schedule one squash
-    // Include JMP (opcode 0xC) in the list of instructions that require squashing
-    if (p->ID_EX.valid && (p->ID_EX.opcode == 0xB || p->ID_EX.opcode == 0xF || p->ID_EX.opcode == 0xC) && !fetch_squash_pending) {
-        fetch_squash_pending = true;
+    // (BEQ, BLT and JMP all live on the branch unit); a predicted branch
+    // squashes only on a misprediction, in EX
+    if (p->ID_EX.valid && p->ID_EX.functional_unit == FU_BRANCH && !p->ID_EX.predicted && !f->squash_pending) {
+        f->squash_pending = true;
         // Debug log:
-        printf("[FETCH] Scheduled squash for next fetch due to branch/jump at PC=%u\n", p->ID_EX.pc);
+        TRACE(TRACE_PIPELINE, TRACE_LEVEL_DEBUG, "[FETCH] Scheduled squash for next fetch due to branch/jump at PC=%u\n", p->ID_EX.pc);
     }
 
     // 1. If a memory operation is already in progress, tick the countdown
-    if (fetch_memory_busy) {
-        fetch_delay_counter++;
-        printf("[FETCH_DELAY] Cycle %u of %u\n", fetch_delay_counter, fetch_delay_target);
+    if (f->memory_busy) {
+        f->delay_counter++;
+        TRACE(TRACE_PIPELINE, TRACE_LEVEL_DEBUG, "[FETCH_DELAY] Cycle %u of %u\n", f->delay_counter, f->delay_target);
 
         // Delay complete?
-        if (fetch_delay_counter >= fetch_delay_target) {
+        if (f->delay_counter >= f->delay_target) {
             bool cache_hit = false;
-            uint16_t word = 0;
-            
-            if (CACHE_ENABLED && cache) {
-                word = fetch_with_cache(cache, &dram, fetch_pending_address, &cache_hit);
-            } else {
-                word = readFromMemory(&dram, fetch_pending_address);
-            }
+            uint16_t word = fetch_word(ctx, cache, f->pending_address, &cache_hit);
 
-            if (fetch_squash_pending) {
+            if (f->squash_pending) {
                 // squash this one
                 p->IF_ID_next.valid       = true;
                 p->IF_ID_next.squashed    = true;
-                p->IF_ID_next.pc          = fetch_pending_address;
+                p->IF_ID_next.pc          = f->pending_address;
                 p->IF_ID_next.instruction = word;
-                fmt_instr(word, formatted);
-                snprintf(txt, sizeof(txt), "SQUASHED %s", formatted);
-                printf("[FETCH] PC=%u squashed (flush)\n", fetch_pending_address);
-                fetch_squash_pending = false;
+                fmt_instr(word, formatted, sizeof(formatted));
+                TRACE_FMT(txt, TRACE_PIPELINE, TRACE_LEVEL_INFO, "SQUASHED %s", formatted);
+                TRACE(TRACE_PIPELINE, TRACE_LEVEL_DEBUG, "[FETCH] PC=%u squashed (flush)\n", f->pending_address);
+                f->squash_pending = false;
             } else {
                 // normal
                 p->IF_ID_next.valid       = true;
                 p->IF_ID_next.squashed    = false;
-                p->IF_ID_next.pc          = fetch_pending_address;
+                p->IF_ID_next.pc          = f->pending_address;
                 p->IF_ID_next.instruction = word;
-                fmt_instr(word, txt);
-                registers->R[15]++;
-                printf("[FETCH] inst=0x%04X pc=%u (after %u cycles), cache hit=%s\n",
-                       word, fetch_pending_address, fetch_delay_target, 
+                fmt_instr(word, txt, sizeof(txt));
+                advance_pc(ctx, f->pending_address, word);
+                TRACE(TRACE_PIPELINE, TRACE_LEVEL_DEBUG, "[FETCH] inst=0x%04X pc=%u (after %u cycles), cache hit=%s\n",
+                       word, f->pending_address, f->delay_target, 
                        cache_hit ? "true" : "false");
             }
             *prev_instr = word;
-            fetch_memory_busy   = false;
-            fetch_delay_counter = 0;
+            f->memory_busy   = false;
+            f->delay_counter = 0;
         } else {
             // still waiting, bubble fetch
             p->IF_ID_next.valid = false;
-            snprintf(txt, sizeof(txt), "FETCH waiting (%u/%u)", fetch_delay_counter, fetch_delay_target);
-            printf("[FETCH] waiting %u/%u cycles\n", fetch_delay_counter, fetch_delay_target);
+            ctx->stats.fetch_stall_cycles++;
+            TRACE_FMT(txt, TRACE_PIPELINE, TRACE_LEVEL_INFO, "FETCH waiting (%u/%u)", f->delay_counter, f->delay_target);
+            TRACE(TRACE_PIPELINE, TRACE_LEVEL_DEBUG, "[FETCH] waiting %u/%u cycles\n", f->delay_counter, f->delay_target);
         }
     }
     // 2. Otherwise, start a new fetch
     else {
-        if (branch_taken) {
+        if (ctx->branch_taken) {
             // bubble IF/ID while branch in-flight
             p->IF_ID_next.valid = false;
-            snprintf(txt, sizeof(txt), "FETCH bubble (branch pending)");
-            printf("[FETCH] branch pending, bubble\n");
+            ctx->stats.flush_cycles++;
+            TRACE_FMT(txt, TRACE_PIPELINE, TRACE_LEVEL_INFO, "FETCH bubble (branch pending)");
+            TRACE(TRACE_PIPELINE, TRACE_LEVEL_DEBUG, "[FETCH] branch pending, bubble\n");
         } else {
             // normal fetch issue
-            fetch_pending_address = pc;
+            f->pending_address = pc;
             bool cache_hit = false;
             
-            if (CACHE_ENABLED && cache) {
+            if (ctx->config.cache_enabled && cache) {
                 // Check if the instruction is already in the cache
-                uint16_t block_offset = pc % BLOCK_SIZE;
-                uint16_t block_address = pc - block_offset;
-                uint16_t set_index = (block_address / BLOCK_SIZE) % cache->num_sets;
-                uint16_t tag = block_address / (BLOCK_SIZE * cache->num_sets);
-                
-                // Check if this block is in the cache
-                Set *set = &cache->sets[set_index];
-                for (int i = 0; i < cache->mode; i++) {
-                    if (set->lines[i].valid && set->lines[i].tag == tag) {
-                        cache_hit = true;
-                        break;
-                    }
-                }
+                cache_hit = cache_lookup(cache, pc) >= 0;
             }
             
             // Set appropriate delay based on whether it's a cache hit or miss
-            fetch_delay_target = (CACHE_ENABLED && cache && cache_hit) ? USER_CACHE_DELAY : USER_DRAM_DELAY;
+            f->delay_target = (ctx->config.cache_enabled && cache && cache_hit) ? hitDelay(ctx, cache, pc, hit_delay) : missDelay(ctx, cache, pc, MC_FETCH);
 
-            if (fetch_delay_target > 0) {
-                fetch_memory_busy   = true;
-                fetch_delay_counter = 0;
+            if (f->delay_target > 0) {
+                f->memory_busy   = true;
+                f->delay_counter = 0;
                 p->IF_ID_next.valid = false;
-                snprintf(txt, sizeof(txt), "FETCH waiting (0/%u)", fetch_delay_target);
-                printf("[FETCH] start memory at PC=%u delay=%u, cache hit=%s\n", 
-                       pc, fetch_delay_target, cache_hit ? "true" : "false");
+                ctx->stats.fetch_stall_cycles++;
+                TRACE_FMT(txt, TRACE_PIPELINE, TRACE_LEVEL_INFO, "FETCH waiting (0/%u)", f->delay_target);
+                TRACE(TRACE_PIPELINE, TRACE_LEVEL_DEBUG, "[FETCH] start memory at PC=%u delay=%u, cache hit=%s\n", 
+                       pc, f->delay_target, cache_hit ? "true" : "false");
             } else {
                 bool cache_hit = false;
-                uint16_t word = 0;
-                
-                if (CACHE_ENABLED && cache) {
-                    word = fetch_with_cache(cache, &dram, pc, &cache_hit);
-                } else {
-                    word = readFromMemory(&dram, pc);
-                }
+                uint16_t word = fetch_word(ctx, cache, pc, &cache_hit);
 
-                if (fetch_squash_pending) {
+                if (f->squash_pending) {
                     p->IF_ID_next.valid       = true;
                     p->IF_ID_next.squashed    = true;
                     p->IF_ID_next.pc          = pc;
                     p->IF_ID_next.instruction = word;
-                    fmt_instr(word, formatted);
-                    snprintf(txt, sizeof(txt), "SQUASHED %s", formatted);
-                    printf("[FETCH] PC=%u squashed (flush)\n", pc);
-                    fetch_squash_pending = false;
+                    fmt_instr(word, formatted, sizeof(formatted));
+                    TRACE_FMT(txt, TRACE_PIPELINE, TRACE_LEVEL_INFO, "SQUASHED %s", formatted);
+                    TRACE(TRACE_PIPELINE, TRACE_LEVEL_DEBUG, "[FETCH] PC=%u squashed (flush)\n", pc);
+                    f->squash_pending = false;
                 } else {
                     p->IF_ID_next.valid       = true;
                     p->IF_ID_next.squashed    = false;
                     p->IF_ID_next.pc          = pc;
                     p->IF_ID_next.instruction = word;
-                    fmt_instr(word, txt);
-                    registers->R[15]++;
-                    printf("[FETCH] inst=0x%04X pc=%u immediate, cache hit=%s\n", 
+                    fmt_instr(word, txt, sizeof(txt));
+                    advance_pc(ctx, pc, word);
+                    TRACE(TRACE_PIPELINE, TRACE_LEVEL_DEBUG, "[FETCH] inst=0x%04X pc=%u immediate, cache hit=%s\n", 
                            word, pc, cache_hit ? "true" : "false");
                 }
                 *prev_instr = word;
@@ -198,12 +210,10 @@ void fetch_stage(PipelineState *p, uint16_t *prev_instr) {
     }
 
     // emit UI state
-    printf("[PIPELINE]FETCH:%s:%u\n", txt, fetch_pending_address);
+    TRACE(TRACE_PIPELINE, TRACE_LEVEL_INFO, "[PIPELINE]FETCH:%s:%u\n", txt, f->pending_address);
     
     // For UI visualization of fetch status
-    if (fetch_memory_busy) {
-        printf("[FETCH_STATUS]busy:%u:%u\n", fetch_delay_counter, fetch_delay_target);
+    if (f->memory_busy) {
+        TRACE(TRACE_PIPELINE, TRACE_LEVEL_INFO, "[FETCH_STATUS]busy:%u:%u\n", f->delay_counter, f->delay_target);
     }
-    
-    fflush(stdout);
 }
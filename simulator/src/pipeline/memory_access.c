@@ -3,22 +3,229 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 #include "memory_access.h"
+#include "decode_table.h"
 #include "globals.h"
+#include "trace.h"
+#include "simulator.h"
+#include "prefetch.h"
 
-extern DRAM      dram;
-extern Cache    *cache;
-extern REGISTERS *registers;
-extern bool      memory_operation_in_progress;
+// Train the D-cache prefetcher on the access the instruction in MEM just
+// made; it hit if the cache's miss count is still misses.
+static void train_prefetcher(SimContext *ctx, uint16_t address, uint32_t misses) {
+    prefetch_access(ctx, ctx->prefetch, false, ctx->pipeline.EX_MEM.pc, address, ctx->cache->misses == misses);
+}
+
+// Non-blocking loads (mshrs > 0).  A load that misses in the D-cache, or
+// whose block is already being filled, takes an MSHR and leaves the MEM stage;
+// its register is written when the fill returns (mshr_tick) and the hazard
+// check holds back whatever reads it until then.  The data is read at issue,
+// so a later store cannot leak into it.
+enum { MSHR_HIT, MSHR_ISSUED, MSHR_FULL };
+
+static MSHREntry *mshr_find(MSHRFile *f, uint16_t block) {
+    for (int i = 0; i < f->used; i++)
+        if (f->entry[i].block == block) return &f->entry[i];
+    return NULL;
+}
+
+// Hand a load to the MSHRs.  MSHR_HIT leaves it to the blocking hit path.
+static int mshr_load(SimContext *ctx, uint16_t address, uint16_t regD) {
+    MSHRFile  *f     = &ctx->mshr;
+    Cache     *cache = ctx->cache;
+    uint16_t   block = address & ~(cache->block_size - 1);
+    MSHREntry *e     = mshr_find(f, block);
+
+    if (e) {
+        if (e->count == MSHR_TARGETS) return MSHR_FULL;
+        ctx->stats.mshr_merges++;
+    } else {
+        if (cache_lookup(cache, address) >= 0) return MSHR_HIT;
+        if (f->used >= ctx->config.mshrs) return MSHR_FULL;
+        e = &f->entry[f->used++];
+        e->block = block;
+        uint16_t delay = missDelay(ctx, cache, address, MC_LOAD);
+        // + the write-back cycle; a queued miss learns its latency from the memory controller
+        e->ready = delay == MC_WAIT ? UINT64_MAX : ctx->stats.cycles + delay + 1;
+        e->count = 0;
+        ctx->stats.mshr_misses++;
+    }
+
+    uint32_t misses = cache->misses;
+    uint16_t val = read_cache(cache, &ctx->dram, address);
+    chargeWritebacks(ctx);
+    train_prefetcher(ctx, address, misses);
+    e->reg[e->count]  = regD;
+    e->val[e->count]  = val;
+    e->addr[e->count] = address;
+    e->count++;
+    f->pending_regs |= 1u << regD;
+    TRACE(TRACE_MEM, TRACE_LEVEL_DEBUG, "[MSHR_ISSUE] R%u <= [%u], block %u ready at cycle %llu\n",
+          regD, address, block, (unsigned long long)e->ready);
+    return MSHR_ISSUED;
+}
+
+/**
+ * Retire the loads whose fills have returned: write their registers, which
+ * wakes the instructions waiting on them.  Called every cycle after MEM.
+ */
+void mshr_tick(SimContext *ctx) {
+    MSHRFile *f = &ctx->mshr;
+    for (int i = 0; i < f->used; ) {
+        MSHREntry *e = &f->entry[i];
+        if (ctx->stats.cycles < e->ready) {
+            i++;
+            continue;
+        }
+        for (int t = 0; t < e->count; t++) {
+            ctx->registers->R[e->reg[t]] = e->val[t];
+            f->pending_regs &= ~(1u << e->reg[t]);
+            ctx->stats.instructions++;
+            TRACE(TRACE_MEM, TRACE_LEVEL_DEBUG, "[MSHR_FILL] R%u <= %u from %u\n", e->reg[t], e->val[t], e->addr[t]);
+            TRACE(TRACE_MEM, TRACE_LEVEL_INFO, "[MEM]%u:%u\n", e->addr[t], e->val[t]);
+        }
+        *e = f->entry[--f->used];
+    }
+}
+
+// Words of a block one store buffer entry covers: the D-cache block, or a
+// single word with the caches off.
+static uint16_t sb_span(SimContext *ctx) {
+    if (!ctx->config.cache_enabled || !ctx->cache) return 1;
+    return ctx->cache->block_size < SB_WORDS ? ctx->cache->block_size : SB_WORDS;
+}
+
+// The newest buffered value of address, if any.
+static bool sb_forward(SimContext *ctx, uint16_t address, uint16_t *val) {
+    StoreBuffer *sb   = &ctx->sb;
+    uint16_t     span = sb_span(ctx);
+    for (int i = sb->used - 1; i >= 0; i--) {
+        StoreEntry *e   = &sb->entry[i];
+        uint16_t    off = address - e->block;
+        if (off < span && (e->mask >> off & 1)) {
+            *val = e->val[off];
+            return true;
+        }
+    }
+    return false;
+}
+
+// Retire a store into the buffer, joining the entry already waiting for its
+// block if there is one.  False when it needs a new entry and none is free.
+static bool sb_store(SimContext *ctx, uint16_t address, uint16_t val) {
+    StoreBuffer *sb    = &ctx->sb;
+    uint16_t     span  = sb_span(ctx);
+    uint16_t     block = address & ~(span - 1);
+    StoreEntry  *e     = NULL;
+    for (int i = sb->used - 1; i >= (sb->draining ? 1 : 0); i--)
+        if (sb->entry[i].block == block) e = &sb->entry[i];
+    if (e) {
+        ctx->stats.sb_coalesced++;
+    } else {
+        if (sb->used >= ctx->config.store_buffer) return false;
+        e = &sb->entry[sb->used++];
+        e->block = block;
+        e->mask  = 0;
+    }
+    e->pc = ctx->pipeline.EX_MEM.pc;
+    e->mask |= 1u << (address - block);
+    e->val[address - block] = val;
+    ctx->stats.sb_stores++;
+    return true;
+}
+
+// Write entry[0] to the D-cache (or DRAM) and drop it.
+static void sb_retire(SimContext *ctx) {
+    StoreBuffer *sb    = &ctx->sb;
+    StoreEntry  *e     = &sb->entry[0];
+    Cache       *cache = ctx->cache;
+    uint16_t     span  = sb_span(ctx);
+    uint32_t     misses = cache ? cache->misses : 0;
+    for (uint16_t off = 0; off < span; off++) {
+        if (!(e->mask >> off & 1)) continue;
+        if (ctx->config.cache_enabled && cache)
+            write_cache(cache, &ctx->dram, e->block + off, e->val[off]);
+        else
+            writeToMemory(&ctx->dram, e->block + off, e->val[off]);
+    }
+    if (ctx->config.cache_enabled && cache) {
+        chargeWritebacks(ctx);
+        prefetch_access(ctx, ctx->prefetch, false, e->pc, e->block, cache->misses == misses);
+    }
+    sb->used--;
+    memmove(&sb->entry[0], &sb->entry[1], sb->used * sizeof(StoreEntry));
+    sb->draining = false;
+}
+
+/**
+ * Drain the store buffer in the background: start writing its oldest entry
+ * once no MSHR is filling that block, and retire it when the write is done.
+ * Called every cycle after MEM.
+ */
+void sb_tick(SimContext *ctx) {
+    StoreBuffer *sb    = &ctx->sb;
+    Cache       *cache = ctx->cache;
+    uint64_t     now   = ctx->stats.cycles;
+    if (!sb->used) return;
+    if (!sb->draining) {
+        StoreEntry *e = &sb->entry[0];
+        uint16_t first = e->block;
+        while (!(e->mask >> (first - e->block) & 1)) first++;
+        bool cached = ctx->config.cache_enabled && cache;
+        if (cached && ctx->mshr.used && mshr_find(&ctx->mshr, e->block & ~(cache->block_size - 1)))
+            return;
+        uint16_t delay = (cached && cache_lookup(cache, first) >= 0)
+                       ? hitDelay(ctx, cache, first, ctx->config.cache_delay)
+                       : missDelay(ctx, cache, first, MC_STORE);
+        // a queued write learns its latency from the memory controller
+        sb->ready    = delay == MC_WAIT ? UINT64_MAX : now + delay;
+        sb->draining = true;
+        TRACE(TRACE_MEM, TRACE_LEVEL_DEBUG, "[SB_DRAIN] Block %u, %u entries buffered, done at cycle %llu\n",
+              e->block, sb->used, (unsigned long long)sb->ready);
+    }
+    if (now >= sb->ready) sb_retire(ctx);
+}
+
+// Write every buffered store at once, untimed: before the caches are flushed
+// or rebuilt.
+void sb_flush(SimContext *ctx) {
+    StoreBuffer *sb = &ctx->sb;
+    if (sb->draining && sb->ready == UINT64_MAX) mc_cancel(ctx, MC_STORE);
+    while (sb->used) sb_retire(ctx);
+}
+
+// Write, untimed and in order, every buffered store up to the newest one
+// that falls in [address, address + words): before instruction fetch reads
+// those words, so code written by a store that is still buffered is seen.
+void sb_drain_range(SimContext *ctx, uint16_t address, uint16_t words) {
+    StoreBuffer *sb   = &ctx->sb;
+    uint16_t     span = sb_span(ctx);
+    int          last = -1;
+    for (int i = 0; i < sb->used; i++) {
+        uint16_t block = sb->entry[i].block;
+        if ((uint16_t)(block - address) < words || (uint16_t)(address - block) < span) last = i;
+    }
+    if (last < 0) return;
+    TRACE(TRACE_MEM, TRACE_LEVEL_DEBUG, "[SB_DRAIN] %d entries written ahead of a fetch from %u\n",
+          last + 1, address);
+    if (sb->draining && sb->ready == UINT64_MAX) mc_cancel(ctx, MC_STORE);
+    while (last-- >= 0) sb_retire(ctx);
+}
 
 /**
  * Memory stage: handle loads/stores with cache/DRAM latency, bubble or forward others.
  */
-void memory_access(PipelineState *pipeline) {
+void memory_access(SimContext *ctx) {
+    PipelineState  *pipeline  = &ctx->pipeline;
+    REGISTERS      *registers = ctx->registers;
+    Cache          *cache     = ctx->cache;
+    MemAccessState *m         = &ctx->mem;
+
     // if there's no valid instruction coming from EX_MEM, bubble
     if (!pipeline->EX_MEM.valid) {
         pipeline->MEM_WB_next.valid = false;
-        printf("[PIPELINE]MEMORY:NOP:%d\n", pipeline->EX_MEM.pc);
+        TRACE(TRACE_PIPELINE, TRACE_LEVEL_INFO, "[PIPELINE]MEMORY:NOP:%d\n", pipeline->EX_MEM.pc);
         return;
     }
 
@@ -30,7 +237,7 @@ void memory_access(PipelineState *pipeline) {
         pipeline->MEM_WB_next.opcode = pipeline->EX_MEM.opcode;
         pipeline->MEM_WB_next.regD = pipeline->EX_MEM.regD;
         
-        printf("[PIPELINE]MEMORY:SQUASHED:%d\n", pipeline->EX_MEM.pc);
+        TRACE(TRACE_PIPELINE, TRACE_LEVEL_INFO, "[PIPELINE]MEMORY:SQUASHED:%d\n", pipeline->EX_MEM.pc);
         return;
     }
 
@@ -41,112 +248,160 @@ void memory_access(PipelineState *pipeline) {
     pipeline->MEM_WB_next.opcode = pipeline->EX_MEM.opcode;
     pipeline->MEM_WB_next.regD = pipeline->EX_MEM.regD;
     pipeline->MEM_WB_next.resMod = pipeline->EX_MEM.resMod;
+    pipeline->MEM_WB_next.handler = pipeline->EX_MEM.handler;
+    pipeline->MEM_WB_next.functional_unit = pipeline->EX_MEM.functional_unit;
+    pipeline->MEM_WB_next.dst_mask = pipeline->EX_MEM.dst_mask;
+    pipeline->MEM_WB_next.taken = pipeline->EX_MEM.taken;
+    pipeline->MEM_WB_next.target = pipeline->EX_MEM.target;
 
     uint16_t opcode = pipeline->EX_MEM.opcode;
+    uint16_t handler = pipeline->EX_MEM.handler;
     uint16_t address = pipeline->EX_MEM.res;  // ALU result
-    static bool     busy = false;
-    static uint16_t delay = 0, target = 0;
-    static uint16_t pend_addr, pend_opcode, pend_regD, pend_val;
-
     char instruction_text[64];
 
+    // A load of a buffered store takes its data from the store buffer; any
+    // other load into a general register can be handed to the MSHRs
+    uint16_t forward_val = 0;
+    bool     forward     = !m->busy && handler == H_LW && ctx->sb.used && sb_forward(ctx, address, &forward_val);
+    int mshr = MSHR_HIT;
+    if (!m->busy && !forward && handler == H_LW && ctx->config.mshrs && ctx->config.cache_enabled && cache &&
+        pipeline->EX_MEM.regD != 15)
+        mshr = mshr_load(ctx, address, pipeline->EX_MEM.regD);
+
     // 1) If a memory operation is already in flight, tick the countdown
-    if (busy) {
-        memory_operation_in_progress = true;
-        delay++;
-        printf("[MEM_DELAY] Cycle %u of %u\n", delay, target);
+    if (m->busy) {
+        ctx->memory_operation_in_progress = true;
+        m->delay++;
+        TRACE(TRACE_MEM, TRACE_LEVEL_DEBUG, "[MEM_DELAY] Cycle %u of %u\n", m->delay, m->target);
 
-        if (delay >= target) {
+        if (m->delay >= m->target) {
             // complete it
-            if (pend_opcode == 0x9 || pend_opcode == 5) {
+            if (m->pend_handler == H_LW) {
                 // LW
                 uint16_t val;
-                if (CACHE_ENABLED && cache != NULL) {
-                    val = read_cache(cache, &dram, pend_addr);
+                if (m->forwarded) {
+                    val = m->pend_val;
+                } else if (ctx->config.cache_enabled && cache != NULL) {
+                    uint32_t misses = cache->misses;
+                    val = read_cache(cache, &ctx->dram, m->pend_addr);
+                    chargeWritebacks(ctx);
+                    train_prefetcher(ctx, m->pend_addr, misses);
                 } else {
-                    val = readFromMemory(&dram, pend_addr);
+                    val = readFromMemory(&ctx->dram, m->pend_addr);
                 }
                 pipeline->MEM_WB_next.res = val;
-                sprintf(instruction_text, "LW  R%u,[%u] complete", pend_regD, pend_addr);
-                printf("[MEM_LOAD_COMPLETE] R%u <= %u from %u\n", pend_regD, val, pend_addr);
-                printf("[MEM]%u:%u\n", pend_addr, val);
+                TRACE_FMT(instruction_text, TRACE_PIPELINE, TRACE_LEVEL_INFO, "LW  R%u,[%u] complete", m->pend_regD, m->pend_addr);
+                TRACE(TRACE_MEM, TRACE_LEVEL_DEBUG, "[MEM_LOAD_COMPLETE] R%u <= %u from %u\n", m->pend_regD, val, m->pend_addr);
+                TRACE(TRACE_MEM, TRACE_LEVEL_INFO, "[MEM]%u:%u\n", m->pend_addr, val);
             } else {
                 // SW
-                if (CACHE_ENABLED && cache != NULL) {
-                    write_through(cache, &dram, pend_addr, pend_val);
+                if (ctx->config.cache_enabled && cache != NULL) {
+                    uint32_t misses = cache->misses;
+                    write_cache(cache, &ctx->dram, m->pend_addr, m->pend_val);
+                    chargeWritebacks(ctx);
+                    train_prefetcher(ctx, m->pend_addr, misses);
                 } else {
-                    writeToMemory(&dram, pend_addr, pend_val);
+                    writeToMemory(&ctx->dram, m->pend_addr, m->pend_val);
                 }
-                sprintf(instruction_text, "SW  [%u] <= %u complete", pend_addr, pend_val);
-                printf("[MEM_STORE_COMPLETE] [%u] <= %u\n", pend_addr, pend_val);
-                printf("[MEM]%u:%u\n", pend_addr, pend_val);
+                TRACE_FMT(instruction_text, TRACE_PIPELINE, TRACE_LEVEL_INFO, "SW  [%u] <= %u complete", m->pend_addr, m->pend_val);
+                TRACE(TRACE_MEM, TRACE_LEVEL_DEBUG, "[MEM_STORE_COMPLETE] [%u] <= %u\n", m->pend_addr, m->pend_val);
+                TRACE(TRACE_MEM, TRACE_LEVEL_INFO, "[MEM]%u:%u\n", m->pend_addr, m->pend_val);
             }
-            busy = false;
-            memory_operation_in_progress = false;
-            delay = 0;
+            m->busy = false;
+            ctx->memory_operation_in_progress = false;
+            m->delay = 0;
         } else {
             // still waiting → bubble
             pipeline->MEM_WB_next.valid = false;
             // but set a generic text so we can see we're waiting
-            sprintf(instruction_text, "MEM waiting (%u/%u)", delay, target);
+            TRACE_FMT(instruction_text, TRACE_PIPELINE, TRACE_LEVEL_INFO, "MEM waiting (%u/%u)", m->delay, m->target);
         }
     }
-    // 2) Otherwise, if this is a new LW or SW, start it
-    else if (opcode == 0x9 || opcode == 5) {
+    // 2) Otherwise, if this is a new LW or SW, start it.  A load miss in an
+    // MSHR leaves straight away, or waits here for a free entry; a store to a
+    // block still being filled waits for the fill.
+    else if (mshr != MSHR_HIT) {
+        pipeline->MEM_WB_next.valid = false;
+        if (mshr == MSHR_FULL) {
+            ctx->memory_operation_in_progress = true;
+            TRACE_FMT(instruction_text, TRACE_PIPELINE, TRACE_LEVEL_INFO, "LW  R%u,[%u] waiting for an MSHR",
+                      pipeline->EX_MEM.regD, address);
+        } else {
+            ctx->memory_operation_in_progress = false;
+            TRACE_FMT(instruction_text, TRACE_PIPELINE, TRACE_LEVEL_INFO, "LW  R%u,[%u] miss in MSHR",
+                      pipeline->EX_MEM.regD, address);
+        }
+    }
+    else if (handler == H_SW && ctx->config.store_buffer) {
+        uint16_t val = registers->R[pipeline->EX_MEM.regD];
+        if (sb_store(ctx, address, val)) {
+            ctx->memory_operation_in_progress = false;
+            TRACE_FMT(instruction_text, TRACE_PIPELINE, TRACE_LEVEL_INFO, "SW  [%u] <= %u buffered", address, val);
+            TRACE(TRACE_MEM, TRACE_LEVEL_INFO, "[MEM]%u:%u\n", address, val);
+        } else {
+            pipeline->MEM_WB_next.valid = false;
+            ctx->memory_operation_in_progress = true;
+            ctx->stats.sb_full_cycles++;
+            TRACE_FMT(instruction_text, TRACE_PIPELINE, TRACE_LEVEL_INFO, "SW  [%u] waiting for the store buffer", address);
+        }
+    }
+    else if (handler == H_SW && ctx->mshr.used && cache &&
+             mshr_find(&ctx->mshr, address & ~(cache->block_size - 1))) {
+        pipeline->MEM_WB_next.valid = false;
+        ctx->memory_operation_in_progress = true;
+        TRACE_FMT(instruction_text, TRACE_PIPELINE, TRACE_LEVEL_INFO, "SW  [%u] waiting for fill", address);
+    }
+    else if (handler == H_LW) {
         // Load word
         bool hit = false;
-        if (CACHE_ENABLED && cache) {
-            uint16_t idx = (address / BLOCK_SIZE) % cache->num_sets;
-            uint16_t tag = address / (BLOCK_SIZE * cache->num_sets);
-            for (int i = 0; i < cache->mode; i++)
-                if (cache->sets[idx].lines[i].valid &&
-                    cache->sets[idx].lines[i].tag == tag)
-                    hit = true;
+        if (ctx->config.cache_enabled && cache) {
+            hit = cache_lookup(cache, address) >= 0;
+        } else {
+            m->target = ctx->config.dram_delay;
+            TRACE(TRACE_MEM, TRACE_LEVEL_DEBUG, "[MEMORY] Cache disabled, using DRAM access delay of %d cycles\n", ctx->config.dram_delay);
+        }
+        m->forwarded = forward;
+        if (forward) {
+            m->target   = ctx->config.cache_delay;
+            m->pend_val = forward_val;
+            ctx->stats.sb_forwards++;
         } else {
-            target = USER_DRAM_DELAY;
-            printf("[MEMORY] Cache disabled, using DRAM access delay of %d cycles\n", USER_DRAM_DELAY);
+            m->target = (ctx->config.cache_enabled && cache && hit) ? hitDelay(ctx, cache, address, ctx->config.cache_delay) : missDelay(ctx, cache, address, MC_LOAD);
         }
-        target = (CACHE_ENABLED && cache && hit) ? USER_CACHE_DELAY : USER_DRAM_DELAY;
-        pend_addr = address;
-        pend_opcode = opcode;
-        pend_regD = pipeline->EX_MEM.regD;
-        busy = true;
-        delay = 0;
-        memory_operation_in_progress = true;
-        sprintf(instruction_text, "LW  R%u,[%u] start", pend_regD, pend_addr);
+        m->pend_addr = address;
+        m->pend_handler = handler;
+        m->pend_regD = pipeline->EX_MEM.regD;
+        m->busy = true;
+        m->delay = 0;
+        ctx->memory_operation_in_progress = true;
+        TRACE_FMT(instruction_text, TRACE_PIPELINE, TRACE_LEVEL_INFO, "LW  R%u,[%u] start", m->pend_regD, m->pend_addr);
         pipeline->MEM_WB_next.valid = false;
     }
-    else if (opcode == 0xA || opcode == 4) {
+    else if (handler == H_SW) {
         // Store word
         uint16_t val = registers->R[pipeline->EX_MEM.regD];
         bool hit = false;
-        if (CACHE_ENABLED && cache) {
-            uint16_t idx = (address / BLOCK_SIZE) % cache->num_sets;
-            uint16_t tag = address / (BLOCK_SIZE * cache->num_sets);
-            for (int i = 0; i < cache->mode; i++)
-                if (cache->sets[idx].lines[i].valid &&
-                    cache->sets[idx].lines[i].tag == tag)
-                    hit = true;
+        if (ctx->config.cache_enabled && cache) {
+            hit = cache_lookup(cache, address) >= 0;
         }
-        target = (CACHE_ENABLED && cache && hit) ? USER_CACHE_DELAY : USER_DRAM_DELAY;
-        pend_addr = address;
-        pend_opcode = opcode;
-        pend_val = val;
-        busy = true;
-        delay = 0;
-        memory_operation_in_progress = true;
-        sprintf(instruction_text, "SW  [%u] <= %u start", pend_addr, pend_val);
+        m->target = (ctx->config.cache_enabled && cache && hit) ? hitDelay(ctx, cache, address, ctx->config.cache_delay) : missDelay(ctx, cache, address, MC_STORE);
+        m->pend_addr = address;
+        m->pend_handler = handler;
+        m->pend_val = val;
+        m->busy = true;
+        m->delay = 0;
+        ctx->memory_operation_in_progress = true;
+        TRACE_FMT(instruction_text, TRACE_PIPELINE, TRACE_LEVEL_INFO, "SW  [%u] <= %u start", m->pend_addr, m->pend_val);
         pipeline->MEM_WB_next.valid = false;
     }
     // 3) Non-memory op: just forward the ALU result
     else {
         pipeline->MEM_WB_next.res = pipeline->EX_MEM.res;
-        memory_operation_in_progress = false;
-        sprintf(instruction_text, "ALU    result=%u", pipeline->EX_MEM.res);
+        ctx->memory_operation_in_progress = false;
+        TRACE_FMT(instruction_text, TRACE_PIPELINE, TRACE_LEVEL_INFO, "ALU    result=%u", pipeline->EX_MEM.res);
     }
 
     // final pipeline UI print: show exactly what we built above
-    printf("[MEMORY] opcode=%u addr=%u\n", opcode, address);
-    printf("[PIPELINE]MEMORY:%s:%d\n", instruction_text, pipeline->EX_MEM.pc);
-    fflush(stdout);
+    TRACE(TRACE_MEM, TRACE_LEVEL_DEBUG, "[MEMORY] opcode=%u addr=%u\n", opcode, address);
+    TRACE(TRACE_PIPELINE, TRACE_LEVEL_INFO, "[PIPELINE]MEMORY:%s:%d\n", instruction_text, pipeline->EX_MEM.pc);
 }
@@ -5,27 +5,29 @@
 #include "write_back.h"
 #include "pipeline.h"
 #include "memory.h"
+#include "trace.h"
+#include "simulator.h"
 
-extern REGISTERS *registers;
-extern bool branch_taken;
-extern uint16_t branch_target_address;
+void write_back(SimContext *ctx) {
+    PipelineState *pipeline  = &ctx->pipeline;
+    REGISTERS     *registers = ctx->registers;
 
-void write_back(PipelineState *pipeline) {
     // If there's no valid entry from MEM/WB, bubble
     if (!pipeline->MEM_WB.valid) {
         pipeline->WB_next.valid = false;
-        printf("[PIPELINE]WRITEBACK:NOP:%d\n", pipeline->MEM_WB.pc);
+        TRACE(TRACE_PIPELINE, TRACE_LEVEL_INFO, "[PIPELINE]WRITEBACK:NOP:%d\n", pipeline->MEM_WB.pc);
         return;
     }
 
     // If this instruction is squashed, just propagate it but don't perform any operations
     if (pipeline->MEM_WB.squashed) {
+        ctx->stats.flush_cycles++;
         pipeline->WB_next.valid = true;
         pipeline->WB_next.squashed = true;
         pipeline->WB_next.pc = pipeline->MEM_WB.pc;
         pipeline->WB_next.opcode = pipeline->MEM_WB.opcode;
         
-        printf("[PIPELINE]WRITEBACK:SQUASHED:%d\n", pipeline->MEM_WB.pc);
+        TRACE(TRACE_PIPELINE, TRACE_LEVEL_INFO, "[PIPELINE]WRITEBACK:SQUASHED:%d\n", pipeline->MEM_WB.pc);
         return;
     }
 
@@ -33,7 +35,7 @@ void write_back(PipelineState *pipeline) {
     uint16_t opcode = pipeline->MEM_WB.opcode;
     uint16_t regD = pipeline->MEM_WB.regD;
     uint16_t result = pipeline->MEM_WB.res;
-    char instruction_text[64];
+    char instruction_text[64] = "NOP";
 
     // Prepare next-stage state
     pipeline->WB_next.valid = true;
@@ -47,91 +49,98 @@ void write_back(PipelineState *pipeline) {
     switch (opcode) {
         case 0:  // ADD
             registers->R[regD] = result;
-            sprintf(instruction_text, "ADD   R%u = %u", regD, result);
+            TRACE_FMT(instruction_text, TRACE_PIPELINE, TRACE_LEVEL_INFO, "ADD   R%u = %u", regD, result);
             break;
         case 1:  // SUB
             registers->R[regD] = result;
-            sprintf(instruction_text, "SUB   R%u = %u", regD, result);
+            TRACE_FMT(instruction_text, TRACE_PIPELINE, TRACE_LEVEL_INFO, "SUB   R%u = %u", regD, result);
             break;
         case 2:  // NAND
             registers->R[regD] = result;
-            sprintf(instruction_text, "NAND  R%u = %u", regD, result);
+            TRACE_FMT(instruction_text, TRACE_PIPELINE, TRACE_LEVEL_INFO, "NAND  R%u = %u", regD, result);
             break;
         case 3:  // LUI
             registers->R[regD] = result;
-            sprintf(instruction_text, "LUI   R%u = %u", regD, result);
+            TRACE_FMT(instruction_text, TRACE_PIPELINE, TRACE_LEVEL_INFO, "LUI   R%u = %u", regD, result);
             break;
-        case 4:  // SW: no register write
-            sprintf(instruction_text, "SW    (no reg)");
+        case 4:  // XOR
+            registers->R[regD] = result;
+            TRACE_FMT(instruction_text, TRACE_PIPELINE, TRACE_LEVEL_INFO, "XOR   R%u = %u", regD, result);
             break;
         case 5:  // DIVMOD (we wrote quotient in res, remainder in resMod earlier)
             registers->R[regD] = result;
-            sprintf(instruction_text, "DIVMOD R%u = %u", regD, result);
+            TRACE_FMT(instruction_text, TRACE_PIPELINE, TRACE_LEVEL_INFO, "DIVMOD R%u = %u", regD, result);
             break;
         case 6:  // MUL
             registers->R[regD] = result;
-            sprintf(instruction_text, "MUL   R%u = %u", regD, result);
+            TRACE_FMT(instruction_text, TRACE_PIPELINE, TRACE_LEVEL_INFO, "MUL   R%u = %u", regD, result);
             break;
         case 7:  // CMP (we put result in SR / R14)
             registers->R[14] = result;
-            sprintf(instruction_text, "CMP   SR = %u", result);
+            TRACE_FMT(instruction_text, TRACE_PIPELINE, TRACE_LEVEL_INFO, "CMP   SR = %u", result);
             break;
         case 8:  // Shifts: res already contains the shifted value
             registers->R[regD] = result;
-            sprintf(instruction_text, "SH    R%u = %u", regD, result);
+            TRACE_FMT(instruction_text, TRACE_PIPELINE, TRACE_LEVEL_INFO, "SH    R%u = %u", regD, result);
             break;
         case 9:  // LW (new opcode)
             registers->R[regD] = result;
-            sprintf(instruction_text, "LW    R%u = %u", regD, result);
+            TRACE_FMT(instruction_text, TRACE_PIPELINE, TRACE_LEVEL_INFO, "LW    R%u = %u", regD, result);
             break;
         case 10: // SW (new opcode)
-            sprintf(instruction_text, "SW    (no reg)");
+            TRACE_FMT(instruction_text, TRACE_PIPELINE, TRACE_LEVEL_INFO, "SW    (no reg)");
             break;
         case 11: // BEQ
-            // For branches, we now update the PC in writeback if branch_taken is true
-            if (branch_taken) {
+            // Without a branch predictor a taken branch redirects the PC here;
+            // with one, fetch already followed it
+            if (ctx->branch_taken) {
                 // Set PC directly to branch target (don't rely on PC increment)
-                registers->R[15] = branch_target_address;
+                registers->R[15] = ctx->branch_target_address;
                 
-                printf("[WRITEBACK_BEQ] Updated PC to %u\n", branch_target_address);
-                branch_taken = false;  // Reset flag after updating PC
-                sprintf(instruction_text, "BEQ   branch taken → PC=%u", branch_target_address);
+                TRACE(TRACE_PIPELINE, TRACE_LEVEL_DEBUG, "[WRITEBACK_BEQ] Updated PC to %u\n", ctx->branch_target_address);
+                ctx->branch_taken = false;  // Reset flag after updating PC
+            }
+            if (pipeline->MEM_WB.taken) {
+                TRACE_FMT(instruction_text, TRACE_PIPELINE, TRACE_LEVEL_INFO, "BEQ   branch taken → PC=%u", pipeline->MEM_WB.target);
             } else {
-                sprintf(instruction_text, "BEQ   branch not taken");
+                TRACE_FMT(instruction_text, TRACE_PIPELINE, TRACE_LEVEL_INFO, "BEQ   branch not taken");
             }
             break;
         case 0xC: // JMP
-            // For JMP, we always update the PC in writeback
-            if (branch_taken) {
+            if (ctx->branch_taken) {
                 // Set PC directly to jump target address
-                registers->R[15] = branch_target_address;
+                registers->R[15] = ctx->branch_target_address;
                 
-                printf("[WRITEBACK_JMP] Updated PC to %u\n", branch_target_address);
-                branch_taken = false;  // Reset flag after updating PC
-                sprintf(instruction_text, "JMP   → PC=%u", branch_target_address);
+                TRACE(TRACE_PIPELINE, TRACE_LEVEL_DEBUG, "[WRITEBACK_JMP] Updated PC to %u\n", ctx->branch_target_address);
+                ctx->branch_taken = false;  // Reset flag after updating PC
             }
+            TRACE_FMT(instruction_text, TRACE_PIPELINE, TRACE_LEVEL_INFO, "JMP   → PC=%u", pipeline->MEM_WB.target);
             break;
         case 0xF:// BLT
-            // For branches, we now update the PC in writeback if branch_taken is true
-            if (branch_taken) {
+            if (ctx->branch_taken) {
                 // Set PC directly to branch target (don't rely on PC increment)
-                registers->R[15] = branch_target_address;
+                registers->R[15] = ctx->branch_target_address;
                 
-                printf("[WRITEBACK_BLT] Updated PC to %u\n", branch_target_address);
-                branch_taken = false;  // Reset flag after updating PC
-                sprintf(instruction_text, "BLT   branch taken → PC=%u", branch_target_address);
+                TRACE(TRACE_PIPELINE, TRACE_LEVEL_DEBUG, "[WRITEBACK_BLT] Updated PC to %u\n", ctx->branch_target_address);
+                ctx->branch_taken = false;  // Reset flag after updating PC
+            }
+            if (pipeline->MEM_WB.taken) {
+                TRACE_FMT(instruction_text, TRACE_PIPELINE, TRACE_LEVEL_INFO, "BLT   branch taken → PC=%u", pipeline->MEM_WB.target);
             } else {
-                sprintf(instruction_text, "BLT   branch not taken");
+                TRACE_FMT(instruction_text, TRACE_PIPELINE, TRACE_LEVEL_INFO, "BLT   branch not taken");
             }
             break;
         default:
             // Unexpected opcode: treat as NOP
             pipeline->WB_next.valid = false;
-            sprintf(instruction_text, "NOP");
+            TRACE_FMT(instruction_text, TRACE_PIPELINE, TRACE_LEVEL_INFO, "NOP");
             break;
     }
 
+    if (pipeline->WB_next.valid) {
+        ctx->stats.instructions++;
+    }
+
     // Final UI print
-    printf("[PIPELINE]WRITEBACK:%s:%d\n", instruction_text, pipeline->MEM_WB.pc);
-    fflush(stdout);
+    TRACE(TRACE_PIPELINE, TRACE_LEVEL_INFO, "[PIPELINE]WRITEBACK:%s:%d\n", instruction_text, pipeline->MEM_WB.pc);
 }
@@ -0,0 +1,230 @@
+// prefetch.c – hardware prefetchers for the L1 caches (the prefetch knob).
+//
+// Each L1 gets its own prefetcher, trained on that cache's demand accesses.
+// A predicted block is queued as a fill: from the L2 when it holds the block,
+// else from DRAM, where it occupies the DRAM (or its bank) like a write-back
+// and so delays the demand misses behind it.  The fill lands in the cache (prefetch_line)
+// once its transfer completes; a demand miss that finds its block still in
+// the queue waits out the rest of the transfer instead of starting its own.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "memctrl.h"
+#include "memory_access.h"
+#include "prefetch.h"
+#include "simulator.h"
+#include "trace.h"
+
+typedef struct {
+    const char *name;
+    void (*train)(SimContext *ctx, Prefetcher *pf, bool fetch, uint16_t pc, uint16_t address, bool hit);
+} PrefetchKind;
+
+static uint16_t block_of(const Prefetcher *pf, uint16_t address) {
+    return address & ~(pf->cache->block_size - 1);
+}
+
+static PrefetchFill *find_fill(Prefetcher *pf, uint16_t block) {
+    for (int i = 0; i < pf->queued; i++)
+        if (pf->queue[i].block == block) return &pf->queue[i];
+    return NULL;
+}
+
+// Queue a fill for block unless it is resident or already on its way.
+static void issue(SimContext *ctx, Prefetcher *pf, uint16_t block) {
+    if (cache_lookup(pf->cache, block) >= 0 || victim_lookup(pf->cache, block) >= 0 || find_fill(pf, block))
+        return;
+    if (pf->queued == PF_QUEUE) {
+        pf->dropped++;
+        return;
+    }
+
+    uint64_t now = ctx->stats.cycles, ready;
+    if (ctx->l2 && cache_lookup(ctx->l2, block) >= 0) {
+        ready = now + ctx->config.l2_delay;
+    } else if (mc_submit(ctx, MC_PREFETCH, block, pf->cache, ctx->l2 ? ctx->config.l2_delay : 0)) {
+        ready = UINT64_MAX;     // known once the memory controller issues it (prefetch_ready)
+    } else {
+        if (ctx->dram.timing.banks) {
+            ready = dram_access(&ctx->dram, now, block);
+        } else {
+            uint64_t start = ctx->dram_busy_until > now ? ctx->dram_busy_until : now;
+            ready = ctx->dram_busy_until = start + ctx->config.dram_delay;
+        }
+        ready = busTransfer(ctx, pf->cache, block, ready, false) + (ctx->l2 ? ctx->config.l2_delay : 0);
+    }
+    PrefetchFill *f = &pf->queue[pf->queued++];
+    f->block    = block;
+    f->ready    = ready;
+    f->demanded = false;
+    pf->issued++;
+    TRACE(TRACE_CACHE, TRACE_LEVEL_DEBUG, "[%s_PREFETCH] Block %u queued, ready at cycle %llu\n",
+          pf->cache->label, block, (unsigned long long)ready);
+}
+
+static void no_train(SimContext *ctx, Prefetcher *pf, bool fetch, uint16_t pc, uint16_t address, bool hit) {
+    (void)ctx; (void)pf; (void)fetch; (void)pc; (void)address; (void)hit;
+}
+
+// ---- next-N-line: entering a block fetches the degree blocks after it ----
+
+static void next_line_train(SimContext *ctx, Prefetcher *pf, bool fetch, uint16_t pc, uint16_t address, bool hit) {
+    (void)fetch; (void)pc; (void)hit;
+    uint16_t bs = pf->cache->block_size, block = block_of(pf, address);
+    if (block == pf->last_block) return;
+    pf->last_block = block;
+    for (uint16_t i = 1; i <= pf->degree; i++) issue(ctx, pf, block + i * bs);
+}
+
+// ---- stride: a load or store PC whose address moved by the same stride
+//      twice in a row runs degree strides (at least a block each) ahead.
+//      Instruction fetches, where every PC is its own address, are ignored ----
+
+static void stride_train(SimContext *ctx, Prefetcher *pf, bool fetch, uint16_t pc, uint16_t address, bool hit) {
+    (void)hit;
+    if (fetch) return;
+    StrideEntry *e = &pf->table[pc % PF_TABLE];
+    if (!e->valid || e->pc != pc) {
+        *e = (StrideEntry){ .pc = pc, .last = address, .valid = true };
+        return;
+    }
+    int16_t stride = (int16_t)(address - e->last);
+    if (stride == 0) return;
+    if (stride == e->stride) {
+        if (e->conf < 3) e->conf++;
+    } else {
+        e->stride = stride;
+        e->conf   = 0;
+    }
+    e->last = address;
+    if (e->conf == 0) return;
+
+    int32_t bs = pf->cache->block_size, step = stride;
+    if (step > -bs && step < bs) step = stride > 0 ? bs : -bs;
+    for (int32_t i = 1; i <= pf->degree; i++)
+        issue(ctx, pf, block_of(pf, (uint16_t)(address + i * step)));
+}
+
+// ---- stream buffers: a miss that no stream expected starts one (descending
+//      if the previous miss was the block above), and each access to the
+//      block a stream expects next keeps it degree blocks ahead ----
+
+static void stream_train(SimContext *ctx, Prefetcher *pf, bool fetch, uint16_t pc, uint16_t address, bool hit) {
+    (void)fetch; (void)pc;
+    int32_t  bs    = pf->cache->block_size;
+    uint16_t block = block_of(pf, address);
+    StreamBuffer *s = NULL, *victim = &pf->stream[0];
+    for (int i = 0; i < PF_STREAMS; i++) {
+        StreamBuffer *b = &pf->stream[i];
+        if (b->valid && b->next == block) s = b;
+        if (!b->valid ? victim->valid : (victim->valid && b->used < victim->used)) victim = b;
+    }
+
+    if (!s) {
+        if (hit) return;
+        int16_t dir = (uint16_t)(pf->last_miss - block) == bs ? -1 : 1;
+        pf->last_miss = block;
+        s = victim;
+        s->valid = true;
+        s->dir   = dir;
+        s->ahead = block;
+    } else if (!hit) {
+        pf->last_miss = block;
+    }
+    s->next = (uint16_t)(block + s->dir * bs);
+    s->used = ctx->stats.cycles;
+    for (int32_t dist = (int16_t)(s->ahead - block) * s->dir; dist < pf->degree * bs; dist += bs) {
+        s->ahead = (uint16_t)(s->ahead + s->dir * bs);
+        issue(ctx, pf, s->ahead);
+    }
+}
+
+static const PrefetchKind kinds[PF_COUNT] = {
+    [PF_NONE]      = { "none",     no_train },
+    [PF_NEXT_LINE] = { "nextline", next_line_train },
+    [PF_STRIDE]    = { "stride",   stride_train },
+    [PF_STREAM]    = { "stream",   stream_train },
+};
+
+int prefetch_kind_id(const char *name) {
+    for (int k = 0; k < PF_COUNT; k++)
+        if (strcmp(name, kinds[k].name) == 0) return k;
+    char *end;
+    unsigned long k = strtoul(name, &end, 0);
+    return (*name && !*end && k < PF_COUNT) ? (int)k : -1;
+}
+
+const char *prefetch_kind_name(int kind) {
+    return (kind >= 0 && kind < PF_COUNT) ? kinds[kind].name : "?";
+}
+
+/**
+ * A prefetcher of kind (PF_*) for cache, degree blocks ahead; NULL for
+ * PF_NONE or no cache.  The caller frees it.
+ */
+Prefetcher *init_prefetcher(int kind, uint16_t degree, Cache *cache) {
+    if (kind <= PF_NONE || kind >= PF_COUNT || !cache) return NULL;
+    Prefetcher *pf = (Prefetcher *)calloc(1, sizeof(Prefetcher));
+    if (!pf) return NULL;
+    pf->kind   = kind;
+    pf->degree = degree ? degree : 1;
+    pf->cache  = cache;
+    return pf;
+}
+
+// Train on a demand access to address: an instruction fetch, or a load or
+// store by the instruction at pc.
+void prefetch_access(SimContext *ctx, Prefetcher *pf, bool fetch, uint16_t pc, uint16_t address, bool hit) {
+    if (!pf || !ctx->config.cache_enabled) return;
+    kinds[pf->kind].train(ctx, pf, fetch, pc, address, hit);
+}
+
+// Cycles until an in-flight prefetch brings in the block holding address, or
+// -1 if none is (one still queued in the memory controller is not yet in
+// flight).  Its fill then counts as late instead of as a prefetch hit.
+int prefetch_wait(SimContext *ctx, Prefetcher *pf, uint16_t address) {
+    PrefetchFill *f = pf ? find_fill(pf, block_of(pf, address)) : NULL;
+    if (!f || f->ready == UINT64_MAX) return -1;
+    if (!f->demanded) {
+        f->demanded = true;
+        pf->late++;
+    }
+    uint64_t now = ctx->stats.cycles;
+    return f->ready > now ? (int)(f->ready - now) : 0;
+}
+
+// The memory controller issued the fill of block: it lands at cycle ready.
+void prefetch_ready(Prefetcher *pf, uint16_t block, uint64_t ready) {
+    PrefetchFill *f = pf ? find_fill(pf, block) : NULL;
+    if (f) f->ready = ready;
+}
+
+/**
+ * Land the fills whose transfers are done.  Called at the start of every
+ * cycle, so a demand access timed to a fill's ready cycle finds it resident.
+ */
+void prefetch_tick(SimContext *ctx) {
+    Prefetcher *pfs[2] = { ctx->prefetch, ctx->iprefetch };
+    bool landed = false;
+    for (int p = 0; p < 2; p++) {
+        Prefetcher *pf = pfs[p];
+        if (!pf) continue;
+        for (int i = 0; i < pf->queued; ) {
+            PrefetchFill *f = &pf->queue[i];
+            if (ctx->stats.cycles < f->ready) {
+                i++;
+                continue;
+            }
+            // as on an I-cache demand miss, buffered stores and dirty D-cache
+            // copies go down first
+            if (pf->cache == ctx->icache) {
+                if (ctx->sb.used) sb_drain_range(ctx, f->block, pf->cache->block_size);
+                writeback_range(ctx->cache, &ctx->dram, f->block, pf->cache->block_size);
+            }
+            prefetch_line(pf->cache, &ctx->dram, f->block, f->demanded);
+            *f = pf->queue[--pf->queued];
+            landed = true;
+        }
+    }
+    if (landed) chargeWritebacks(ctx);
+}
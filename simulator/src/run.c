@@ -0,0 +1,200 @@
+// run.c – headless batch runner.
+//
+//   arch16-run [-m max_cycles] [-F] [-w pc] [-d cycles] [key=value ...] program.txt
+//
+// Assembles the program straight into DRAM, runs it to completion and prints
+// a compact summary.  key=value pairs are the same knobs the "config" command
+// takes (pipe, cache, dram, cache_delay, cache_mode, trace, ...); an unknown
+// key or a bad value prints the usage and exits with status 2.  Tracing is
+// off unless a trace= knob asks for it.
+//
+// Mode switches: -F runs the whole program on the functional interpreter,
+// -w fast-forwards functionally until PC reaches the given address before
+// going cycle-accurate, and -d drops back to functional mode after the given
+// number of cycle-accurate cycles.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "memory.h"
+#include "simulator.h"
+#include "globals.h"
+#include "prefetch.h"
+#include "trace.h"
+
+static void usage(const char *prog) {
+    fflush(stdout);     // after any [CONFIG] complaint
+    fprintf(stderr, "usage: %s [-m max_cycles] [-F] [-w pc] [-d cycles] [key=value ...] program.txt\n"
+                    "keys:", prog);
+    print_config_keys(stderr, false);
+}
+
+// A prefetcher's counters.  Useful fills are those a demand access hit before
+// eviction plus the late ones a demand miss waited for.
+static void report_prefetch(const char *label, const Prefetcher *pf) {
+    if (!pf) return;
+    uint32_t useful = pf->cache->prefetch_hits + pf->late;
+    printf("%-14s%s x%u: %u issued, %u useful (%u late), %u unused, %u dropped (%.1f%% accuracy)\n",
+           label, prefetch_kind_name(pf->kind), pf->degree, pf->issued, useful, pf->late,
+           pf->cache->prefetch_unused, pf->dropped, pf->issued ? 100.0 * useful / pf->issued : 0.0);
+}
+
+// Victim buffer behind an L1: the share of its misses a swap recovered.
+static void report_victims(const char *label, const Cache *cache) {
+    const VictimBuffer *vb = cache ? cache->victims : NULL;
+    if (!vb) return;
+    uint32_t lookups = vb->hits + vb->misses;
+    printf("%-14s%u hits, %u misses (%.1f%% hit rate, %u entries)\n",
+           label, vb->hits, vb->misses, lookups ? 100.0 * vb->hits / lookups : 0.0, vb->entries);
+}
+
+int main(int argc, char **argv) {
+    const char *path = NULL;
+    uint64_t max_cycles = 0;
+    uint64_t detail_cycles = 0;     // -d: cycle-accurate budget before going functional
+    int32_t  warm_pc = -1;          // -w: fast-forward target
+    bool     functional_only = false;
+    char params[512] = "";
+
+    trace_configure(TRACE_LEVEL_OFF, TRACE_ALL);
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            max_cycles = strtoull(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-F") == 0) {
+            functional_only = true;
+        } else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+            warm_pc = (int32_t)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            detail_cycles = strtoull(argv[++i], NULL, 0);
+        } else if (strchr(argv[i], '=')) {
+            strncat(params, " ", sizeof(params) - strlen(params) - 1);
+            strncat(params, argv[i], sizeof(params) - strlen(params) - 1);
+        } else if (!path) {
+            path = argv[i];
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (!path) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    SimContext *ctx = init_context();
+    if (params[0] && !applyConfig(ctx, params)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    int words = loadProgram(ctx, path);
+    if (words < 0) {
+        fprintf(stderr, "%s: cannot open %s\n", argv[0], path);
+        return 1;
+    }
+
+    ctx->registers->R[15] = 0;
+    if (functional_only) {
+        runFunctional(ctx, 0, -1);
+    } else {
+        if (warm_pc >= 0) runFunctional(ctx, 0, warm_pc);
+
+        uint64_t budget = detail_cycles;
+        if (max_cycles && (!budget || max_cycles < budget)) budget = max_cycles;
+        resumePipeline(ctx, budget);
+
+        if (detail_cycles && ctx->stats.cycles >= detail_cycles) {
+            drainPipeline(ctx);
+            runFunctional(ctx, 0, -1);
+        }
+    }
+
+    Cache    *cache    = ctx->cache;
+    uint32_t  accesses = cache ? cache->hits + cache->misses : 0;
+    printf("program:      %s (%d words)\n", path, words);
+    printf("cycles:       %llu\n", (unsigned long long)ctx->stats.cycles);
+    printf("instructions: %llu\n", (unsigned long long)ctx->stats.instructions);
+    printf("CPI:          %.3f\n",
+           ctx->stats.instructions ? (double)ctx->stats.cycles / ctx->stats.instructions : 0.0);
+    if (ctx->stats.functional_instructions)
+        printf("functional:   %llu instructions\n",
+               (unsigned long long)ctx->stats.functional_instructions);
+    printf("stalls:       mem=%llu hazard=%llu fetch=%llu\n",
+           (unsigned long long)ctx->stats.mem_stall_cycles,
+           (unsigned long long)ctx->stats.hazard_stall_cycles,
+           (unsigned long long)ctx->stats.fetch_stall_cycles);
+    if (ctx->config.mshrs)
+        printf("mshr:         %llu load misses overlapped, %llu merged (%u entries)\n",
+               (unsigned long long)ctx->stats.mshr_misses,
+               (unsigned long long)ctx->stats.mshr_merges, ctx->config.mshrs);
+    if (ctx->config.store_buffer)
+        printf("store buffer: %llu stores, %llu coalesced, %llu loads forwarded, %llu cycles full (%u entries)\n",
+               (unsigned long long)ctx->stats.sb_stores, (unsigned long long)ctx->stats.sb_coalesced,
+               (unsigned long long)ctx->stats.sb_forwards, (unsigned long long)ctx->stats.sb_full_cycles,
+               ctx->config.store_buffer);
+    if (ctx->config.bpred != BP_NONE)
+        printf("branches:     %llu, %llu mispredicted (%.1f%% accuracy), %llu flush cycles (%s)\n",
+               (unsigned long long)ctx->stats.branches, (unsigned long long)ctx->stats.mispredicts,
+               ctx->stats.branches ? 100.0 * (ctx->stats.branches - ctx->stats.mispredicts) / ctx->stats.branches : 100.0,
+               (unsigned long long)ctx->stats.flush_cycles, bp_kind_name(ctx->config.bpred));
+    if (ctx->config.cache_enabled && accesses) {
+        printf("cache:        %u hits, %u misses (%.1f%% hit rate)\n",
+               cache->hits, cache->misses, 100.0 * cache->hits / accesses);
+        if (cache->write_back)
+            printf("write-back:   %u lines written back\n", cache->writebacks);
+    } else {
+        printf("cache:        %s\n", ctx->config.cache_enabled ? "no accesses" : "disabled");
+    }
+    if (ctx->config.cache_enabled && ctx->icache) {
+        Cache   *icache   = ctx->icache;
+        uint32_t fetches  = icache->hits + icache->misses;
+        printf("icache:       %u hits, %u misses (%.1f%% hit rate)\n",
+               icache->hits, icache->misses, fetches ? 100.0 * icache->hits / fetches : 0.0);
+    }
+    if (ctx->config.cache_enabled) {
+        report_victims("victim:", ctx->cache);
+        report_victims("ivictim:", ctx->icache);
+        report_prefetch("prefetch:", ctx->prefetch);
+        report_prefetch("iprefetch:", ctx->iprefetch);
+    }
+    if (ctx->config.cache_enabled && ctx->l2) {
+        Cache   *l2       = ctx->l2;
+        uint32_t lookups  = l2->hits + l2->misses;
+        printf("l2:           %u hits, %u misses (%.1f%% hit rate, %s)\n",
+               l2->hits, l2->misses, lookups ? 100.0 * l2->hits / lookups : 0.0,
+               cache_inclusion_name(l2->inclusion));
+        if (l2->write_back)
+            printf("l2 write-back: %u lines written back\n", l2->writebacks);
+    }
+    if (ctx->dram.timing.banks) {
+        const DRAM *dram = &ctx->dram;
+        uint32_t accesses = dram->row_hits + dram->row_misses + dram->row_conflicts;
+        printf("dram:         %u row hits, %u misses, %u conflicts (%.1f%% row hit rate, %u banks, %s page)\n",
+               dram->row_hits, dram->row_misses, dram->row_conflicts,
+               accesses ? 100.0 * dram->row_hits / accesses : 0.0, dram->timing.banks,
+               dram_page_name(dram->timing.close_page));
+    }
+    const MemController *mc = &ctx->memctrl;
+    if (ctx->config.memctrl) {
+        printf("memctrl:      %s, %u row hits served first, %u requests past a full queue\n",
+               mc_policy_name(ctx->config.memctrl), mc->row_first, mc->overflows);
+        for (int s = 0; s < MC_SOURCES; s++) {
+            if (!mc->requests[s]) continue;
+            printf("  %-12s%u requests, %.2f cycles queued on average (max %u)\n",
+                   mc_source_name(s), mc->requests[s], (double)mc->wait[s] / mc->requests[s], mc->max_wait[s]);
+        }
+    }
+    if (ctx->config.bus_width) {
+        printf("bus:          %u words x %u cycles per beat, %s fills: %llu streamed, %llu cycles saved by early restart\n",
+               ctx->config.bus_width, ctx->config.bus_beat, fill_order_name(ctx->config.fill_order),
+               (unsigned long long)ctx->stats.bus_fills, (unsigned long long)ctx->stats.restart_cycles);
+    }
+    printf("registers:   ");
+    for (int i = 0; i < 16; i++)
+        printf(" R%d=%u", i, ctx->registers->R[i]);
+    printf("\n");
+
+    destroy_context(ctx);
+    return 0;
+}
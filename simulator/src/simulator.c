@@ -3,161 +3,276 @@
 #include <stdbool.h>
 #include <string.h>
 #include <stdint.h>
+#include <stddef.h>
 #include "memory.h"
 #include "pipeline.h"
 #include "simulator.h"
 #include "assembler.h"
 #include "globals.h"
+#include "prefetch.h"
+#include "memory_access.h"
+#include "trace.h"
+
+// The DRAM timing knobs of cfg.
+static DRAMTiming dram_timing_of(const SimConfig *cfg) {
+    DRAMTiming t = { cfg->dram_banks, cfg->dram_row, cfg->dram_trcd, cfg->dram_tcas,
+                     cfg->dram_trp, cfg->dram_tras, cfg->dram_close_page };
+    return t;
+}
 
-// --- stepping‑state globals for stepInstructions() ---
-static uint16_t step_instr_val = 0;
-static int      step_cycle_cnt = 0;
-static bool     step_init      = false;
+// Allocate a machine with the process-wide default knobs.  DRAM, the register
+// file and the cache are built by init_system().
+SimContext *init_context(void) {
+    SimContext *ctx = (SimContext *)calloc(1, sizeof(SimContext));
+    if (!ctx) return NULL;
+    ctx->config = default_config();
+    init_system(ctx);
+    return ctx;
+}
 
-// Global Variables
-REGISTERS    *registers;
-DRAM          dram;
-Cache        *cache;
-PipelineState pipeline;
+void destroy_context(SimContext *ctx) {
+    if (!ctx) return;
+    free(ctx->registers);
+    destroy_cache(ctx->cache);
+    destroy_cache(ctx->icache);
+    destroy_cache(ctx->l2);
+    free(ctx->prefetch);
+    free(ctx->iprefetch);
+    free_threaded_code(ctx);
+    free_jit(ctx);
+    freeMemory(ctx->dram.memory);
+    free(ctx);
+}
 
 // Initialize all systems.
-void init_system() {
-    clearMemory(&dram);
-    dram.state        = DRAM_IDLE;
-    dram.delayCounter = 1;
-    dram.pendingAddr  = 0;
-    dram.pendingValue = 0;
-    strcpy(dram.pendingCmd, "");
-
-    registers = init_registers();
-    cache     = init_cache(CACHE_MODE);
+void init_system(SimContext *ctx) {
+    if (!ctx->dram.memory) ctx->dram.memory = allocMemory();
+    clearMemory(&ctx->dram);
+    clearDirty(&ctx->dram);     // after a reset the UI starts from zeroed DRAM
+    DRAMTiming timing = dram_timing_of(&ctx->config);
+    set_dram_timing(&ctx->dram, &timing);   // every row closed
+    updateDRAM(&ctx->dram, 0);
+    mc_configure(ctx);          // empty request queue
+    bp_configure(ctx);          // untrained predictor
+
+    free(ctx->registers);
+    ctx->registers = init_registers();
+    destroy_cache(ctx->cache);  // dirty lines go too: DRAM was just cleared
+    destroy_cache(ctx->icache);
+    destroy_cache(ctx->l2);
+    ctx->cache  = NULL;
+    ctx->icache = NULL;
+    ctx->l2     = NULL;
+    memset(&ctx->sb, 0, sizeof(ctx->sb));   // nor are buffered stores
+    rebuildCache(ctx);
+
+    // drop anything still in flight
+    memset(&ctx->pipeline, 0, sizeof(ctx->pipeline));
+    memset(&ctx->fetch,    0, sizeof(ctx->fetch));
+    memset(&ctx->mem,      0, sizeof(ctx->mem));
+    memset(&ctx->mshr,     0, sizeof(ctx->mshr));
+    ctx->branch_taken                 = false;
+    ctx->branch_target_address        = 0;
+    ctx->data_hazard_stall            = false;
+    ctx->stall_cycles_remaining       = 0;
+    ctx->memory_operation_in_progress = false;
+    ctx->dram_busy_until              = 0;
+    ctx->bus_busy_until               = 0;
 
     // reset stepping state
-    step_init      = false;
-    step_cycle_cnt = 0;
-    step_instr_val = 0;
+    ctx->step_init      = false;
+    ctx->step_cycle_cnt = 0;
+    ctx->step_instr_val = 0;
+    ctx->reported       = false;
 
-    registers->R[15] = 0;
+    ctx->registers->R[15] = 0;
+    memset(&ctx->stats, 0, sizeof(ctx->stats));
 
-    printf("[LOG] System is Initialized\n");
+    TRACE(TRACE_PIPELINE, TRACE_LEVEL_INFO, "[LOG] System is Initialized\n");
     fflush(stdout);
 }
 
-// Execute all instructions in DRAM.
-void executeInstructions() {
-    registers->R[15] = 0;
-    memset(&pipeline, 0, sizeof(pipeline));
-    pipeline.IF_ID.valid  = false;
-    pipeline.ID_EX.valid  = false;
-    pipeline.EX_MEM.valid = false;
-    pipeline.MEM_WB.valid = false;
-    pipeline.WB.valid     = false;
-
-    printf("[LOG] Pipeline started at PC=0\n");
-    fflush(stdout);
+// Run the pipeline from PC=0 until it drains past the end of the program.
+// Stops early after max_cycles cycles when max_cycles is non-zero.
+uint64_t runPipeline(SimContext *ctx, uint64_t max_cycles) {
+    ctx->registers->R[15] = 0;
+    memset(&ctx->pipeline, 0, sizeof(ctx->pipeline));
+    ctx->pipeline.IF_ID.valid  = false;
+    ctx->pipeline.ID_EX.valid  = false;
+    ctx->pipeline.EX_MEM.valid = false;
+    ctx->pipeline.MEM_WB.valid = false;
+    ctx->pipeline.WB.valid     = false;
+
+    TRACE(TRACE_PIPELINE, TRACE_LEVEL_INFO, "[LOG] Pipeline started at PC=0\n");
+    return resumePipeline(ctx, max_cycles);
+}
 
-    uint16_t instruction = readFromMemory(&dram, registers->R[15]);
+// Same as runPipeline, but carry on from the current PC and latches, e.g.
+// after an earlier max_cycles stop or a stretch of runFunctional().
+uint64_t resumePipeline(SimContext *ctx, uint64_t max_cycles) {
+    uint16_t instruction = readFromMemory(&ctx->dram, ctx->registers->R[15]);
     int cycles = 0;
     while (true) {
         bool pipeline_empty =
-        !pipeline.IF_ID.valid &&
-        !pipeline.ID_EX.valid &&
-        !pipeline.EX_MEM.valid &&
-        !pipeline.MEM_WB.valid &&
-        !pipeline.WB.valid;
-        if (pipeline_empty && instruction == 0)
+        !ctx->pipeline.IF_ID.valid &&
+        !ctx->pipeline.ID_EX.valid &&
+        !ctx->pipeline.EX_MEM.valid &&
+        !ctx->pipeline.MEM_WB.valid &&
+        !ctx->pipeline.WB.valid &&
+        !ctx->mshr.used && !ctx->sb.used;
+        if (pipeline_empty && instruction == 0) {
+            flushCache(ctx);    // leave the program's results in DRAM
             break;
-        pipeline_step(&pipeline, &instruction);
+        }
+        if (max_cycles && (uint64_t)cycles >= max_cycles)
+            break;
+        pipeline_step(ctx, &instruction);
         if (instruction != 0)
-            instruction = readFromMemory(&dram, registers->R[15]);
+            instruction = readFromMemory(&ctx->dram, ctx->registers->R[15]);
+        cycles++;
+        ctx->stats.cycles++;
+        TRACE(TRACE_PIPELINE, TRACE_LEVEL_INFO, "[CYCLE] %d\n", cycles);
+    }
+    return cycles;
+}
+
+// Stop fetching and clock the pipeline until everything in flight has
+// retired, leaving R15 at the next instruction to run.  Used before handing a
+// context over to runFunctional().  Returns the cycles spent draining.
+uint64_t drainPipeline(SimContext *ctx) {
+    PipelineState *p = &ctx->pipeline;
+    uint16_t instruction = 0;
+    uint64_t cycles = 0;
+
+    // An instruction fetch still in flight has not bumped R15 yet; drop it.
+    ctx->fetch.halted        = true;
+    ctx->fetch.memory_busy   = false;
+    ctx->fetch.delay_counter = 0;
+    mc_cancel(ctx, MC_FETCH);
+
+    while (p->IF_ID.valid || p->ID_EX.valid || p->EX_MEM.valid ||
+           p->MEM_WB.valid || p->WB.valid || ctx->mem.busy || ctx->mshr.used || ctx->sb.used) {
+        pipeline_step(ctx, &instruction);
         cycles++;
-        printf("[CYCLE] %d\n", cycles);
-        fflush(stdout);
+        ctx->stats.cycles++;
     }
 
-    // final dump
-    for (int i = 0; i < 16; i++)
-        printf("[REG]%d:%d\n", i, registers->R[i]);
+    ctx->fetch.halted         = false;
+    ctx->fetch.squash_pending = false;
+    ctx->branch_taken         = false;
+    ctx->data_hazard_stall    = false;
+    flushCache(ctx);            // functional mode reads DRAM directly
+    return cycles;
+}
+
+// The dumps below are deltas against the previous one: registers that
+// changed, cache lines queued by memory.c, and every word of the DRAM blocks
+// written since.  A step costs O(changes) rather than O(DRAM).
+static void report_registers(SimContext *ctx) {
+    for (int i = 0; i < 16; i++) {
+        if (ctx->reported && ctx->reported_regs[i] == ctx->registers->R[i]) continue;
+        printf("[REG]%d:%d\n", i, ctx->registers->R[i]);
+        ctx->reported_regs[i] = ctx->registers->R[i];
+    }
+    ctx->reported = true;
+}
+
+// Changed lines of one cache, under its label ([CACHE], [ICACHE] or [L2]).
+static void report_cache(Cache *cache) {
+    if (!cache) return;
+    for (uint32_t c = 0; c < cache->num_changed; c++) {
+        uint32_t id = cache->changed[c];
+        uint32_t i = id / cache->ways, j = id % cache->ways;
+        printf("[%s]%u:%u:%d:%d\n", cache->label, i, j, cache->valid[id], cache->tags[id]);
+        for (int k = 0; k < cache->block_size; k++)
+            printf("[%s_DATA]%u:%u:%d:%d\n", cache->label, i, j, k, cache->data[id * cache->block_size + k]);
+    }
+    clear_cache_changes(cache);
+}
+
+static void report_memory(SimContext *ctx) {
+    DRAM *dram = &ctx->dram;
 
     printf("[LOG] Printing cache contents\n");
-    for (int i = 0; i < cache->num_sets; i++) {
-        Set *set = &cache->sets[i];
-        for (int j = 0; j < set->associativity; j++) {
-            Line *line = &set->lines[j];
-            printf("[CACHE]%d:%d:%d:%d\n", i, j, line->valid, line->tag);
-            for (int k = 0; k < BLOCK_SIZE; k++)
-                printf("[CACHE_DATA]%d:%d:%d:%d\n", i, j, k, line->data[k]);
+    report_cache(ctx->cache);
+    report_cache(ctx->icache);
+    report_cache(ctx->l2);
+
+    for (int w = 0; w < DIRTY_WORDS && dram->dirty_summary; w++) {
+        if (!(dram->dirty_summary >> w & 1)) continue;
+        for (int b = 0; b < 64; b++) {
+            if (!(dram->dirty[w] >> b & 1)) continue;
+            uint32_t base = (uint32_t)(w * 64 + b) << DIRTY_BLOCK_SHIFT;
+            for (uint32_t addr = base; addr < base + (1u << DIRTY_BLOCK_SHIFT); addr++)
+                printf("[MEM]%u:%d\n", addr, dram->memory[addr]);
         }
+        dram->dirty[w] = 0;
+        dram->dirty_summary &= ~(1ull << w);
     }
+}
+
+// Execute all instructions in DRAM.  runPipeline() flushes a write-back
+// cache at the end, so the dump shows the final memory.
+void executeInstructions(SimContext *ctx) {
+    runPipeline(ctx, 0);
+
+    // final dump
+    report_registers(ctx);
 
-    for (int i = 0; i < DRAM_SIZE; i++)
-        if (dram.memory[i] != 0)
-            printf("[MEM]%d:%d\n", i, dram.memory[i]);
+    report_memory(ctx);
 
     printf("[END]\n");
     fflush(stdout);
 }
 
 // Step through instructions one by one.
-void stepInstructions() {
-    if (!step_init) {
-        registers->R[15] = 0;
-        memset(&pipeline, 0, sizeof(pipeline));
-        pipeline.IF_ID.valid  = false;
-        pipeline.ID_EX.valid  = false;
-        pipeline.EX_MEM.valid = false;
-        pipeline.MEM_WB.valid = false;
-        pipeline.WB.valid     = false;
-
-        step_instr_val = readFromMemory(&dram, registers->R[15]);
-        step_cycle_cnt = 0;
-        step_init      = true;
+void stepInstructions(SimContext *ctx) {
+    if (!ctx->step_init) {
+        ctx->registers->R[15] = 0;
+        memset(&ctx->pipeline, 0, sizeof(ctx->pipeline));
+        ctx->pipeline.IF_ID.valid  = false;
+        ctx->pipeline.ID_EX.valid  = false;
+        ctx->pipeline.EX_MEM.valid = false;
+        ctx->pipeline.MEM_WB.valid = false;
+        ctx->pipeline.WB.valid     = false;
+
+        ctx->step_instr_val = readFromMemory(&ctx->dram, ctx->registers->R[15]);
+        ctx->step_cycle_cnt = 0;
+        ctx->step_init      = true;
         printf("[LOG] Pipeline initialized for stepping, PC=0\n");
     }
 
-    if (step_instr_val != 0) {
-        pipeline_step(&pipeline, &step_instr_val);
-        step_instr_val = readFromMemory(&dram, registers->R[15]);
+    if (ctx->step_instr_val != 0) {
+        pipeline_step(ctx, &ctx->step_instr_val);
+        ctx->step_instr_val = readFromMemory(&ctx->dram, ctx->registers->R[15]);
     } else {
-        pipeline_step(&pipeline, &step_instr_val);
+        pipeline_step(ctx, &ctx->step_instr_val);
     }
 
-    step_cycle_cnt++;
-    printf("[CYCLE]%d\n", step_cycle_cnt);
+    PipelineState *p = &ctx->pipeline;
+    if (ctx->step_instr_val == 0 && !p->IF_ID.valid && !p->ID_EX.valid &&
+        !p->EX_MEM.valid && !p->MEM_WB.valid && !p->WB.valid && !ctx->mshr.used && !ctx->sb.used)
+        flushCache(ctx);        // last step: write the results back
 
-    for (int i = 0; i < 16; i++)
-        printf("[REG]%d:%d\n", i, registers->R[i]);
+    ctx->step_cycle_cnt++;
+    ctx->stats.cycles++;
+    printf("[CYCLE]%d\n", ctx->step_cycle_cnt);
 
-    // Report fetch status
-    extern bool fetch_memory_busy;
-    extern uint16_t fetch_delay_counter;
-    extern uint16_t fetch_delay_target;
-    
-    if (fetch_memory_busy) {
-        printf("[FETCH_STATUS]busy:%d:%d\n", fetch_delay_counter, fetch_delay_target);
-    }
+    report_registers(ctx);
 
-    printf("[LOG] Printing cache contents\n");
-    for (int i = 0; i < cache->num_sets; i++) {
-        Set *set = &cache->sets[i];
-        for (int j = 0; j < set->associativity; j++) {
-            Line *line = &set->lines[j];
-            printf("[CACHE]%d:%d:%d:%d\n", i, j, line->valid, line->tag);
-            for (int k = 0; k < BLOCK_SIZE; k++)
-                printf("[CACHE_DATA]%d:%d:%d:%d\n", i, j, k, line->data[k]);
-        }
+    // Report fetch status
+    if (ctx->fetch.memory_busy) {
+        printf("[FETCH_STATUS]busy:%d:%d\n", ctx->fetch.delay_counter, ctx->fetch.delay_target);
     }
 
-    for (int i = 0; i < DRAM_SIZE; i++)
-        if (dram.memory[i] != 0)
-            printf("[MEM]%d:%d\n", i, dram.memory[i]);
+    report_memory(ctx);
 
     printf("[END]\n");
     fflush(stdout);
 }
 
 // Store an instruction into DRAM at the address pointed to by PC.
-void storeInstruction(const char *command) {
+void storeInstruction(SimContext *ctx, const char *command) {
     const char *instrPtr = command + 6;
     uint16_t value = loadInstruction(instrPtr);
 
@@ -168,88 +283,611 @@ void storeInstruction(const char *command) {
     }
     printf("\n");
 
-    uint16_t addr = registers->R[15];
-    writeToMemory(&dram, addr, value);
+    uint16_t addr = ctx->registers->R[15];
+    writeToMemory(&ctx->dram, addr, value);
 
     printf("[BIN]%u\n", value);
     printf("[MEM]%d:%d\n", addr, value);
     printf("[END]\n");
     fflush(stdout);
 
-    registers->R[15]++;
+    ctx->registers->R[15]++;
 }
 
-static void apply_config(const char *params) {
-    char key[32], val[32];
-    while (sscanf(params, " %31[^ =]=%31s", key, val) == 2) {
-        if (strcmp(key, "pipe") == 0) {
-            PIPELINE_ENABLED = atoi(val) != 0;
-            printf("[CONFIG] Pipeline %s\n", PIPELINE_ENABLED ? "enabled" : "disabled");
+// Assemble a program file straight into DRAM starting at address 0. Returns
+// the number of words written, or -1 if the file cannot be opened.
+int loadProgram(SimContext *ctx, const char *path) {
+    uint16_t image[DRAM_SIZE];
+    int words = assembleFile(path, image, DRAM_SIZE);
+    if (words > 0) loadImage(ctx, image, words);
+    return words;
+}
+
+// Copy an already assembled program into DRAM starting at address 0.
+void loadImage(SimContext *ctx, const uint16_t *image, int words) {
+    for (int addr = 0; addr < words && addr < DRAM_SIZE; addr++)
+        writeToMemory(&ctx->dram, addr, image[addr]);
+}
+
+// Replace ctx->cache (and the I-cache when split, and the L2) with empty ones
+// shaped by the geometry and policy knobs, after writing back the old dirty
+// lines.  Callers check the shapes with checkGeometry() first, so init_cache()
+// only fails for want of memory; the context then runs uncached (or without
+// that level).
+void rebuildCache(SimContext *ctx) {
+    SimConfig *cfg = &ctx->config;
+    flushCache(ctx);
+    destroy_cache(ctx->cache);
+    destroy_cache(ctx->icache);
+    destroy_cache(ctx->l2);
+    free(ctx->prefetch);
+    free(ctx->iprefetch);
+    mc_cancel(ctx, MC_PREFETCH);    // their fills go with them
+    memset(ctx->bus_fill, 0, sizeof(ctx->bus_fill));
+    ctx->icache    = NULL;
+    ctx->l2        = NULL;
+    ctx->prefetch  = NULL;
+    ctx->iprefetch = NULL;
+    ctx->cache = init_cache(cfg->cache_size, cfg->cache_block, cfg->cache_mode,
+                            cfg->cache_policy, cfg->cache_seed, cfg->write_back);
+    if (!ctx->cache) {
+        cfg->cache_enabled = false;
+        return;
+    }
+
+    if (cfg->split_cache) {
+        // The I-cache is read-only; stores through the D-cache update its copies.
+        ctx->icache = init_cache(cfg->icache_size, cfg->icache_block, cfg->icache_ways,
+                                 cfg->cache_policy, cfg->cache_seed, false);
+        if (!ctx->icache) return;
+        ctx->icache->label = "ICACHE";
+        ctx->cache->snoop  = ctx->icache;
+    }
+    if (cfg->victims) {
+        init_victim_buffer(ctx->cache, cfg->victims);
+        if (ctx->icache) init_victim_buffer(ctx->icache, cfg->victims);
+    }
+    ctx->prefetch  = init_prefetcher(cfg->prefetch, cfg->prefetch_degree, ctx->cache);
+    ctx->iprefetch = init_prefetcher(cfg->prefetch, cfg->prefetch_degree, ctx->icache);
+    if (!cfg->l2_enabled) return;
+
+    // One L2 behind both L1s, under the same write policy.  Inclusion works a
+    // whole L2 block at a time, so no L1 block may be larger; exclusive moves
+    // lines between the levels, so there the sizes must match.
+    Cache *l1[2] = { ctx->cache, ctx->icache };
+    bool exclusive = cfg->l2_inclusion == INCL_EXCLUSIVE;
+    for (int i = 0; i < 2; i++) {
+        if (!l1[i] || (exclusive ? l1[i]->block_size == cfg->l2_block : l1[i]->block_size <= cfg->l2_block))
+            continue;
+        printf("Error: L2 blocks (%u words) must %s the %u-word L1 blocks\n",
+               cfg->l2_block, exclusive ? "match" : "be at least", l1[i]->block_size);
+        return;
+    }
+    ctx->l2 = init_cache(cfg->l2_size, cfg->l2_block, cfg->l2_ways,
+                         cfg->l2_policy, cfg->cache_seed, cfg->write_back);
+    if (!ctx->l2) return;
+    ctx->l2->label     = "L2";
+    ctx->l2->inclusion = cfg->l2_inclusion;
+    for (int i = 0; i < 2; i++) {
+        if (!l1[i]) continue;
+        l1[i]->next = ctx->l2;
+        ctx->l2->uppers[ctx->l2->num_uppers++] = l1[i];
+    }
+}
+
+// Write every dirty line back to DRAM, the L1s through the L2, after any
+// stores still in the store buffer.
+void flushCache(SimContext *ctx) {
+    sb_flush(ctx);
+    uint32_t n = flush_cache(ctx->cache, &ctx->dram);
+    n += flush_cache(ctx->l2, &ctx->dram);
+    if (n) TRACE(TRACE_CACHE, TRACE_LEVEL_DEBUG, "[CACHE_FLUSH] Wrote %u dirty lines back to DRAM\n", n);
+}
+
+static const char *const fill_orders[FILL_ORDERS] = { "block", "early", "cwf" };
+
+int fill_order_id(const char *name) {
+    for (int i = 0; i < FILL_ORDERS; i++)
+        if (strcmp(name, fill_orders[i]) == 0) return i;
+    char *end;
+    unsigned long i = strtoul(name, &end, 0);
+    return (*name && !*end && i < FILL_ORDERS) ? (int)i : -1;
+}
+
+const char *fill_order_name(int order) {
+    return (order >= 0 && order < FILL_ORDERS) ? fill_orders[order] : "?";
+}
+
+/**
+ * Move a fill of the block holding address, whose data DRAM has ready at
+ * cycle ready, over the memory bus: bus_width words a beat, bus_beat cycles
+ * each, behind whatever the bus is already carrying.  The block is the L2's
+ * when there is one, else cache's; no cache (a store that does not allocate,
+ * or the caches off) moves the one word.  Returns the cycle the requester can
+ * go on: the end of the transfer, or for a demand fill under early restart
+ * the arrival of the beat holding its word, which comes first under critical
+ * word first.  With bus_width 0 the data comes with the DRAM access, at ready.
+ */
+uint64_t busTransfer(SimContext *ctx, Cache *cache, uint16_t address, uint64_t ready, bool demand) {
+    uint16_t width = ctx->config.bus_width, beat = ctx->config.bus_beat;
+    if (!width) return ready;
+    uint16_t words = !cache ? 1 : ctx->l2 ? ctx->l2->block_size : cache->block_size;
+    uint16_t block = address & ~(words - 1), beats = (words + width - 1) / width;
+    uint64_t start = ctx->bus_busy_until > ready ? ctx->bus_busy_until : ready;
+    uint64_t end   = start + (uint64_t)beats * beat;
+    ctx->bus_busy_until = end;
+    TRACE(TRACE_MEM, TRACE_LEVEL_DEBUG, "[BUS] %u words from %u over cycles %llu-%llu\n",
+          words, block, (unsigned long long)start, (unsigned long long)end);
+    if (!cache || !demand || ctx->config.fill_order == FILL_BLOCK || beats == 1) return end;
+
+    // the rest of the block streams in behind the requester: hitDelay()
+    // holds back hits on words still to come
+    uint16_t k = ctx->config.fill_order == FILL_CWF ? 0 : (uint16_t)(address - block) / width;
+    ctx->bus_fill[cache == ctx->icache] = (BusFill){
+        .valid = true, .address = address, .block = block, .words = words, .start = start };
+    ctx->stats.bus_fills++;
+    ctx->stats.restart_cycles += (uint64_t)(beats - 1 - k) * beat;
+    return start + (uint64_t)(k + 1) * beat;
+}
+
+/**
+ * Latency of an L1 hit on address: delay, unless its word belongs to the
+ * fill still streaming into cache and has not arrived yet.
+ */
+uint16_t hitDelay(SimContext *ctx, Cache *cache, uint16_t address, uint16_t delay) {
+    BusFill *f = &ctx->bus_fill[cache == ctx->icache];
+    uint16_t line = ~(cache->block_size - 1);
+    if (!ctx->config.bus_width || !f->valid || (address & line) != (f->address & line)) return delay;
+    uint16_t width = ctx->config.bus_width, beats = (f->words + width - 1) / width;
+    uint16_t idx = (uint16_t)(address - f->block) / width, first = (uint16_t)(f->address - f->block) / width;
+    uint16_t pos = ctx->config.fill_order == FILL_CWF ? (idx + beats - first) % beats : idx;
+    uint64_t now = ctx->stats.cycles, arrival = f->start + (uint64_t)(pos + 1) * ctx->config.bus_beat;
+    if (now >= f->start + (uint64_t)beats * ctx->config.bus_beat) f->valid = false;
+    if (arrival <= now + delay) return delay;
+    return arrival - now >= MC_WAIT ? MC_WAIT - 1 : (uint16_t)(arrival - now);
+}
+
+// Latency of a DRAM access to address made this cycle by source, after lead
+// cycles in the levels above, for a fill of cache (NULL when nothing is
+// filled).  With a memory controller the access is queued and MC_WAIT
+// returned; the requester is told when it issues.  Flat timing: the
+// configured delay plus any write-back traffic still occupying the DRAM.
+// Banked timing: the access queues on its bank and pays for the row state it
+// finds there.  Either way the data then crosses the memory bus.
+uint16_t dramDelay(SimContext *ctx, Cache *cache, uint16_t address, int source, uint16_t lead) {
+    uint64_t now = ctx->stats.cycles, ready;
+    if (mc_submit(ctx, source, address, cache, lead)) return MC_WAIT;
+    if (ctx->dram.timing.banks) {
+        ready = dram_access(&ctx->dram, now, address);
+    } else {
+        uint64_t wait = ctx->dram_busy_until > now ? ctx->dram_busy_until - now : 0;
+        ready = now + ctx->config.dram_delay + wait;
+    }
+    uint64_t delay = busTransfer(ctx, cache, address, ready, true) - now + lead;
+    return delay >= MC_WAIT ? MC_WAIT - 1 : (uint16_t)delay;
+}
+
+// Latency of a miss in L1 cache on address issued this cycle by source
+// (MC_FETCH, MC_LOAD or MC_STORE): a swap from its victim buffer, the rest of
+// a prefetch already bringing the block in, the L2 hit latency, or the L2
+// lookup followed by the DRAM access (MC_WAIT while that is queued).
+uint16_t missDelay(SimContext *ctx, Cache *cache, uint16_t address, int source) {
+    if (!ctx->config.cache_enabled || !cache) return dramDelay(ctx, NULL, address, source, 0);
+    if (victim_lookup(cache, address) >= 0) return ctx->config.victim_delay;
+    int wait = prefetch_wait(ctx, cache == ctx->icache ? ctx->iprefetch : ctx->prefetch, address);
+    if (wait >= 0) return wait ? (wait > UINT16_MAX ? UINT16_MAX : (uint16_t)wait) : 1;
+    // a write-through store miss does not allocate: only its word moves
+    Cache *fill = (source == MC_STORE && !cache->write_back) ? NULL : cache;
+    if (!ctx->l2) return dramDelay(ctx, fill, address, source, 0);
+    if (cache_lookup(ctx->l2, address) >= 0) return ctx->config.l2_delay;
+    return dramDelay(ctx, fill, address, source, ctx->config.l2_delay);
+}
+
+// Queue the caches' DRAM write-backs, dram_delay cycles each, behind whatever
+// the DRAM is already writing.  Banked timing queues them on their banks as
+// they happen instead.
+void chargeWritebacks(SimContext *ctx) {
+    Cache *levels[3] = { ctx->cache, ctx->icache, ctx->l2 };
+    uint32_t pending = 0;
+    for (int i = 0; i < 3; i++) {
+        if (!levels[i]) continue;
+        pending += levels[i]->wb_pending;
+        levels[i]->wb_pending = 0;
+    }
+    if (!pending) return;
+    uint64_t start = ctx->dram_busy_until > ctx->stats.cycles ? ctx->dram_busy_until : ctx->stats.cycles;
+    ctx->dram_busy_until = start + (uint64_t)pending * ctx->config.dram_delay;
+}
+
+// ---- the knob table: every key of the "config" command, and of
+//      arch16-run and arch16-sweep, with the SimConfig field it sets ----
+
+static void echo_pipe(SimContext *ctx) {
+    printf("[CONFIG] Pipeline %s\n", ctx->config.pipeline_enabled ? "enabled" : "disabled");
+}
+
+static void echo_cache(SimContext *ctx) {
+    if (!ctx->config.cache_enabled) flushCache(ctx);   // accesses now go straight to DRAM
+    printf("[CONFIG] Cache %s\n", ctx->config.cache_enabled ? "enabled" : "disabled");
+}
+
+static void echo_dram(SimContext *ctx) {
+    printf("[CONFIG] DRAM delay set to %u cycles\n", ctx->config.dram_delay);
+}
+
+static void echo_cache_delay(SimContext *ctx) {
+    printf("[CONFIG] Cache delay set to %u cycles\n", ctx->config.cache_delay);
+}
+
+static void echo_cache_mode(SimContext *ctx) {
+    printf("[CONFIG] Cache mode set to %u\n", ctx->config.cache_mode);
+}
+
+static void echo_cache_policy(SimContext *ctx) {
+    printf("[CONFIG] Cache policy set to %s\n", cache_policy_name(ctx->config.cache_policy));
+}
+
+static void echo_cache_seed(SimContext *ctx) {
+    printf("[CONFIG] Cache seed set to %u\n", ctx->config.cache_seed);
+}
+
+static void echo_write_back(SimContext *ctx) {
+    printf("[CONFIG] Cache write policy: %s\n",
+           ctx->config.write_back ? "write-back, write-allocate" : "write-through, no allocate");
+}
+
+static void echo_split_cache(SimContext *ctx) {
+    printf("[CONFIG] %s\n", ctx->config.split_cache ? "Split I/D caches" : "Unified cache");
+}
+
+static void echo_icache_delay(SimContext *ctx) {
+    printf("[CONFIG] I-cache delay set to %u cycles\n", ctx->config.icache_delay);
+}
+
+static void echo_l2(SimContext *ctx) {
+    printf("[CONFIG] L2 cache %s\n", ctx->config.l2_enabled ? "enabled" : "disabled");
+}
+
+static void echo_l2_delay(SimContext *ctx) {
+    printf("[CONFIG] L2 delay set to %u cycles\n", ctx->config.l2_delay);
+}
+
+static void echo_l2_policy(SimContext *ctx) {
+    printf("[CONFIG] L2 policy set to %s\n", cache_policy_name(ctx->config.l2_policy));
+}
+
+static void echo_l2_inclusion(SimContext *ctx) {
+    printf("[CONFIG] L2 inclusion set to %s\n", cache_inclusion_name(ctx->config.l2_inclusion));
+}
+
+static void echo_mshrs(SimContext *ctx) {
+    if (ctx->config.mshrs)
+        printf("[CONFIG] Non-blocking loads with %u MSHRs\n", ctx->config.mshrs);
+    else
+        printf("[CONFIG] Blocking loads\n");
+}
+
+static void echo_store_buffer(SimContext *ctx) {
+    if (ctx->config.store_buffer)
+        printf("[CONFIG] Store buffer of %u entries\n", ctx->config.store_buffer);
+    else
+        printf("[CONFIG] Blocking stores\n");
+}
+
+static void echo_prefetch(SimContext *ctx) {
+    printf("[CONFIG] Prefetcher set to %s\n", prefetch_kind_name(ctx->config.prefetch));
+}
+
+static void echo_prefetch_degree(SimContext *ctx) {
+    printf("[CONFIG] Prefetch degree set to %u\n", ctx->config.prefetch_degree);
+}
+
+static void echo_victim(SimContext *ctx) {
+    if (ctx->config.victims)
+        printf("[CONFIG] Victim buffer of %u entries\n", ctx->config.victims);
+    else
+        printf("[CONFIG] No victim buffer\n");
+}
+
+static void echo_victim_delay(SimContext *ctx) {
+    printf("[CONFIG] Victim buffer swap delay set to %u cycles\n", ctx->config.victim_delay);
+}
+
+static void echo_memctrl(SimContext *ctx) {
+    printf("[CONFIG] Memory controller set to %s\n", mc_policy_name(ctx->config.memctrl));
+}
+
+static void echo_bus_width(SimContext *ctx) {
+    if (ctx->config.bus_width)
+        printf("[CONFIG] Memory bus set to %u words per beat\n", ctx->config.bus_width);
+    else
+        printf("[CONFIG] Memory bus model disabled\n");
+}
+
+static void echo_bus_beat(SimContext *ctx) {
+    printf("[CONFIG] Memory bus beat set to %u cycles\n", ctx->config.bus_beat);
+}
+
+static void echo_fill(SimContext *ctx) {
+    printf("[CONFIG] Block fills set to %s\n", fill_order_name(ctx->config.fill_order));
+}
+
+static void echo_bpred(SimContext *ctx) {
+    printf("[CONFIG] Branch predictor set to %s\n", bp_kind_name(ctx->config.bpred));
+}
+
+static void echo_bpred_size(SimContext *ctx) {
+    printf("[CONFIG] Branch predictor tables of %u entries\n", ctx->bp.mask + 1);
+}
+
+static void echo_jit(SimContext *ctx) {
+    printf("[CONFIG] JIT %s\n", ctx->config.jit_enabled ? "enabled" : "disabled");
+}
+
+static const char *page_name(int close_page) {
+    return dram_page_name(close_page != 0);
+}
+
+#define KNOB(key, field) .name = key, .offset = offsetof(SimConfig, field)
+#define FLAG(key, field) .name = key, .offset = offsetof(SimConfig, field), .is_bool = true
+#define NAMED(what_, id_, name_of_) .what = what_, .id = id_, .name_of = name_of_
+
+// In arch16-sweep column order.
+const ConfigKnob config_knobs[] = {
+    { FLAG("pipe", pipeline_enabled),                            .echo = echo_pipe },
+    { FLAG("cache", cache_enabled),                              .echo = echo_cache },
+    { KNOB("cache_mode", cache_mode),      .flags = KNOB_RESHAPE, .echo = echo_cache_mode },
+    { KNOB("cache_ways", cache_mode),      .flags = KNOB_RESHAPE | KNOB_ALIAS, .echo = echo_cache_mode },
+    { KNOB("cache_size", cache_size),      .flags = KNOB_RESHAPE },
+    { KNOB("cache_block", cache_block),    .flags = KNOB_RESHAPE },
+    { KNOB("cache_policy", cache_policy),  .flags = KNOB_RESHAPE, .echo = echo_cache_policy,
+      NAMED("cache policy", cache_policy_id, cache_policy_name) },
+    { KNOB("cache_seed", cache_seed),      .flags = KNOB_RESHAPE, .echo = echo_cache_seed },
+    { FLAG("write_back", write_back),      .flags = KNOB_RESHAPE, .echo = echo_write_back },
+    { KNOB("dram", dram_delay),                                  .echo = echo_dram },
+    { KNOB("cache_delay", cache_delay),                          .echo = echo_cache_delay },
+    { FLAG("split_cache", split_cache),    .flags = KNOB_RESHAPE, .echo = echo_split_cache },
+    { KNOB("icache_size", icache_size),    .flags = KNOB_RESHAPE },
+    { KNOB("icache_block", icache_block),  .flags = KNOB_RESHAPE },
+    { KNOB("icache_ways", icache_ways),    .flags = KNOB_RESHAPE },
+    { KNOB("icache_delay", icache_delay),                        .echo = echo_icache_delay },
+    { FLAG("l2", l2_enabled),              .flags = KNOB_RESHAPE, .echo = echo_l2 },
+    { KNOB("l2_size", l2_size),            .flags = KNOB_RESHAPE },
+    { KNOB("l2_block", l2_block),          .flags = KNOB_RESHAPE },
+    { KNOB("l2_ways", l2_ways),            .flags = KNOB_RESHAPE },
+    { KNOB("l2_delay", l2_delay),                                .echo = echo_l2_delay },
+    { KNOB("l2_policy", l2_policy),        .flags = KNOB_RESHAPE, .echo = echo_l2_policy,
+      NAMED("cache policy", cache_policy_id, cache_policy_name) },
+    { KNOB("l2_inclusion", l2_inclusion),  .flags = KNOB_RESHAPE, .echo = echo_l2_inclusion,
+      NAMED("L2 inclusion policy", cache_inclusion_id, cache_inclusion_name) },
+    { KNOB("mshrs", mshrs),                .max = MAX_MSHRS,     .echo = echo_mshrs },
+    { KNOB("store_buffer", store_buffer),  .max = MAX_STORE_BUFFER, .echo = echo_store_buffer },
+    { KNOB("prefetch", prefetch),          .flags = KNOB_RESHAPE, .echo = echo_prefetch,
+      NAMED("prefetcher", prefetch_kind_id, prefetch_kind_name) },
+    { KNOB("prefetch_degree", prefetch_degree), .flags = KNOB_RESHAPE, .echo = echo_prefetch_degree },
+    { KNOB("victim", victims),             .max = MAX_VICTIMS, .flags = KNOB_RESHAPE, .echo = echo_victim },
+    { KNOB("victim_delay", victim_delay),                        .echo = echo_victim_delay },
+    { KNOB("dram_banks", dram_banks),      .flags = KNOB_RETIME },
+    { KNOB("dram_row", dram_row),          .flags = KNOB_RETIME },
+    { FLAG("dram_page", dram_close_page),  .flags = KNOB_RETIME,
+      NAMED("DRAM page policy", dram_page_id, page_name) },
+    { KNOB("dram_trcd", dram_trcd),        .flags = KNOB_RETIME },
+    { KNOB("dram_tcas", dram_tcas),        .flags = KNOB_RETIME },
+    { KNOB("dram_trp", dram_trp),          .flags = KNOB_RETIME },
+    { KNOB("dram_tras", dram_tras),        .flags = KNOB_RETIME },
+    { KNOB("memctrl", memctrl),            .flags = KNOB_REQUEUE, .echo = echo_memctrl,
+      NAMED("memory controller policy", mc_policy_id, mc_policy_name) },
+    { KNOB("bus_width", bus_width),                              .echo = echo_bus_width },
+    { KNOB("bus_beat", bus_beat),          .min = 1,             .echo = echo_bus_beat },
+    { KNOB("fill", fill_order),                                  .echo = echo_fill,
+      NAMED("fill order", fill_order_id, fill_order_name) },
+    { KNOB("bpred", bpred),                .flags = KNOB_RETRAIN, .echo = echo_bpred,
+      NAMED("branch predictor", bp_kind_id, bp_kind_name) },
+    { KNOB("bpred_size", bpred_size),      .min = 1, .max = BP_MAX_ENTRIES, .flags = KNOB_RETRAIN,
+      .echo = echo_bpred_size },
+    { FLAG("jit", jit_enabled),            .flags = KNOB_HOST,    .echo = echo_jit },
+};
+const int config_knob_count = sizeof(config_knobs) / sizeof(config_knobs[0]);
+
+#undef KNOB
+#undef FLAG
+#undef NAMED
+
+// The knob called name, or NULL.
+const ConfigKnob *config_knob(const char *name) {
+    for (int i = 0; i < config_knob_count; i++)
+        if (strcmp(name, config_knobs[i].name) == 0) return &config_knobs[i];
+    return NULL;
+}
+
+// Parse the whole of text as a value of k: one of its names, or a number.
+bool knob_parse(const ConfigKnob *k, const char *text, uint16_t *v) {
+    if (k->id) {
+        int id = k->id(text);
+        *v = (uint16_t)id;
+        return id >= 0;
+    }
+    char *end;
+    unsigned long n = strtoul(text, &end, 0);
+    if (!*text || *end || *text == '-') return false;
+    *v = n > UINT16_MAX ? UINT16_MAX : (uint16_t)n;
+    return true;
+}
+
+// Store v, clamped to the knob's range, into its field of cfg.
+void knob_set(SimConfig *cfg, const ConfigKnob *k, uint16_t v) {
+    if (v < k->min) v = k->min;
+    if (k->max && v > k->max) v = k->max;
+    char *field = (char *)cfg + k->offset;
+    if (k->is_bool) *(bool *)field = v != 0;
+    else            *(uint16_t *)field = v;
+}
+
+uint16_t knob_get(const SimConfig *cfg, const ConfigKnob *k) {
+    const char *field = (const char *)cfg + k->offset;
+    return k->is_bool ? *(const bool *)field : *(const uint16_t *)field;
+}
+
+// True if a and b differ in some knob with any of flags.
+static bool knobs_differ(const SimConfig *a, const SimConfig *b, unsigned flags) {
+    for (int i = 0; i < config_knob_count; i++)
+        if ((config_knobs[i].flags & flags) && knob_get(a, &config_knobs[i]) != knob_get(b, &config_knobs[i]))
+            return true;
+    return false;
+}
+
+// Replace a context's knobs wholesale, rebuilding the cache if its shape or
+// replacement policy changed.  A config whose caches cannot be built is
+// reported and leaves the context as it was.
+bool setConfig(SimContext *ctx, const SimConfig *cfg) {
+    if (!checkGeometry(cfg)) return false;
+    bool rebuild = knobs_differ(cfg, &ctx->config, KNOB_RESHAPE);
+    DRAMTiming timing = dram_timing_of(cfg), old = dram_timing_of(&ctx->config);
+    bool requeue = knobs_differ(cfg, &ctx->config, KNOB_REQUEUE);
+    bool retrain = knobs_differ(cfg, &ctx->config, KNOB_RETRAIN);
+    ctx->config = *cfg;
+    if (rebuild) rebuildCache(ctx);
+    if (memcmp(&timing, &old, sizeof(timing)) != 0) set_dram_timing(&ctx->dram, &timing);
+    if (requeue) mc_configure(ctx);
+    if (retrain) bp_configure(ctx);
+    return true;
+}
+
+// The config keys, wrapped for a usage message.  sweepable leaves out the
+// trace keys and the host-only knobs, which arch16-sweep cannot vary.
+void print_config_keys(FILE *out, bool sweepable) {
+    int col = 5;
+    const char *sep = "";
+    for (int i = -2; i < config_knob_count; i++) {
+        const char *name = i == -2 ? "trace" : i == -1 ? "trace_mask" : config_knobs[i].name;
+        if (sweepable && (i < 0 || (config_knobs[i].flags & KNOB_HOST))) continue;
+        int len = (int)strlen(name) + 2;
+        fprintf(out, "%s", sep);
+        if (col + len > 78) {
+            fprintf(out, "\n     ");
+            col = 5;
         }
-        else if (strcmp(key, "cache") == 0) {
-            CACHE_ENABLED = atoi(val) != 0;
-            printf("[CONFIG] Cache %s\n", CACHE_ENABLED ? "enabled" : "disabled");
+        fprintf(out, " %s", name);
+        col += len;
+        sep = ",";
+    }
+    fprintf(out, "\n");
+}
+
+// Whether the caches cfg describes can be built: the D-cache, the I-cache
+// when split and the L2 when enabled, whose blocks must hold whole L1 blocks
+// (exactly one, when exclusive).  Each problem is reported.
+bool checkGeometry(const SimConfig *cfg) {
+    const struct { const char *label; uint16_t size, block, ways; bool used; } level[3] = {
+        { "cache",   cfg->cache_size,  cfg->cache_block,  cfg->cache_mode,  true },
+        { "I-cache", cfg->icache_size, cfg->icache_block, cfg->icache_ways, cfg->split_cache },
+        { "L2",      cfg->l2_size,     cfg->l2_block,     cfg->l2_ways,     cfg->l2_enabled },
+    };
+    bool ok = true;
+    for (int i = 0; i < 3; i++) {
+        if (!level[i].used || cache_geometry_ok(level[i].size, level[i].block, level[i].ways)) continue;
+        printf("[CONFIG] Invalid %s geometry: %u words, %u-word blocks, %u ways "
+               "(powers of two, at most %u words)\n",
+               level[i].label, level[i].size, level[i].block, level[i].ways, MAX_CACHE_SIZE);
+        ok = false;
+    }
+    if (!ok || !cfg->l2_enabled) return ok;
+
+    bool exclusive = cfg->l2_inclusion == INCL_EXCLUSIVE;
+    for (int i = 0; i < 2; i++) {
+        uint16_t block = level[i].block;
+        if (!level[i].used || (exclusive ? block == cfg->l2_block : block <= cfg->l2_block)) continue;
+        printf("[CONFIG] L2 blocks (%u words) must %s the %u-word %s blocks\n",
+               cfg->l2_block, exclusive ? "match" : "be at least", block, level[i].label);
+        ok = false;
+    }
+    return ok;
+}
+
+// Whether every word of params is a key=value pair naming a knob and a
+// value it takes, and the caches of cfg with them applied can be built.
+// Each problem is reported.
+bool checkConfig(const SimConfig *cfg, const char *params) {
+    SimConfig next = *cfg;
+    bool ok = true;
+    while (*(params += strspn(params, " "))) {
+        int len = (int)strcspn(params, " ");
+        const char *eq = memchr(params, '=', len);
+        int klen = eq ? (int)(eq - params) : len;
+        char key[32], val[32];
+        snprintf(key, sizeof key, "%.*s", klen, params);
+        snprintf(val, sizeof val, "%.*s", eq ? len - klen - 1 : 0, eq ? eq + 1 : "");
+        const ConfigKnob *k = config_knob(key);
+        uint16_t v;
+        if (!eq || (!k && strcmp(key, "trace") != 0 && strcmp(key, "trace_mask") != 0)) {
+            printf("[CONFIG] Unknown key %s\n", key);
+            ok = false;
+        } else if (k && !knob_parse(k, val, &v)) {
+            if (k->what) printf("[CONFIG] Unknown %s %s\n", k->what, val);
+            else         printf("[CONFIG] Bad value %s for %s\n", val, key);
+            ok = false;
+        } else if (k) {
+            knob_set(&next, k, v);
         }
-        else if (strcmp(key, "dram") == 0) {
-            USER_DRAM_DELAY = atoi(val);
-            printf("[CONFIG] DRAM delay set to %u cycles\n", USER_DRAM_DELAY);
+        params += len;
+    }
+    return ok && checkGeometry(&next);
+}
+
+// Apply a space separated list of key=value knobs (the "config" command).
+// A list with an unknown key, a bad value or a cache shape that cannot be
+// built is reported and applies nothing.
+bool applyConfig(SimContext *ctx, const char *params) {
+    if (!checkConfig(&ctx->config, params)) return false;
+    char key[32], val[32];
+    bool reshape = false;       // geometry and policy keys rebuild the cache once, at the end
+    bool retime  = false;       // DRAM timing keys likewise reset the banks once
+    params += strspn(params, " ");
+    while (sscanf(params, " %31[^ =]=%31s", key, val) == 2) {
+        const ConfigKnob *k = config_knob(key);
+        uint16_t v;
+        if (strcmp(key, "trace") == 0) {
+            trace_configure(atoi(val), TRACE_MASK);
+            printf("[CONFIG] Trace level set to %u\n", TRACE_LEVEL);
         }
-        else if (strcmp(key, "cache_delay") == 0) {
-            USER_CACHE_DELAY = atoi(val);
-            printf("[CONFIG] Cache delay set to %u cycles\n", USER_CACHE_DELAY);
+        else if (strcmp(key, "trace_mask") == 0) {
+            trace_configure(TRACE_LEVEL, strtoul(val, NULL, 0));
+            printf("[CONFIG] Trace mask set to 0x%X\n", TRACE_MASK);
         }
-        else if(strcmp(key, "cache_mode") == 0) {
-            CACHE_MODE = atoi(val);
-            printf("[CONFIG] Cache mode set to %u\n", CACHE_MODE);
-            destroy_cache(cache);
-            cache = init_cache(CACHE_MODE);
+        else if (k && knob_parse(k, val, &v)) {
+            knob_set(&ctx->config, k, v);
+            if (k->flags & KNOB_RESHAPE) reshape = true;
+            if (k->flags & KNOB_RETIME)  retime  = true;
+            if (k->flags & KNOB_REQUEUE) mc_configure(ctx);
+            if (k->flags & KNOB_RETRAIN) bp_configure(ctx);
+            if (k->echo) k->echo(ctx);
         }
         params = strchr(params, ' ');
         if (!params) break;
         ++params;
     }
-}
-
-int main() {
-    init_system();
-    char command[256];
 
-    while (fgets(command, sizeof(command), stdin)) {
-        command[strcspn(command, "\n")] = 0;
-        printf("[DEBUG] Received command: %s\n", command);
-        fflush(stdout);
-
-        if      (strncmp(command, "write", 5) == 0) storeInstruction(command);
-        else if (strncmp(command, "start", 5) == 0) executeInstructions();
-        else if (strncmp(command, "step", 4)  == 0) stepInstructions();
-        else if (strncmp(command, "reset", 5) == 0) {
-            init_system();
-            printf("[END]\n");
-            fflush(stdout);
-        }
-        else if (strncmp(command, "cfg", 3) == 0) {
-            uint16_t d, cd, ce, pe, cm;
-            if (sscanf(command + 3, " %hu %hu %hu %hu %hu", &d, &cd, &ce, &pe, &cm) == 5) {
-                USER_DRAM_DELAY   = d;
-                USER_CACHE_DELAY  = cd;
-                CACHE_ENABLED     = ce;
-                PIPELINE_ENABLED  = pe;
-                CACHE_MODE        = cm;
-                destroy_cache(cache);
-                cache = init_cache(CACHE_MODE);
-            }
-            printf("[END]\n");
-            fflush(stdout);
-        }
-        else if (strncmp(command,"config",6) == 0) {
-            apply_config(command+6);
-            printf("[END]\n");
-            fflush(stdout);
-        }
-        else {
-            printf("[DEBUG] Unknown command: %s\n", command);
-            fflush(stdout);
-        }
+    if (retime) {
+        DRAMTiming timing = dram_timing_of(&ctx->config);
+        if (set_dram_timing(&ctx->dram, &timing) && timing.banks)
+            printf("[CONFIG] DRAM timing: %u banks, %u-word rows, tRCD=%u tCAS=%u tRP=%u tRAS=%u, %s page\n",
+                   timing.banks, timing.row_size, timing.tRCD, timing.tCAS, timing.tRP, timing.tRAS,
+                   dram_page_name(timing.close_page));
+        else
+            printf("[CONFIG] DRAM timing: flat %u cycles per access\n", ctx->config.dram_delay);
+    }
+    if (reshape) {
+        rebuildCache(ctx);
+        if (ctx->cache)
+            printf("[CONFIG] Cache geometry: %u words, %u-word blocks, %u sets x %u ways\n",
+                   ctx->config.cache_size, ctx->cache->block_size, ctx->cache->num_sets, ctx->cache->ways);
+        if (ctx->icache)
+            printf("[CONFIG] I-cache geometry: %u words, %u-word blocks, %u sets x %u ways\n",
+                   ctx->config.icache_size, ctx->icache->block_size, ctx->icache->num_sets, ctx->icache->ways);
+        if (ctx->l2)
+            printf("[CONFIG] L2 geometry: %u words, %u-word blocks, %u sets x %u ways, %s\n",
+                   ctx->config.l2_size, ctx->l2->block_size, ctx->l2->num_sets, ctx->l2->ways,
+                   cache_inclusion_name(ctx->l2->inclusion));
     }
-    return 0;
+    return true;
 }
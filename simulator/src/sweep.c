@@ -0,0 +1,402 @@
+// sweep.c – parallel parameter sweep over programs and machine configurations.
+//
+//   arch16-sweep [-j threads] [-m max_cycles] [-o results.csv|results.json]
+//                [-f configs.txt] [key=v1,v2,...] program.txt ...
+//
+// Each key=list argument adds one axis to the grid: any knob of the config
+// command (config_knobs in simulator.c; the usage text lists them), with
+// names for the policy knobs, e.g. cache_policy=lru,plru or bpred=none,gshare.
+// Every program is run at every point of the cartesian product.  With
+// -f, each non-blank line of the file is one explicit point
+// written as "key=value key=value ..." and the grid is not used.  Points run
+// in parallel on a work-stealing pool, one SimContext each, and the table is
+// written in program / grid order regardless of which worker finished first.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "memory.h"
+#include "simulator.h"
+#include "assembler.h"
+#include "globals.h"
+#include "prefetch.h"
+#include "trace.h"
+#include "workpool.h"
+
+#define MAX_VALUES       16
+#define DEFAULT_MAX_CYCLES 10000000ULL   // keeps a non-terminating point from hanging the sweep
+
+typedef struct {
+    const char *path;
+    uint16_t   *image;
+    int         words;
+} Program;
+
+typedef struct {
+    const ConfigKnob *knob;
+    uint16_t    values[MAX_VALUES];
+    int         count;
+} Axis;
+
+typedef struct {
+    int       program;
+    SimConfig config;
+    SimStats  stats;
+    uint32_t  cache_hits;
+    uint32_t  cache_misses;
+    uint32_t  cache_writebacks;
+    uint32_t  icache_hits;          // split_cache only
+    uint32_t  icache_misses;
+    uint32_t  l2_hits;              // l2 only
+    uint32_t  l2_misses;
+    uint32_t  pf_issued;            // both L1 prefetchers
+    uint32_t  pf_useful;            // demand hits on prefetched lines plus late fills
+    uint32_t  pf_late;
+    uint32_t  victim_hits;          // both L1 victim buffers
+    uint32_t  victim_misses;
+    uint32_t  row_hits;             // dram_banks only
+    uint32_t  row_misses;
+    uint32_t  row_conflicts;
+    uint32_t  mc_requests[MC_SOURCES];  // memctrl only: issued and cycles queued, per source
+    uint64_t  mc_wait[MC_SOURCES];
+} SweepPoint;
+
+typedef struct {
+    Program    *programs;
+    SweepPoint *points;
+    uint64_t    max_cycles;
+} Sweep;
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [-j threads] [-m max_cycles] [-o out.csv|out.json] [-f configs]\n"
+            "          [key=v1,v2,...] program.txt ...\n"
+            "keys:", prog);
+    print_config_keys(stderr, true);
+}
+
+// The sweepable knob called key, or NULL.
+static const ConfigKnob *sweep_knob(const char *key) {
+    const ConfigKnob *k = config_knob(key);
+    return k && !(k->flags & KNOB_HOST) ? k : NULL;
+}
+
+// "key=v1,v2,..." -> axis.  Returns false on a malformed or unknown entry.
+static bool parse_axis(char *arg, Axis *axis) {
+    char *eq = strchr(arg, '=');
+    if (!eq) return false;
+    *eq = 0;
+    axis->knob  = sweep_knob(arg);
+    axis->count = 0;
+    if (!axis->knob) return false;
+
+    for (char *v = strtok(eq + 1, ","); v; v = strtok(NULL, ",")) {
+        if (axis->count == MAX_VALUES || !knob_parse(axis->knob, v, &axis->values[axis->count++]))
+            return false;
+    }
+    return axis->count > 0;
+}
+
+// One line of a -f file -> config on top of the defaults.
+static bool parse_line(char *line, SimConfig *cfg) {
+    *cfg = default_config();
+    for (char *tok = strtok(line, " \t"); tok; tok = strtok(NULL, " \t")) {
+        char *eq = strchr(tok, '=');
+        if (!eq) return false;
+        *eq = 0;
+        const ConfigKnob *k = sweep_knob(tok);
+        uint16_t v;
+        if (!k || !knob_parse(k, eq + 1, &v)) return false;
+        knob_set(cfg, k, v);
+    }
+    return true;
+}
+
+static void run_point(void *arg, size_t index) {
+    Sweep      *sweep = arg;
+    SweepPoint *pt    = &sweep->points[index];
+    Program    *prog  = &sweep->programs[pt->program];
+
+    SimContext *ctx = init_context();
+    setConfig(ctx, &pt->config);
+    loadImage(ctx, prog->image, prog->words);
+    runPipeline(ctx, sweep->max_cycles);
+
+    pt->stats = ctx->stats;
+    if (ctx->cache) {
+        pt->cache_hits   = ctx->cache->hits;
+        pt->cache_misses = ctx->cache->misses;
+        pt->cache_writebacks = ctx->cache->writebacks;
+    }
+    if (ctx->icache) {
+        pt->icache_hits   = ctx->icache->hits;
+        pt->icache_misses = ctx->icache->misses;
+    }
+    if (ctx->l2) {
+        pt->l2_hits   = ctx->l2->hits;
+        pt->l2_misses = ctx->l2->misses;
+    }
+    if (ctx->dram.timing.banks) {
+        pt->row_hits      = ctx->dram.row_hits;
+        pt->row_misses    = ctx->dram.row_misses;
+        pt->row_conflicts = ctx->dram.row_conflicts;
+    }
+    memcpy(pt->mc_requests, ctx->memctrl.requests, sizeof(pt->mc_requests));
+    memcpy(pt->mc_wait, ctx->memctrl.wait, sizeof(pt->mc_wait));
+    Prefetcher *pfs[2] = { ctx->prefetch, ctx->iprefetch };
+    for (int i = 0; i < 2; i++) {
+        if (!pfs[i]) continue;
+        pt->pf_issued += pfs[i]->issued;
+        pt->pf_useful += pfs[i]->cache->prefetch_hits + pfs[i]->late;
+        pt->pf_late   += pfs[i]->late;
+    }
+    Cache *l1[2] = { ctx->cache, ctx->icache };
+    for (int i = 0; i < 2; i++) {
+        if (!l1[i] || !l1[i]->victims) continue;
+        pt->victim_hits   += l1[i]->victims->hits;
+        pt->victim_misses += l1[i]->victims->misses;
+    }
+    destroy_context(ctx);
+}
+
+static double hit_rate(const SweepPoint *pt) {
+    uint32_t accesses = pt->cache_hits + pt->cache_misses;
+    return accesses ? (double)pt->cache_hits / accesses : 0.0;
+}
+
+static double cpi(const SweepPoint *pt) {
+    return pt->stats.instructions ? (double)pt->stats.cycles / pt->stats.instructions : 0.0;
+}
+
+// Average cycles the requests of source spent in the memory controller queue.
+static double mc_wait(const SweepPoint *pt, int source) {
+    return pt->mc_requests[source] ? (double)pt->mc_wait[source] / pt->mc_requests[source] : 0.0;
+}
+
+// Whether k gets a column: every sweepable knob under its first name.
+static bool knob_column(const ConfigKnob *k) {
+    return !(k->flags & (KNOB_ALIAS | KNOB_HOST));
+}
+
+// The configuration columns of pt: a knob's name for its value where it has
+// names, else the number; as "key": value pairs for JSON.
+static void write_knobs(FILE *out, const SweepPoint *pt, bool json) {
+    for (int i = 0; i < config_knob_count; i++) {
+        const ConfigKnob *k = &config_knobs[i];
+        if (!knob_column(k)) continue;
+        uint16_t v = knob_get(&pt->config, k);
+        if (json && k->name_of) fprintf(out, ", \"%s\": \"%s\"", k->name, k->name_of(v));
+        else if (json)          fprintf(out, ", \"%s\": %u", k->name, v);
+        else if (k->name_of)    fprintf(out, ",%s", k->name_of(v));
+        else                    fprintf(out, ",%u", v);
+    }
+}
+
+static void write_csv(FILE *out, const Sweep *sweep, size_t npoints) {
+    fprintf(out, "program");
+    for (int i = 0; i < config_knob_count; i++)
+        if (knob_column(&config_knobs[i])) fprintf(out, ",%s", config_knobs[i].name);
+    fprintf(out, ",cycles,instructions,cpi,"
+                 "mem_stalls,hazard_stalls,fetch_stalls,cache_hits,cache_misses,writebacks,hit_rate,"
+                 "icache_hits,icache_misses,l2_hits,l2_misses,pf_issued,pf_useful,pf_late,"
+                 "victim_hits,victim_misses,row_hits,row_misses,row_conflicts,bus_fills,restart_cycles,sb_coalesced,sb_forwards,sb_full_cycles,branches,mispredicts,flush_cycles");
+    for (int s = 0; s < MC_SOURCES; s++) fprintf(out, ",mc_%s_wait", mc_source_name(s));
+    fprintf(out, "\n");
+    for (size_t i = 0; i < npoints; i++) {
+        const SweepPoint *pt = &sweep->points[i];
+        fprintf(out, "%s", sweep->programs[pt->program].path);
+        write_knobs(out, pt, false);
+        fprintf(out, ",%llu,%llu,%.4f,%llu,%llu,%llu,%u,%u,%u,%.4f,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu",
+                (unsigned long long)pt->stats.cycles,
+                (unsigned long long)pt->stats.instructions, cpi(pt),
+                (unsigned long long)pt->stats.mem_stall_cycles,
+                (unsigned long long)pt->stats.hazard_stall_cycles,
+                (unsigned long long)pt->stats.fetch_stall_cycles,
+                pt->cache_hits, pt->cache_misses, pt->cache_writebacks, hit_rate(pt),
+                pt->icache_hits, pt->icache_misses, pt->l2_hits, pt->l2_misses,
+                pt->pf_issued, pt->pf_useful, pt->pf_late, pt->victim_hits, pt->victim_misses,
+                pt->row_hits, pt->row_misses, pt->row_conflicts,
+                (unsigned long long)pt->stats.bus_fills, (unsigned long long)pt->stats.restart_cycles,
+                (unsigned long long)pt->stats.sb_coalesced, (unsigned long long)pt->stats.sb_forwards,
+                (unsigned long long)pt->stats.sb_full_cycles,
+                (unsigned long long)pt->stats.branches, (unsigned long long)pt->stats.mispredicts,
+                (unsigned long long)pt->stats.flush_cycles);
+        for (int s = 0; s < MC_SOURCES; s++) fprintf(out, ",%.2f", mc_wait(pt, s));
+        fprintf(out, "\n");
+    }
+}
+
+static void write_json(FILE *out, const Sweep *sweep, size_t npoints) {
+    fprintf(out, "[\n");
+    for (size_t i = 0; i < npoints; i++) {
+        const SweepPoint *pt = &sweep->points[i];
+        fprintf(out, "  {\"program\": \"%s\"", sweep->programs[pt->program].path);
+        write_knobs(out, pt, true);
+        fprintf(out, ", \"cycles\": %llu, \"instructions\": %llu, "
+                     "\"cpi\": %.4f, \"mem_stalls\": %llu, \"hazard_stalls\": %llu, "
+                     "\"fetch_stalls\": %llu, \"cache_hits\": %u, \"cache_misses\": %u, \"writebacks\": %u, "
+                     "\"hit_rate\": %.4f, \"icache_hits\": %u, \"icache_misses\": %u, "
+                     "\"l2_hits\": %u, \"l2_misses\": %u, \"pf_issued\": %u, \"pf_useful\": %u, "
+                     "\"pf_late\": %u, \"victim_hits\": %u, \"victim_misses\": %u, "
+                     "\"row_hits\": %u, \"row_misses\": %u, \"row_conflicts\": %u, "
+                     "\"bus_fills\": %llu, \"restart_cycles\": %llu, \"sb_coalesced\": %llu, "
+                     "\"sb_forwards\": %llu, \"sb_full_cycles\": %llu, \"branches\": %llu, "
+                     "\"mispredicts\": %llu, \"flush_cycles\": %llu",
+                (unsigned long long)pt->stats.cycles,
+                (unsigned long long)pt->stats.instructions, cpi(pt),
+                (unsigned long long)pt->stats.mem_stall_cycles,
+                (unsigned long long)pt->stats.hazard_stall_cycles,
+                (unsigned long long)pt->stats.fetch_stall_cycles,
+                pt->cache_hits, pt->cache_misses, pt->cache_writebacks, hit_rate(pt),
+                pt->icache_hits, pt->icache_misses, pt->l2_hits, pt->l2_misses,
+                pt->pf_issued, pt->pf_useful, pt->pf_late, pt->victim_hits, pt->victim_misses,
+                pt->row_hits, pt->row_misses, pt->row_conflicts,
+                (unsigned long long)pt->stats.bus_fills, (unsigned long long)pt->stats.restart_cycles,
+                (unsigned long long)pt->stats.sb_coalesced, (unsigned long long)pt->stats.sb_forwards,
+                (unsigned long long)pt->stats.sb_full_cycles,
+                (unsigned long long)pt->stats.branches, (unsigned long long)pt->stats.mispredicts,
+                (unsigned long long)pt->stats.flush_cycles);
+        for (int s = 0; s < MC_SOURCES; s++)
+            fprintf(out, ", \"mc_%s_wait\": %.2f", mc_source_name(s), mc_wait(pt, s));
+        fprintf(out, "}%s\n", i + 1 < npoints ? "," : "");
+    }
+    fprintf(out, "]\n");
+}
+
+// Read every point of a -f file.  Returns the count, or -1 on error.
+static int load_configs(const char *path, SimConfig **configs) {
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+
+    int  count = 0, cap = 16;
+    char line[256];
+    *configs = malloc(cap * sizeof(SimConfig));
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "#\r\n")] = 0;
+        if (!line[strspn(line, " \t")]) continue;
+        if (count == cap) *configs = realloc(*configs, (cap *= 2) * sizeof(SimConfig));
+        if (!parse_line(line, &(*configs)[count])) {
+            fprintf(stderr, "bad config line: %s\n", line);
+            fclose(f);
+            return -1;
+        }
+        count++;
+    }
+    fclose(f);
+    return count;
+}
+
+// Expand the grid axes over the default config.
+static int expand_grid(const Axis *axes, int naxes, SimConfig **configs) {
+    int count = 1;
+    for (int a = 0; a < naxes; a++) count *= axes[a].count;
+
+    *configs = malloc(count * sizeof(SimConfig));
+    for (int i = 0; i < count; i++) {
+        SimConfig cfg = default_config();
+        int rest = i;
+        // last axis varies fastest
+        for (int a = naxes - 1; a >= 0; a--) {
+            knob_set(&cfg, axes[a].knob, axes[a].values[rest % axes[a].count]);
+            rest /= axes[a].count;
+        }
+        (*configs)[i] = cfg;
+    }
+    return count;
+}
+
+int main(int argc, char **argv) {
+    unsigned    threads    = 0;
+    uint64_t    max_cycles = DEFAULT_MAX_CYCLES;
+    const char *out_path   = NULL;
+    const char *cfg_path   = NULL;
+    Axis        axes[8];
+    int         naxes      = 0;
+    const char *paths[64];
+    int         nprogs     = 0;
+
+    // Workers share the process-wide trace flags; keep them quiet.
+    trace_configure(TRACE_LEVEL_OFF, TRACE_ALL);
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            threads = (unsigned)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            max_cycles = strtoull(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            cfg_path = argv[++i];
+        } else if (strchr(argv[i], '=')) {
+            if (naxes == 8 || !parse_axis(argv[i], &axes[naxes])) {
+                fprintf(stderr, "%s: bad sweep axis '%s'\n", argv[0], argv[i]);
+                return 2;
+            }
+            naxes++;
+        } else if (argv[i][0] != '-' && nprogs < 64) {
+            paths[nprogs++] = argv[i];
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (nprogs == 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    SimConfig *configs;
+    int nconfigs = cfg_path ? load_configs(cfg_path, &configs)
+                            : expand_grid(axes, naxes, &configs);
+    if (nconfigs <= 0) {
+        fprintf(stderr, "%s: no configurations to run\n", argv[0]);
+        return 1;
+    }
+    for (int c = 0; c < nconfigs; c++) {
+        if (checkGeometry(&configs[c])) continue;
+        fflush(stdout);
+        fprintf(stderr, "%s: configuration %d has a cache shape that cannot be built\n", argv[0], c + 1);
+        return 2;
+    }
+
+    // Assemble each program once; every point copies the image into its own DRAM.
+    Program *programs = calloc(nprogs, sizeof(Program));
+    for (int p = 0; p < nprogs; p++) {
+        programs[p].path  = paths[p];
+        programs[p].image = malloc(DRAM_SIZE * sizeof(uint16_t));
+        programs[p].words = assembleFile(paths[p], programs[p].image, DRAM_SIZE);
+        if (programs[p].words < 0) {
+            fprintf(stderr, "%s: cannot open %s\n", argv[0], paths[p]);
+            return 1;
+        }
+    }
+
+    size_t      npoints = (size_t)nprogs * nconfigs;
+    SweepPoint *points  = calloc(npoints, sizeof(SweepPoint));
+    for (size_t i = 0; i < npoints; i++) {
+        points[i].program = (int)(i / nconfigs);
+        points[i].config  = configs[i % nconfigs];
+    }
+
+    Sweep sweep = { programs, points, max_cycles };
+    workpool_run(npoints, threads, run_point, &sweep);
+
+    FILE *out = out_path ? fopen(out_path, "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "%s: cannot write %s\n", argv[0], out_path);
+        return 1;
+    }
+    size_t len = out_path ? strlen(out_path) : 0;
+    if (len > 5 && strcmp(out_path + len - 5, ".json") == 0)
+        write_json(out, &sweep, npoints);
+    else
+        write_csv(out, &sweep, npoints);
+    if (out != stdout) fclose(out);
+
+    for (int p = 0; p < nprogs; p++) free(programs[p].image);
+    free(programs);
+    free(points);
+    free(configs);
+    return 0;
+}
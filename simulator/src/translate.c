@@ -0,0 +1,197 @@
+// translate.c – ARCH-16 image → C translation unit, and the loader for the
+// compiled result.
+//
+// Every word of the image becomes a label followed by the statements that
+// execute it, following functional.c's exec_one.  Branches and jumps with a
+// target inside the image are plain gotos; anything computed (an ALU write to
+// R15) or outside the image goes through the dispatch switch.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <dlfcn.h>
+#include "memory.h"
+#include "decode_table.h"
+#include "simulator.h"
+#include "translate.h"
+
+typedef int (*TranslatedFn)(uint16_t *R, uint16_t *mem, uint64_t max_instructions,
+                            uint64_t *executed);
+
+struct TranslatedProgram {
+    void           *handle;
+    TranslatedFn    run;
+    const uint16_t *image;
+    int             words;
+};
+
+// goto the label of target if the image has one, otherwise dispatch.
+static void emit_goto(FILE *out, uint32_t target, int words) {
+    if (target < (uint32_t)words) fprintf(out, "goto L%u;", target);
+    else                          fprintf(out, "{ pc = %u; goto dispatch; }", target);
+}
+
+static void emit_word(FILE *out, uint16_t pc, uint16_t word, int words) {
+    const DecodedInstr *di = &decode_table[word];
+    unsigned d = di->regD, a = di->regA, b = di->regB, imm = di->imm;
+    uint16_t next = pc + 1;
+    char text[64];
+
+    disassemble(word, text, sizeof text);
+    fprintf(out, "L%u: /* %s */\n", pc, text);
+    if (word == 0) {
+        fprintf(out, "    pc = %u; goto out;\n", pc);
+        return;
+    }
+    fprintf(out, "    if (!left) { pc = %u; goto out; } left--;\n", pc);
+    if ((di->src_mask | di->dst_mask) & 0x8000)
+        fprintf(out, "    r[15] = %u;\n", next);
+
+    fprintf(out, "    ");
+    switch (di->handler) {
+        case H_ADD:    fprintf(out, "r[%u] = r[%u] + r[%u];", d, a, b); break;
+        case H_SUB:    fprintf(out, "r[%u] = r[%u] - r[%u];", d, a, b); break;
+        case H_AND:    fprintf(out, "r[%u] = r[%u] & r[%u];", d, a, b); break;
+        case H_OR:     fprintf(out, "r[%u] = r[%u] | r[%u];", d, a, b); break;
+        case H_XOR:    fprintf(out, "r[%u] = r[%u] ^ r[%u];", d, a, b); break;
+        case H_DIVMOD: fprintf(out, "r[%u] = r[%u] ? r[%u] / r[%u] : 0;", d, b, a, b); break;
+        case H_MUL:    fprintf(out, "r[%u] = r[%u] * r[%u];", d, a, b); break;
+        case H_CMP:
+            fprintf(out, "r[14] = (int16_t)r[%u] < (int16_t)r[%u] ? 0xFFFF : r[%u] == r[%u] ? 0 : 1;",
+                    d, a, d, a);
+            break;
+        // shifts and rotates spelled out as in isa_lsl() and friends
+        case H_LSL: fprintf(out, "{ unsigned n = r[%u]; r[%u] = n < 16 ? r[%u] << n : 0; }", b, d, d); break;
+        case H_LSR: fprintf(out, "{ unsigned n = r[%u]; r[%u] = n < 16 ? r[%u] >> n : 0; }", b, d, d); break;
+        case H_ROL:
+            fprintf(out, "{ unsigned n = r[%u] & 15; r[%u] = (r[%u] << n) | (r[%u] >> ((16 - n) & 15)); }",
+                    b, d, d, d);
+            break;
+        case H_ROR:
+            fprintf(out, "{ unsigned n = r[%u] & 15; r[%u] = (r[%u] >> n) | (r[%u] << ((16 - n) & 15)); }",
+                    b, d, d, d);
+            break;
+        case H_LW:
+            fprintf(out, "{ uint16_t ad = r[%u] + %u; r[%u] = mem[ad]; }", a, imm, d);
+            break;
+        case H_SW:
+            // A store that changes the image leaves the translation.
+            fprintf(out, "{ uint16_t ad = r[%u] + %u; mem[ad] = r[%u];\n"
+                         "      if (ad < IMAGE_WORDS && mem[ad] != arch16_image[ad]) { pc = %u; bail = 1; goto out; } }",
+                    a, imm, d, next);
+            break;
+        case H_BEQ:
+            fprintf(out, "if (r[%u] == r[%u]) ", d, a);
+            emit_goto(out, (uint16_t)(pc + imm), words);
+            break;
+        case H_BLT:
+            fprintf(out, "if ((int16_t)r[%u] < (int16_t)r[%u]) ", d, a);
+            emit_goto(out, (uint16_t)(pc + imm), words);
+            break;
+        case H_JMP:
+            emit_goto(out, imm, words);
+            break;
+        default:
+            fprintf(out, "/* unassigned opcode */");
+            break;
+    }
+    fprintf(out, "\n");
+
+    // An ALU write to R15 redirects like a jump.
+    if (!(di->flags & DI_BRANCH) && (di->dst_mask & 0x8000))
+        fprintf(out, "    pc = r[15]; goto dispatch;\n");
+}
+
+int translateImage(const uint16_t *image, int words, const char *source, FILE *out) {
+    fprintf(out, "// Generated by arch16-aot from %s -- do not edit.\n", source);
+    fprintf(out, "#include <stdint.h>\n\n");
+    fprintf(out, "#define IMAGE_WORDS %d\n\n", words);
+
+    fprintf(out, "const int arch16_image_words = IMAGE_WORDS;\n");
+    fprintf(out, "const uint16_t arch16_image[IMAGE_WORDS] = {");
+    for (int i = 0; i < words; i++)
+        fprintf(out, "%s0x%04X,", i % 8 ? " " : "\n    ", image[i]);
+    fprintf(out, "\n};\n\n");
+
+    fprintf(out,
+            "int arch16_run(uint16_t *R, uint16_t *mem, uint64_t max_instructions, uint64_t *executed) {\n"
+            "    uint64_t budget = max_instructions ? max_instructions : UINT64_MAX;\n"
+            "    uint64_t left = budget;\n"
+            "    uint16_t r[16];\n"
+            "    uint16_t pc;\n"
+            "    int bail = 0;\n\n"
+            "    for (int i = 0; i < 16; i++) r[i] = R[i];\n"
+            "    pc = r[15];\n"
+            "    goto dispatch;\n\n");
+
+    for (int pc = 0; pc < words; pc++)
+        emit_word(out, (uint16_t)pc, image[pc], words);
+    fprintf(out, "    pc = IMAGE_WORDS;\n\n");
+
+    fprintf(out, "dispatch:\n    switch (pc) {\n");
+    for (int pc = 0; pc < words; pc++)
+        fprintf(out, "        case %d: goto L%d;\n", pc, pc);
+    fprintf(out,
+            "    }\n"
+            "    if (mem[pc]) bail = 1;      // code outside the image\n\n"
+            "out:\n"
+            "    r[15] = pc;\n"
+            "    for (int i = 0; i < 16; i++) R[i] = r[i];\n"
+            "    *executed = budget - left;\n"
+            "    return bail;\n"
+            "}\n");
+
+    return ferror(out) ? -1 : 0;
+}
+
+TranslatedProgram *loadTranslated(const char *so_path) {
+    void *handle = dlopen(so_path, RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        fprintf(stderr, "%s\n", dlerror());
+        return NULL;
+    }
+
+    TranslatedProgram *tp = calloc(1, sizeof *tp);
+    const int *words = dlsym(handle, "arch16_image_words");
+    tp->handle = handle;
+    tp->run    = (TranslatedFn)dlsym(handle, "arch16_run");
+    tp->image  = dlsym(handle, "arch16_image");
+    if (!tp->run || !tp->image || !words) {
+        fprintf(stderr, "%s: not an arch16-aot translation\n", so_path);
+        unloadTranslated(tp);
+        return NULL;
+    }
+    tp->words = *words;
+    return tp;
+}
+
+void unloadTranslated(TranslatedProgram *tp) {
+    if (!tp) return;
+    dlclose(tp->handle);
+    free(tp);
+}
+
+uint64_t runTranslated(SimContext *ctx, TranslatedProgram *tp, uint64_t max_instructions) {
+    uint16_t *mem = ctx->dram.memory;
+    if (memcmp(mem, tp->image, tp->words * sizeof *mem) != 0)
+        return runFunctional(ctx, max_instructions, -1);
+
+    // The translation writes DRAM directly; patch resident lines afterwards.
+    uint16_t *before = NULL;
+    if (ctx->cache && (before = malloc(DRAM_SIZE * sizeof *mem)))
+        memcpy(before, mem, DRAM_SIZE * sizeof *mem);
+
+    uint64_t n = 0;
+    int bailed = tp->run(ctx->registers->R, mem, max_instructions, &n);
+    ctx->stats.functional_instructions += n;
+
+    if (before) {
+        for (uint32_t addr = 0; addr < DRAM_SIZE; addr++)
+            if (mem[addr] != before[addr]) patch_cache(ctx->cache, addr, mem[addr]);
+        free(before);
+    }
+
+    if (bailed && (!max_instructions || n < max_instructions))
+        n += runFunctional(ctx, max_instructions ? max_instructions - n : 0, -1);
+    return n;
+}
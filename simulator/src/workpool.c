@@ -0,0 +1,136 @@
+// workpool.c – small work-stealing thread pool for independent simulations.
+//
+// Every task is known up front, so nothing is ever pushed after the workers
+// start: each deque only shrinks, and a worker that finds all deques empty in
+// one full pass can simply exit.
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "workpool.h"
+
+typedef struct {
+    pthread_mutex_t lock;
+    size_t *tasks;
+    size_t  head;     // next index to steal
+    size_t  tail;     // one past the next index the owner pops
+} WorkQueue;
+
+typedef struct {
+    WorkQueue *queues;
+    unsigned   nqueues;
+    WorkFn     fn;
+    void      *arg;
+} WorkPool;
+
+typedef struct {
+    WorkPool *pool;
+    unsigned  id;
+} Worker;
+
+static int pop_own(WorkQueue *q, size_t *task) {
+    int got = 0;
+    pthread_mutex_lock(&q->lock);
+    if (q->head < q->tail) {
+        *task = q->tasks[--q->tail];
+        got = 1;
+    }
+    pthread_mutex_unlock(&q->lock);
+    return got;
+}
+
+static int steal(WorkQueue *q, size_t *task) {
+    int got = 0;
+    pthread_mutex_lock(&q->lock);
+    if (q->head < q->tail) {
+        *task = q->tasks[q->head++];
+        got = 1;
+    }
+    pthread_mutex_unlock(&q->lock);
+    return got;
+}
+
+static void *worker_main(void *p) {
+    Worker   *w    = p;
+    WorkPool *pool = w->pool;
+    size_t    task;
+
+    for (;;) {
+        if (pop_own(&pool->queues[w->id], &task)) {
+            pool->fn(pool->arg, task);
+            continue;
+        }
+        int found = 0;
+        for (unsigned i = 1; i < pool->nqueues && !found; i++) {
+            unsigned victim = (w->id + i) % pool->nqueues;
+            found = steal(&pool->queues[victim], &task);
+        }
+        if (!found) break;
+        pool->fn(pool->arg, task);
+    }
+    return NULL;
+}
+
+unsigned workpool_default_threads(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (unsigned)n : 1;
+}
+
+void workpool_run(size_t ntasks, unsigned nthreads, WorkFn fn, void *arg) {
+    if (ntasks == 0) return;
+    if (nthreads == 0) nthreads = workpool_default_threads();
+    if (nthreads > ntasks) nthreads = (unsigned)ntasks;
+
+    // Single worker: no point paying for threads.
+    if (nthreads == 1) {
+        for (size_t i = 0; i < ntasks; i++) fn(arg, i);
+        return;
+    }
+
+    // Queue q gets at most per tasks and keeps them in slots [q*per, (q+1)*per).
+    size_t   per   = (ntasks + nthreads - 1) / nthreads;
+    WorkPool pool  = { calloc(nthreads, sizeof(WorkQueue)), nthreads, fn, arg };
+    size_t  *slots = malloc((size_t)nthreads * per * sizeof(size_t));
+    if (!pool.queues || !slots) {
+        free(pool.queues);
+        free(slots);
+        for (size_t i = 0; i < ntasks; i++) fn(arg, i);
+        return;
+    }
+
+    // Deal tasks round-robin so neighbouring (similar-cost) points land on
+    // different workers.
+    for (unsigned q = 0; q < nthreads; q++) {
+        WorkQueue *wq = &pool.queues[q];
+        pthread_mutex_init(&wq->lock, NULL);
+        wq->tasks = slots + (size_t)q * per;
+        for (size_t t = q; t < ntasks; t += nthreads)
+            wq->tasks[wq->tail++] = t;
+    }
+
+    pthread_t *threads = malloc(nthreads * sizeof(pthread_t));
+    Worker    *workers = malloc(nthreads * sizeof(Worker));
+    unsigned   started = 0;
+    for (unsigned i = 0; i < nthreads; i++) {
+        workers[i].pool = &pool;
+        workers[i].id   = i;
+        if (pthread_create(&threads[i], NULL, worker_main, &workers[i]) == 0)
+            started++;
+        else
+            break;
+    }
+    // Whatever could not get a thread is drained by this one.
+    if (started < nthreads) {
+        Worker self = { &pool, started };
+        worker_main(&self);
+    }
+    for (unsigned i = 0; i < started; i++)
+        pthread_join(threads[i], NULL);
+
+    for (unsigned q = 0; q < nthreads; q++)
+        pthread_mutex_destroy(&pool.queues[q].lock);
+    free(workers);
+    free(threads);
+    free(slots);
+    free(pool.queues);
+}
@@ -0,0 +1,15 @@
+# Runs a tool on knobs it must refuse, and requires exit status 2 and the
+# [CONFIG] complaint, before any cycle is simulated.
+#
+#   cmake -DTOOL=<arch16-run|arch16-sweep> -DKNOBS="<key=value ...>" -DPROGRAM=<file>
+#         -DEXPECT=<regex> -P bad_config.cmake
+
+separate_arguments(knobs UNIX_COMMAND "${KNOBS}")
+execute_process(COMMAND ${TOOL} ${knobs} ${PROGRAM}
+                OUTPUT_VARIABLE out ERROR_VARIABLE err RESULT_VARIABLE rc)
+if (NOT rc STREQUAL "2")
+  message(FATAL_ERROR "${KNOBS}: exit status ${rc}, expected 2\n${out}${err}")
+endif()
+if (NOT out MATCHES "${EXPECT}")
+  message(FATAL_ERROR "${KNOBS}: no \"${EXPECT}\" in\n${out}")
+endif()
@@ -0,0 +1,19 @@
+# Runs the same sweep on one worker and on several, with a point count the
+# worker count does not divide, and requires identical CSV output.
+#
+#   cmake -DSWEEP=<arch16-sweep> -DPROGRAM=<file> -DOUT=<dir> -P sweep_threads.cmake
+
+foreach(jobs 1 4)
+  execute_process(COMMAND ${SWEEP} -j ${jobs} -o ${OUT}/sweep_j${jobs}.csv
+                          dram=1,2,3,4,5 ${PROGRAM}
+                  OUTPUT_QUIET RESULT_VARIABLE rc)
+  if (NOT rc EQUAL 0)
+    message(FATAL_ERROR "arch16-sweep -j ${jobs} exited with ${rc}")
+  endif()
+endforeach()
+
+file(READ ${OUT}/sweep_j1.csv serial)
+file(READ ${OUT}/sweep_j4.csv parallel)
+if (NOT serial STREQUAL parallel)
+  message(FATAL_ERROR "arch16-sweep -j 4 results differ from -j 1")
+endif()
@@ -0,0 +1,33 @@
+# Checks the write-back trace text of BEQ, BLT and JMP.  Write-back prints the
+# branch outcome resolved in Execute, so the branch lines must be the same,
+# in the same order, whichever predictor fetch followed.
+#
+#   cmake -DRUN=<arch16-run> -DPROGRAM=<file> -DJMPS=<n> -DNOT_TAKEN=<n> -P writeback_text.cmake
+
+function(branch_lines bpred out)
+  execute_process(COMMAND ${RUN} trace=1 bpred=${bpred} ${PROGRAM}
+                  OUTPUT_VARIABLE text RESULT_VARIABLE rc)
+  if (NOT rc EQUAL 0)
+    message(FATAL_ERROR "arch16-run bpred=${bpred} exited with ${rc}")
+  endif()
+  # Drop the ":<pc>" suffix, which is not part of the instruction text.
+  string(REGEX MATCHALL "WRITEBACK:(BEQ|BLT|JMP)[^:\n]*" lines "${text}")
+  set(${out} "${lines}" PARENT_SCOPE)
+endfunction()
+
+branch_lines(none reference)
+string(REGEX MATCHALL "JMP +→ PC=[0-9]+" jmps "${reference}")
+string(REGEX MATCHALL "branch not taken" not_taken "${reference}")
+list(LENGTH jmps njmps)
+list(LENGTH not_taken nnot_taken)
+if (NOT njmps EQUAL JMPS OR NOT nnot_taken EQUAL NOT_TAKEN)
+  message(FATAL_ERROR "bpred=none: ${njmps} JMPs and ${nnot_taken} untaken branches "
+                      "written back, expected ${JMPS} and ${NOT_TAKEN}")
+endif()
+
+foreach(bpred nottaken btfn bimodal gshare tournament)
+  branch_lines(${bpred} lines)
+  if (NOT lines STREQUAL reference)
+    message(FATAL_ERROR "bpred=${bpred}: branch write-back text differs from bpred=none")
+  endif()
+endforeach()
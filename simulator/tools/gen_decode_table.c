@@ -0,0 +1,133 @@
+// gen_decode_table.c – build-time generator for decode_table.c.
+//
+//   gen_decode_table <output.c>
+//
+// This is the one place that knows how the ARCH-16 encodings split into
+// fields; everything else reads the generated table.
+#include <stdio.h>
+#include <stdint.h>
+#include "decode_table.h"
+
+#define BIT(r) ((uint16_t)(1u << (r)))
+
+static DecodedInstr decode_word(uint16_t ins) {
+    DecodedInstr d = {0};
+    uint16_t op = ins >> 12;
+
+    d.opcode = (uint8_t)op;
+    if (ins == 0) {
+        d.handler = H_NOP;
+        return d;
+    }
+
+    if (op == 0x8) {
+        // shifts: bits[11:8]=type, [7:4]=Rd (also the operand), [3:0]=Rs (amount)
+        uint8_t type = (ins >> 8) & 0xF;
+        uint8_t rd   = (ins >> 4) & 0xF;
+        uint8_t rs   =  ins       & 0xF;
+        d.type     = type;
+        d.regD     = rd;
+        d.regA     = rd;
+        d.regB     = rs;
+        d.fu       = FU_SHIFT;
+        d.handler  = type == 0 ? H_LSL : type == 1 ? H_LSR : type == 2 ? H_ROL : H_ROR;
+        d.flags    = DI_VALID;
+        d.src_mask = BIT(rd) | BIT(rs);
+        d.dst_mask = BIT(rd);
+        return d;
+    }
+
+    if (op == 0xC) {
+        // JMP: 12-bit absolute target
+        d.imm     = ins & 0xFFF;
+        d.fu      = FU_BRANCH;
+        d.handler = H_JMP;
+        d.flags   = DI_VALID | DI_BRANCH;
+        return d;
+    }
+
+    // RRR / RRI: bits[11:8]=Rd, [7:4]=Ra, [3:0]=Rb or imm
+    uint8_t rd = (ins >> 8) & 0xF;
+    uint8_t ra = (ins >> 4) & 0xF;
+    uint8_t rb =  ins       & 0xF;
+    d.regD  = rd;
+    d.regA  = ra;
+    d.regB  = rb;
+    d.imm   = rb;
+    d.flags = DI_VALID;
+
+    switch (op) {
+        case 0x0: d.handler = H_ADD;    d.fu = FU_ALU; break;
+        case 0x1: d.handler = H_SUB;    d.fu = FU_ALU; break;
+        case 0x2: d.handler = H_AND;    d.fu = FU_ALU; break;
+        case 0x3: d.handler = H_OR;     d.fu = FU_ALU; break;
+        case 0x4: d.handler = H_XOR;    d.fu = FU_ALU; break;
+        case 0x5: d.handler = H_DIVMOD; d.fu = FU_DIV; break;
+        case 0x6: d.handler = H_MUL;    d.fu = FU_MUL; break;
+        case 0x7:
+            d.handler  = H_CMP;
+            d.fu       = FU_ALU;
+            d.src_mask = BIT(rd) | BIT(ra);
+            d.dst_mask = BIT(14);
+            return d;
+        case 0x9:
+            d.handler  = H_LW;
+            d.fu       = FU_MEM;
+            d.flags   |= DI_LOAD;
+            d.src_mask = BIT(ra);
+            d.dst_mask = BIT(rd);
+            return d;
+        case 0xA:
+            d.handler  = H_SW;
+            d.fu       = FU_MEM;
+            d.flags   |= DI_STORE;
+            d.src_mask = BIT(ra) | BIT(rd);
+            return d;
+        case 0xB:
+        case 0xF:
+            d.handler  = op == 0xB ? H_BEQ : H_BLT;
+            d.fu       = FU_BRANCH;
+            d.flags   |= DI_BRANCH;
+            d.src_mask = BIT(rd) | BIT(ra);
+            return d;
+        default:    // 0xD, 0xE
+            d.handler = H_INVALID;
+            d.flags   = 0;
+            return d;
+    }
+
+    // three-register ALU ops
+    d.src_mask = BIT(ra) | BIT(rb);
+    d.dst_mask = BIT(rd);
+    return d;
+}
+
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s <output.c>\n", argv[0]);
+        return 2;
+    }
+    FILE *out = fopen(argv[1], "w");
+    if (!out) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    fprintf(out, "// Generated by gen_decode_table at build time -- do not edit.\n");
+    fprintf(out, "// {opcode, type, regD, regA, regB, fu, handler, flags, imm, src_mask, dst_mask}\n");
+    fprintf(out, "#include \"decode_table.h\"\n\n");
+    fprintf(out, "const DecodedInstr decode_table[65536] = {\n");
+    for (uint32_t w = 0; w < 65536; w++) {
+        DecodedInstr d = decode_word((uint16_t)w);
+        fprintf(out, "  {%u,%u,%u,%u,%u,%u,%u,%u,%u,0x%04X,0x%04X},\n",
+                d.opcode, d.type, d.regD, d.regA, d.regB, d.fu, d.handler, d.flags,
+                d.imm, d.src_mask, d.dst_mask);
+    }
+    fprintf(out, "};\n");
+
+    if (fclose(out) != 0) {
+        perror(argv[1]);
+        return 1;
+    }
+    return 0;
+}